@@ -0,0 +1,456 @@
+#pragma once
+
+// Shared driver for the CPU benchmarks (matrix, sparse, fib, fib_single,
+// fib_fast; pool_microbench uses the pool and statistics parts).
+//
+// with_pool() builds the pool for a mode name the same way every benchmark
+// always has (coro runs coroutines on a classic fixed pool); in coro mode
+// run_tasks_coro() and spawn_coro_task() replace pool.submit. repeat() runs
+// the warmup and timed repetitions and prints the "Run i:" lines; with
+// BENCH_CI set it keeps repeating past the requested reps until the 95%
+// confidence interval of the median is within that fraction of the median, or
+// BENCH_MAX_REPS / BENCH_MAX_SECONDS is hit (both only cap such adaptive
+// runs; without BENCH_CI exactly the requested reps run). Report prints the statistics
+// (Best/Avg as before, plus median, MAD, p5/p95 and the interval) and appends
+// one record per run of the binary to BENCH_JSON (JSON lines) and/or
+// BENCH_CSV, so runners read results instead of scraping stdout.
+//
+// The CSV has the same columns for every benchmark; benchmark-specific
+// values go into the packed params/metrics columns as key=value;key=value.
+
+#include "thread_pool.h"
+#include "coro_runtime.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+inline bool is_mode(const std::string& mode) {
+    return mode == "classic" || mode == "ws" || mode == "elastic" || mode == "advws" || mode == "coro";
+}
+
+// elastic and advws use min=threads, max=2*threads. Returns false for an
+// unknown mode without calling fn.
+template <typename Fn>
+bool with_pool(const std::string& mode, size_t threads, Fn&& fn) {
+    if (mode == "classic" || mode == "coro") {
+        ThreadPool pool(threads);
+        fn(pool);
+    } else if (mode == "ws") {
+        ThreadPool pool(threads, ThreadPool::PoolKind::WorkStealing);
+        fn(pool);
+    } else if (mode == "elastic") {
+        ThreadPool pool(threads, std::max<size_t>(threads * 2, size_t{1}));
+        fn(pool);
+    } else if (mode == "advws") {
+        ThreadPool pool(
+            threads,
+            std::max<size_t>(threads * 2, size_t{1}),
+            ThreadPool::PoolKind::AdvancedElasticStealing,
+            std::chrono::milliseconds(200));
+        fn(pool);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Runs fn on the pool from a detached coroutine; fork-join code spawns
+// through this in coro mode.
+inline coro::DetachedTask spawn_coro_task(coro::PoolScheduler sched, std::function<void()> fn) {
+    co_await sched.schedule();
+    fn();
+}
+
+namespace detail {
+
+template <typename Fn>
+coro::DetachedTask run_task_coro(const Fn& fn,
+                                 size_t t,
+                                 coro::PoolScheduler sched,
+                                 std::atomic<size_t>& done,
+                                 const size_t count,
+                                 std::mutex& m,
+                                 std::condition_variable& cv,
+                                 std::exception_ptr& ep,
+                                 std::mutex& ep_m) {
+    co_await sched.schedule();
+    try {
+        fn(t);
+    } catch (...) {
+        std::lock_guard<std::mutex> lk(ep_m);
+        if (!ep) {
+            ep = std::current_exception();
+        }
+    }
+
+    const size_t finished = done.fetch_add(1, std::memory_order_acq_rel) + 1;
+    if (finished == count) {
+        std::lock_guard<std::mutex> lk(m);
+        cv.notify_one();
+    }
+}
+
+}  // namespace detail
+
+// Coroutine counterpart of matmul::run_tasks for coro mode: one detached
+// coroutine per index. Blocks until all finish and rethrows the first
+// exception.
+template <typename Fn>
+void run_tasks_coro(ThreadPool& pool, size_t count, const Fn& fn) {
+    if (count == 0) return;
+
+    std::atomic<size_t> done{0};
+    std::mutex m;
+    std::condition_variable cv;
+    std::exception_ptr ep;
+    std::mutex ep_m;
+    coro::PoolScheduler sched(pool);
+
+    for (size_t t = 0; t < count; ++t) {
+        detail::run_task_coro(fn, t, sched, done, count, m, cv, ep, ep_m);
+    }
+
+    {
+        std::unique_lock<std::mutex> lk(m);
+        cv.wait(lk, [&] { return done.load(std::memory_order_acquire) == count; });
+    }
+
+    if (ep) {
+        std::rethrow_exception(ep);
+    }
+}
+
+struct RepeatOptions {
+    int warmup{1};
+    int min_reps{3};
+    int max_reps{3};
+    double target_rel_ci{0.0};  // 0: fixed min_reps repetitions
+    double max_seconds{0.0};    // budget for adaptive reps beyond min_reps; 0: none
+};
+
+inline double env_double(const char* name, double def) {
+    const char* raw = std::getenv(name);
+    if (raw == nullptr || *raw == '\0') return def;
+    try {
+        return std::stod(raw);
+    } catch (...) {
+        return def;
+    }
+}
+
+// warmup and reps come from the command line. BENCH_CI (e.g. 0.02) turns on
+// adaptive reps; BENCH_MAX_REPS (default 50) and BENCH_MAX_SECONDS bound them
+// and are ignored without BENCH_CI.
+inline RepeatOptions repeat_options(int warmup, int reps) {
+    RepeatOptions o;
+    o.warmup = warmup;
+    o.min_reps = reps;
+    o.max_reps = reps;
+    o.target_rel_ci = std::max(env_double("BENCH_CI", 0.0), 0.0);
+    o.max_seconds = std::max(env_double("BENCH_MAX_SECONDS", 0.0), 0.0);
+    if (o.target_rel_ci > 0.0) {
+        o.max_reps = std::max(reps, static_cast<int>(env_double("BENCH_MAX_REPS", 50.0)));
+    }
+    return o;
+}
+
+struct Stats {
+    size_t n{0};
+    double best{0.0};
+    double worst{0.0};
+    double mean{0.0};
+    double stddev{0.0};
+    double median{0.0};
+    double mad{0.0};  // median absolute deviation from the median (unscaled)
+    double p5{0.0};
+    double p95{0.0};
+    double ci95{0.0};  // half-width of the 95% confidence interval of the median
+};
+
+// Linear interpolation between order statistics of sorted xs.
+inline double quantile_sorted(const std::vector<double>& xs, double p) {
+    if (xs.empty()) return 0.0;
+    const double idx = p * static_cast<double>(xs.size() - 1);
+    const size_t lo = static_cast<size_t>(std::floor(idx));
+    const size_t hi = std::min(lo + 1, xs.size() - 1);
+    const double frac = idx - static_cast<double>(lo);
+    return xs[lo] * (1.0 - frac) + xs[hi] * frac;
+}
+
+inline Stats summarize(std::vector<double> xs) {
+    Stats s;
+    s.n = xs.size();
+    if (xs.empty()) return s;
+    std::sort(xs.begin(), xs.end());
+    s.best = xs.front();
+    s.worst = xs.back();
+    double sum = 0.0;
+    for (double x : xs) sum += x;
+    s.mean = sum / static_cast<double>(s.n);
+    if (s.n > 1) {
+        double sq = 0.0;
+        for (double x : xs) sq += (x - s.mean) * (x - s.mean);
+        s.stddev = std::sqrt(sq / static_cast<double>(s.n - 1));
+    }
+    // Distribution-free interval between order statistics (normal
+    // approximation of the binomial ranks), so a few preempted runs widen it
+    // only a little. Below ~6 runs it is the whole range.
+    const double n = static_cast<double>(s.n);
+    const double spread = 0.98 * std::sqrt(n);
+    const size_t lo = static_cast<size_t>(std::max(1.0, std::floor(n / 2.0 - spread)));
+    const size_t hi = static_cast<size_t>(std::min(n, std::ceil(n / 2.0 + 1.0 + spread)));
+    s.ci95 = (xs[hi - 1] - xs[lo - 1]) / 2.0;
+    s.median = quantile_sorted(xs, 0.5);
+    s.p5 = quantile_sorted(xs, 0.05);
+    s.p95 = quantile_sorted(xs, 0.95);
+    std::vector<double> dev;
+    dev.reserve(s.n);
+    for (double x : xs) dev.push_back(std::fabs(x - s.median));
+    std::sort(dev.begin(), dev.end());
+    s.mad = quantile_sorted(dev, 0.5);
+    return s;
+}
+
+struct Samples {
+    std::vector<double> runs;
+    int warmup{0};
+    std::string stop{"reps"};  // reps | ci | max_reps | time
+};
+
+// once() performs one repetition and returns its timed seconds; anything it
+// does outside the timed region (verification, say) is not counted. A
+// callback taking an int gets the timed rep index, or -1 during warmup.
+template <typename Fn>
+Samples repeat(const RepeatOptions& opt, Fn&& once, std::ostream& out = std::cout) {
+    auto call = [&](int rep) {
+        if constexpr (std::is_invocable_v<Fn&, int>) {
+            return once(rep);
+        } else {
+            return once();
+        }
+    };
+    Samples s;
+    s.warmup = opt.warmup;
+    for (int i = 0; i < opt.warmup; ++i) {
+        (void)call(-1);
+    }
+    const auto t0 = std::chrono::steady_clock::now();
+    while (true) {
+        const double t = call(static_cast<int>(s.runs.size()));
+        out << "Run " << s.runs.size() << ": " << t << " s\n";
+        s.runs.push_back(t);
+        const int n = static_cast<int>(s.runs.size());
+        if (n < opt.min_reps) continue;
+        if (opt.target_rel_ci <= 0.0) break;
+        if (n >= 3) {
+            const Stats st = summarize(s.runs);
+            if (st.median > 0.0 && st.ci95 <= opt.target_rel_ci * st.median) {
+                s.stop = "ci";
+                break;
+            }
+        }
+        if (n >= opt.max_reps) {
+            s.stop = "max_reps";
+            break;
+        }
+        if (opt.max_seconds > 0.0 &&
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() >= opt.max_seconds) {
+            s.stop = "time";
+            break;
+        }
+    }
+    return s;
+}
+
+inline std::string json_escape(const std::string& s) {
+    std::string out;
+    out.reserve(s.size() + 2);
+    out.push_back('"');
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out += ' ';
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+    return out;
+}
+
+inline std::string csv_escape(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"') out.push_back('"');
+        out.push_back(c);
+    }
+    out.push_back('"');
+    return out;
+}
+
+inline std::string format_seconds(double x) {
+    std::ostringstream oss;
+    oss.precision(9);
+    oss << x;
+    return oss.str();
+}
+
+class Report {
+public:
+    Report(std::string bench, std::string mode, size_t threads)
+        : bench_(std::move(bench)), mode_(std::move(mode)), threads_(threads) {}
+
+    template <typename T>
+    Report& param(const std::string& key, const T& value) {
+        params_.push_back(make_field(key, value));
+        return *this;
+    }
+
+    template <typename T>
+    Report& metric(const std::string& key, const T& value) {
+        metrics_.push_back(make_field(key, value));
+        return *this;
+    }
+
+    // Best/Avg keep their old format so existing scripts still parse them.
+    static void print(const Samples& s, std::ostream& out = std::cout) {
+        const Stats st = summarize(s.runs);
+        out << "Best: " << st.best << " s\n";
+        out << "Avg : " << st.mean << " s\n";
+        out << "Median: " << st.median << " s  MAD: " << st.mad << " s\n";
+        out << "P5/P95: " << st.p5 << " s / " << st.p95 << " s\n";
+        out << "CI95 (median): +/-" << st.ci95 << " s (" << (st.median > 0.0 ? 100.0 * st.ci95 / st.median : 0.0)
+            << "%) reps=" << st.n << " stop=" << s.stop << "\n";
+    }
+
+    // Prints the statistics and appends the record to BENCH_JSON / BENCH_CSV
+    // when set. Returns false if a file could not be written.
+    bool finish(const Samples& s, std::ostream& out = std::cout) const {
+        print(s, out);
+        return write(s);
+    }
+
+    // Appends the record without printing anything.
+    bool write(const Samples& s) const {
+        bool ok = true;
+        const char* json = std::getenv("BENCH_JSON");
+        if (json != nullptr && *json != '\0') ok = append_json(json, s) && ok;
+        const char* csv = std::getenv("BENCH_CSV");
+        if (csv != nullptr && *csv != '\0') ok = append_csv(csv, s) && ok;
+        if (!ok) std::cerr << "Failed to write BENCH_JSON/BENCH_CSV\n";
+        return ok;
+    }
+
+    static const char* csv_header() {
+        return "bench,mode,threads,warmup,reps,stop,best_s,mean_s,median_s,mad_s,p5_s,p95_s,stddev_s,"
+               "ci95_s,run_times_s,params,metrics";
+    }
+
+private:
+    struct Field {
+        std::string key;
+        std::string value;
+        bool quoted;
+    };
+
+    template <typename T>
+    static Field make_field(const std::string& key, const T& value) {
+        std::ostringstream oss;
+        if constexpr (std::is_same_v<T, bool>) {
+            oss << (value ? "true" : "false");
+            return {key, oss.str(), false};
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            oss.precision(12);
+            oss << value;
+            return {key, oss.str(), !std::isfinite(static_cast<double>(value))};
+        } else {
+            oss << value;
+            return {key, oss.str(), true};
+        }
+    }
+
+    static std::string json_object(const std::vector<Field>& fields) {
+        std::string out = "{";
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (i) out += ",";
+            out += json_escape(fields[i].key) + ":" +
+                   (fields[i].quoted ? json_escape(fields[i].value) : fields[i].value);
+        }
+        return out + "}";
+    }
+
+    static std::string packed(const std::vector<Field>& fields) {
+        std::string out;
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (i) out += ";";
+            out += fields[i].key + "=" + fields[i].value;
+        }
+        return out;
+    }
+
+    bool append_json(const char* path, const Samples& s) const {
+        const Stats st = summarize(s.runs);
+        std::ofstream f(path, std::ios::app);
+        f << "{\"bench\":" << json_escape(bench_) << ",\"mode\":" << json_escape(mode_)
+          << ",\"threads\":" << threads_ << ",\"params\":" << json_object(params_)
+          << ",\"stats\":{\"warmup\":" << s.warmup << ",\"reps\":" << st.n << ",\"stop\":" << json_escape(s.stop)
+          << ",\"best_s\":" << format_seconds(st.best) << ",\"mean_s\":" << format_seconds(st.mean)
+          << ",\"median_s\":" << format_seconds(st.median) << ",\"mad_s\":" << format_seconds(st.mad)
+          << ",\"p5_s\":" << format_seconds(st.p5) << ",\"p95_s\":" << format_seconds(st.p95)
+          << ",\"stddev_s\":" << format_seconds(st.stddev) << ",\"ci95_s\":" << format_seconds(st.ci95)
+          << "},\"runs_s\":[";
+        for (size_t i = 0; i < s.runs.size(); ++i) {
+            f << (i ? "," : "") << format_seconds(s.runs[i]);
+        }
+        f << "],\"metrics\":" << json_object(metrics_) << "}\n";
+        return static_cast<bool>(f);
+    }
+
+    bool append_csv(const char* path, const Samples& s) const {
+        const bool fresh = !std::ifstream(path).good() || std::ifstream(path).peek() == std::ifstream::traits_type::eof();
+        const Stats st = summarize(s.runs);
+        std::ofstream f(path, std::ios::app);
+        if (fresh) f << csv_header() << "\n";
+        std::string runs;
+        for (size_t i = 0; i < s.runs.size(); ++i) {
+            if (i) runs += ";";
+            runs += format_seconds(s.runs[i]);
+        }
+        const std::vector<std::string> row = {
+            bench_, mode_, std::to_string(threads_), std::to_string(s.warmup), std::to_string(st.n), s.stop,
+            format_seconds(st.best), format_seconds(st.mean), format_seconds(st.median), format_seconds(st.mad),
+            format_seconds(st.p5), format_seconds(st.p95), format_seconds(st.stddev), format_seconds(st.ci95),
+            runs, packed(params_), packed(metrics_)};
+        for (size_t i = 0; i < row.size(); ++i) {
+            f << (i ? "," : "") << csv_escape(row[i]);
+        }
+        f << "\n";
+        return static_cast<bool>(f);
+    }
+
+    std::string bench_;
+    std::string mode_;
+    size_t threads_;
+    std::vector<Field> params_;
+    std::vector<Field> metrics_;
+};
+
+}  // namespace bench
@@ -269,7 +269,7 @@ T sync_wait(Task<T> task) {
 
     auto waiter = [&]() -> Task<void> {
         try {
-            out = co_await task;
+            out = co_await std::move(task);
         } catch (...) {
             ep = std::current_exception();
         }
@@ -302,7 +302,7 @@ inline void sync_wait(Task<void> task) {
 
     auto waiter = [&]() -> Task<void> {
         try {
-            co_await task;
+            co_await std::move(task);
         } catch (...) {
             ep = std::current_exception();
         }
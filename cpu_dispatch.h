@@ -0,0 +1,166 @@
+#pragma once
+
+// Runtime CPU feature detection and one-time ISA selection for compute
+// kernels that ship in several instruction-set variants (matmul micro-kernels,
+// the busy-work hash loop).
+//
+// The variant is chosen once per process from cpuid, including the OS XSAVE
+// state check, so AVX/AVX-512 are only used when the kernel preserves their
+// registers. CPU_DISPATCH_ISA=portable|sse2|avx2|avx512 forces a variant for
+// A/B comparisons; a forced variant the CPU cannot run falls back to the best
+// supported one.
+
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define CPU_DISPATCH_X86 1
+#else
+#define CPU_DISPATCH_X86 0
+#endif
+
+namespace cpu {
+
+enum class Isa { Portable, Sse2, Avx2, Avx512 };
+
+struct Features {
+    bool sse2{false};
+    bool avx2{false};    // AVX2 + FMA with OS-enabled YMM state
+    bool avx512{false};  // AVX-512F with OS-enabled ZMM state
+};
+
+struct Dispatch {
+    Isa isa;
+    Isa best;
+    bool forced;
+    std::string requested;  // raw CPU_DISPATCH_ISA value, empty when unset
+};
+
+inline const char* isa_name(Isa isa) {
+    switch (isa) {
+        case Isa::Portable: return "portable";
+        case Isa::Sse2: return "sse2";
+        case Isa::Avx2: return "avx2";
+        case Isa::Avx512: return "avx512";
+    }
+    return "portable";
+}
+
+inline std::optional<Isa> parse_isa(std::string_view name) {
+    if (name == "portable") return Isa::Portable;
+    if (name == "sse2") return Isa::Sse2;
+    if (name == "avx2") return Isa::Avx2;
+    if (name == "avx512") return Isa::Avx512;
+    return std::nullopt;
+}
+
+inline Features detect_features() {
+    Features f;
+#if CPU_DISPATCH_X86
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return f;
+    }
+    f.sse2 = (edx & bit_SSE2) != 0;
+    const bool fma = (ecx & bit_FMA) != 0;
+
+    uint64_t xcr0 = 0;
+    if ((ecx & bit_OSXSAVE) != 0) {
+        uint32_t lo = 0, hi = 0;
+        __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        xcr0 = (static_cast<uint64_t>(hi) << 32) | lo;
+    }
+    const bool os_ymm = (xcr0 & 0x6) == 0x6;    // XMM + YMM
+    const bool os_zmm = (xcr0 & 0xe6) == 0xe6;  // + opmask, ZMM_Hi256, Hi16_ZMM
+
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        f.avx2 = os_ymm && fma && (ebx & bit_AVX2) != 0;
+        f.avx512 = os_zmm && (ebx & bit_AVX512F) != 0;
+    }
+#endif
+    return f;
+}
+
+inline const Features& features() {
+    static const Features f = detect_features();
+    return f;
+}
+
+inline bool supports(const Features& f, Isa isa) {
+    switch (isa) {
+        case Isa::Portable: return true;
+        case Isa::Sse2: return f.sse2;
+        case Isa::Avx2: return f.avx2;
+        case Isa::Avx512: return f.avx512;
+    }
+    return false;
+}
+
+inline Isa best_isa(const Features& f) {
+    if (f.avx512) return Isa::Avx512;
+    if (f.avx2) return Isa::Avx2;
+    if (f.sse2) return Isa::Sse2;
+    return Isa::Portable;
+}
+
+inline Dispatch make_dispatch(const Features& f, const char* requested) {
+    Dispatch d{best_isa(f), best_isa(f), false, requested != nullptr ? requested : ""};
+    if (d.requested.empty()) {
+        return d;
+    }
+    const std::optional<Isa> isa = parse_isa(d.requested);
+    if (isa && supports(f, *isa)) {
+        d.isa = *isa;
+        d.forced = true;
+    }
+    return d;
+}
+
+// Resolved on first use and fixed for the rest of the process.
+inline const Dispatch& dispatch() {
+    static const Dispatch d = make_dispatch(features(), std::getenv("CPU_DISPATCH_ISA"));
+    return d;
+}
+
+inline Isa selected_isa() {
+    return dispatch().isa;
+}
+
+// CPU brand string from cpuid leaves 0x80000002..4, or "unknown".
+inline std::string model_name() {
+    std::string out;
+#if CPU_DISPATCH_X86
+    unsigned regs[12] = {};
+    if (__get_cpuid_max(0x80000000, nullptr) >= 0x80000004) {
+        for (unsigned i = 0; i < 3; ++i) {
+            __get_cpuid(0x80000002 + i, &regs[4 * i], &regs[4 * i + 1], &regs[4 * i + 2], &regs[4 * i + 3]);
+        }
+        out.assign(reinterpret_cast<const char*>(regs), sizeof(regs));
+        const size_t nul = out.find('\0');
+        if (nul != std::string::npos) out.resize(nul);
+    }
+#endif
+    const size_t first = out.find_first_not_of(' ');
+    if (first == std::string::npos) {
+        return "unknown";
+    }
+    return out.substr(first, out.find_last_not_of(' ') - first + 1);
+}
+
+// One-line description for benchmark banners, e.g. "isa=avx2 (best=avx512, forced)".
+inline std::string describe_dispatch() {
+    const Dispatch& d = dispatch();
+    std::string out = std::string("isa=") + isa_name(d.isa) + " (best=" + isa_name(d.best);
+    if (d.forced) {
+        out += ", forced";
+    } else if (!d.requested.empty()) {
+        out += ", ignored CPU_DISPATCH_ISA=" + d.requested;
+    }
+    return out + ")";
+}
+
+}  // namespace cpu
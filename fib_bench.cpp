@@ -1,3 +1,4 @@
+#include "bench_harness.h"
 #include "thread_pool.h"
 #include "coro_runtime.h"
 
@@ -43,10 +44,71 @@ static uint64_t fib_task(unsigned n, unsigned split_threshold) {
     return fib_task(n - 1, split_threshold) + fib_task(n - 2, split_threshold);
 }
 
+// split_threshold argument: a number N, or "auto" / "auto:N". N is where the
+// recursion switches to the iterative fib, so it fixes the amount of work.
+// With auto, each task additionally asks the pool at every recursion step
+// whether to hand its right subtree to another worker (ThreadPool::should_spawn)
+// and recurses inline otherwise, so the same work spreads over idle workers.
+struct Cutoff {
+    unsigned threshold;
+    bool adaptive;
+};
+
+static Cutoff parse_cutoff(const std::string& s, unsigned def) {
+    if (s == "auto") return Cutoff{def, true};
+    if (s.rfind("auto:", 0) == 0) return Cutoff{static_cast<unsigned>(std::stoul(s.substr(5))), true};
+    return Cutoff{static_cast<unsigned>(std::stoul(s)), false};
+}
+
+// One top-level task in auto mode. fib_task(n) is the sum of fib_seq over the
+// leaves of its recursion, so pieces split off to other workers only add
+// their leaves into sum; the piece that drops outstanding to zero finishes
+// the task.
+struct AutoFib {
+    std::atomic<uint64_t> sum{0};
+    std::atomic<size_t> outstanding{1};
+    std::function<void(uint64_t)> on_done;
+};
+
+static std::atomic<uint64_t>& auto_spawned() {
+    static std::atomic<uint64_t> spawned{0};
+    return spawned;
+}
+
+template <typename Pool>
+static void fib_auto_piece(Pool& pool, AutoFib& t, unsigned n, unsigned threshold, unsigned depth);
+
+template <typename Pool>
+static uint64_t fib_auto_inline(Pool& pool, AutoFib& t, unsigned n, unsigned threshold, unsigned depth) {
+    uint64_t local = 0;
+    while (n > threshold) {
+        if (pool.should_spawn(depth)) {
+            t.outstanding.fetch_add(1, std::memory_order_relaxed);
+            auto_spawned().fetch_add(1, std::memory_order_relaxed);
+            const unsigned right = n - 2;
+            pool.submit([&pool, &t, right, threshold, depth] { fib_auto_piece(pool, t, right, threshold, depth + 1); });
+        } else {
+            local += fib_auto_inline(pool, t, n - 2, threshold, depth + 1);
+        }
+        --n;
+        ++depth;
+    }
+    return local + fib_seq(n);
+}
+
+template <typename Pool>
+static void fib_auto_piece(Pool& pool, AutoFib& t, unsigned n, unsigned threshold, unsigned depth) {
+    const uint64_t local = fib_auto_inline(pool, t, n, threshold, depth);
+    t.sum.fetch_add(local, std::memory_order_relaxed);
+    if (t.outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        t.on_done(t.sum.load(std::memory_order_relaxed));
+    }
+}
+
 template <typename Pool>
 static double fib_parallel_batch(Pool& pool,
                                  unsigned n,
-                                 unsigned split_threshold,
+                                 Cutoff cutoff,
                                  size_t tasks,
                                  uint64_t& checksum_out) {
     std::atomic<size_t> done{0};
@@ -54,18 +116,25 @@ static double fib_parallel_batch(Pool& pool,
     std::condition_variable cv;
 
     std::vector<uint64_t> out(tasks, 0);
+    std::vector<AutoFib> autos(cutoff.adaptive ? tasks : 0);
 
     auto t0 = Clock::now();
 
     for (size_t i = 0; i < tasks; ++i) {
-        pool.submit([&, i] {
-            out[i] = fib_task(n, split_threshold);
+        const auto finish = [&, i](uint64_t value) {
+            out[i] = value;
             const size_t finished = done.fetch_add(1, std::memory_order_acq_rel) + 1;
             if (finished == tasks) {
                 std::lock_guard<std::mutex> lk(m);
                 cv.notify_one();
             }
-        });
+        };
+        if (cutoff.adaptive) {
+            autos[i].on_done = finish;
+            pool.submit([&, i] { fib_auto_piece(pool, autos[i], n, cutoff.threshold, 0); });
+        } else {
+            pool.submit([&, finish] { finish(fib_task(n, cutoff.threshold)); });
+        }
     }
 
     {
@@ -78,7 +147,7 @@ static double fib_parallel_batch(Pool& pool,
 }
 
 static coro::DetachedTask fib_task_coro(unsigned n,
-                                        unsigned split_threshold,
+                                        Cutoff cutoff,
                                         size_t idx,
                                         std::vector<uint64_t>& out,
                                         coro::PoolScheduler sched,
@@ -87,10 +156,24 @@ static coro::DetachedTask fib_task_coro(unsigned n,
                                         std::mutex& m,
                                         std::condition_variable& cv,
                                         std::exception_ptr& ep,
-                                        std::mutex& ep_m) {
+                                        std::mutex& ep_m,
+                                        ThreadPool& pool,
+                                        AutoFib* auto_fib) {
     co_await sched.schedule();
+    if (auto_fib != nullptr) {
+        // Pieces run as plain pool tasks; the last one finishes this task.
+        auto_fib->on_done = [&out, idx, &done, tasks, &m, &cv](uint64_t value) {
+            out[idx] = value;
+            if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == tasks) {
+                std::lock_guard<std::mutex> lk(m);
+                cv.notify_one();
+            }
+        };
+        fib_auto_piece(pool, *auto_fib, n, cutoff.threshold, 0);
+        co_return;
+    }
     try {
-        out[idx] = fib_task(n, split_threshold);
+        out[idx] = fib_task(n, cutoff.threshold);
     } catch (...) {
         std::lock_guard<std::mutex> lk(ep_m);
         if (!ep) {
@@ -107,7 +190,7 @@ static coro::DetachedTask fib_task_coro(unsigned n,
 
 static double fib_coroutine_batch(ThreadPool& pool,
                                   unsigned n,
-                                  unsigned split_threshold,
+                                  Cutoff cutoff,
                                   size_t tasks,
                                   uint64_t& checksum_out) {
     std::atomic<size_t> done{0};
@@ -117,11 +200,13 @@ static double fib_coroutine_batch(ThreadPool& pool,
     std::exception_ptr ep;
     std::mutex ep_m;
     coro::PoolScheduler sched(pool);
+    std::vector<AutoFib> autos(cutoff.adaptive ? tasks : 0);
 
     const auto t0 = Clock::now();
 
     for (size_t i = 0; i < tasks; ++i) {
-        fib_task_coro(n, split_threshold, i, out, sched, done, tasks, m, cv, ep, ep_m);
+        fib_task_coro(n, cutoff, i, out, sched, done, tasks, m, cv, ep, ep_m, pool,
+                      cutoff.adaptive ? &autos[i] : nullptr);
     }
 
     {
@@ -140,16 +225,19 @@ static double fib_coroutine_batch(ThreadPool& pool,
 static void usage(const char* prog) {
     std::cerr
         << "Usage:\n  " << prog
-        << " <pool: classic|elastic|ws|advws|coro> <fib_n> <threads> <warmup> <reps> [tasks] [split_threshold]\n\n"
+        << " <pool: classic|elastic|ws|advws|coro> <fib_n> <threads> <warmup> <reps> [tasks]"
+           " [split_threshold|auto|auto:N]\n\n"
         << "Examples:\n"
         << "  " << prog << " classic 44 8 1 3\n"
         << "  " << prog << " ws      44 8 1 3\n"
         << "  " << prog << " elastic 44 8 1 3 8 32\n"
         << "  " << prog << " advws   44 8 1 3 8 32\n"
-        << "  " << prog << " coro    44 8 1 3 8 32\n\n"
+        << "  " << prog << " coro    44 8 1 3 8 32\n"
+        << "  " << prog << " ws      44 8 1 3 2 auto\n\n"
         << "Defaults:\n"
         << "  tasks = threads\n"
-        << "  split_threshold = 32 (switch to iterative fib)\n";
+        << "  split_threshold = 32 (switch to iterative fib)\n"
+        << "  auto = same cutoff, subtrees handed to idle workers on demand\n";
 }
 
 int main(int argc, char** argv) {
@@ -165,8 +253,8 @@ int main(int argc, char** argv) {
         const int warmup = std::stoi(argv[4]);
         const int reps = std::stoi(argv[5]);
         const size_t tasks = (argc >= 7) ? std::stoul(argv[6]) : threads;
-        const unsigned split_threshold = (argc >= 8) ? static_cast<unsigned>(std::stoul(argv[7])) : 32U;
-        const uint64_t fib_value = fib_task(fib_n, split_threshold);
+        const Cutoff cutoff = parse_cutoff((argc >= 8) ? argv[7] : "32", 32U);
+        const uint64_t fib_value = fib_seq(fib_n);
 
         if (threads == 0 || tasks == 0 || reps <= 0 || warmup < 0) {
             std::cerr << "Invalid args: threads/tasks must be > 0, reps > 0, warmup >= 0\n";
@@ -181,70 +269,45 @@ int main(int argc, char** argv) {
                   << " warmup=" << warmup
                   << " reps=" << reps
                   << " tasks=" << tasks
-                  << " split_threshold=" << split_threshold
+                  << " split_threshold=" << (cutoff.adaptive ? "auto:" : "") << cutoff.threshold
                   << "\n";
 
-        double best = 1e100;
-        double sum = 0.0;
         uint64_t last_checksum = 0;
-
-        auto run_pool = [&](auto& pool) {
-            for (int i = 0; i < warmup; ++i) {
-                uint64_t discard = 0;
-                (void)fib_parallel_batch(pool, fib_n, split_threshold, tasks, discard);
-            }
-
-            for (int r = 0; r < reps; ++r) {
-                uint64_t checksum = 0;
-                const double t = fib_parallel_batch(pool, fib_n, split_threshold, tasks, checksum);
-                best = std::min(best, t);
-                sum += t;
-                last_checksum = checksum;
-                std::cout << "Run " << r << ": " << t << " s\n";
-            }
-        };
-
-        if (pool_kind == "classic") {
-            ThreadPool pool(threads);
-            run_pool(pool);
-        } else if (pool_kind == "ws") {
-            ThreadPool pool(threads, ThreadPool::PoolKind::WorkStealing);
-            run_pool(pool);
-        } else if (pool_kind == "elastic") {
-            ThreadPool pool(threads, std::max<size_t>(threads * 2, size_t{1}));
-            run_pool(pool);
-        } else if (pool_kind == "advws") {
-            ThreadPool pool(
-                threads,
-                std::max<size_t>(threads * 2, size_t{1}),
-                ThreadPool::PoolKind::AdvancedElasticStealing,
-                std::chrono::milliseconds(200));
-            run_pool(pool);
-        } else if (pool_kind == "coro") {
-            ThreadPool pool(threads);
-            for (int i = 0; i < warmup; ++i) {
-                uint64_t discard = 0;
-                (void)fib_coroutine_batch(pool, fib_n, split_threshold, tasks, discard);
-            }
-            for (int r = 0; r < reps; ++r) {
-                uint64_t checksum = 0;
-                const double t = fib_coroutine_batch(pool, fib_n, split_threshold, tasks, checksum);
-                best = std::min(best, t);
-                sum += t;
-                last_checksum = checksum;
-                std::cout << "Run " << r << ": " << t << " s\n";
-            }
-        } else {
+        bench::Samples samples;
+        const bool known = bench::with_pool(pool_kind, threads, [&](ThreadPool& pool) {
+            samples = bench::repeat(bench::repeat_options(warmup, reps), [&] {
+                return pool_kind == "coro" ? fib_coroutine_batch(pool, fib_n, cutoff, tasks, last_checksum)
+                                           : fib_parallel_batch(pool, fib_n, cutoff, tasks, last_checksum);
+            });
+        });
+        if (!known) {
             std::cerr << "Unknown pool kind: " << pool_kind << "\n";
             usage(argv[0]);
             return 1;
         }
 
-        std::cout << "Best: " << best << " s\n";
-        std::cout << "Avg : " << (sum / reps) << " s\n";
+        bench::Report report("fib", pool_kind, threads);
+        report.param("fib_n", fib_n)
+            .param("tasks", tasks)
+            .param("split_threshold", cutoff.threshold)
+            .param("adaptive", cutoff.adaptive);
+        report.metric("fib_value", fib_value)
+            .metric("checksum", last_checksum)
+            .metric("expected_checksum", fib_value * tasks);
+        const uint64_t runs = static_cast<uint64_t>(warmup) + samples.runs.size();
+        if (cutoff.adaptive) {
+            report.metric("spawned_subtrees_per_run", auto_spawned().load() / runs);
+        }
+        const bool written = report.finish(samples);
         std::cout << "Fib(" << fib_n << "): " << fib_value << "\n";
         std::cout << "Checksum: " << last_checksum << "\n";
         std::cout << "Expected checksum: " << (fib_value * tasks) << "\n";
+        if (cutoff.adaptive) {
+            std::cout << "Spawned subtrees per run: " << auto_spawned().load() / runs << "\n";
+        }
+        if (!written) {
+            return 1;
+        }
 
     } catch (const std::exception& ex) {
         std::cerr << "Argument parse error: " << ex.what() << "\n";
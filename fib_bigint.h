@@ -0,0 +1,346 @@
+#pragma once
+
+// Arbitrary-precision Fibonacci by fast doubling.
+//
+// Naturals are little-endian vectors of 64-bit limbs without high zero limbs
+// (empty is zero). Each doubling step
+//
+//   F(2k)   = F(k) * (2 F(k+1) - F(k))
+//   F(2k+1) = F(k)^2 + F(k+1)^2
+//
+// needs three products of about the same size, which dominate the run time:
+// F(n) has ~0.694 n bits, so the last steps for F(10^6) multiply ~5400-limb
+// operands. Products use Karatsuba down to kBaseLimbs and schoolbook below.
+//
+// ParallelMultiplier runs the three products of a step concurrently and forks
+// each Karatsuba node's three sub-products as tasks while operands are at
+// least par_limbs long. As in matmul_recursive.h, tasks never block: every
+// node carries a pending child counter and a parent pointer, and the child
+// that finishes last combines the node's partial products and completes it
+// towards its parent. Only the caller of multiply() waits. The task sizes
+// shrink geometrically with depth and differ per step, which makes this an
+// uneven, allocation-heavy workload for the pools.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace bigint {
+
+using Limb = uint64_t;
+using Natural = std::vector<Limb>;
+
+constexpr size_t kBaseLimbs = 32;
+
+inline void normalize(Natural& x) {
+    while (!x.empty() && x.back() == 0) x.pop_back();
+}
+
+inline size_t bit_length(const Natural& x) {
+    if (x.empty()) return 0;
+    return 64 * (x.size() - 1) + (64 - static_cast<size_t>(__builtin_clzll(x.back())));
+}
+
+// r[0, an) = a[0, an) + b[0, bn) with an >= bn; returns the carry out.
+inline Limb add(Limb* r, const Limb* a, size_t an, const Limb* b, size_t bn) {
+    Limb carry = 0;
+    for (size_t i = 0; i < an; ++i) {
+        const unsigned __int128 s = static_cast<unsigned __int128>(a[i]) + (i < bn ? b[i] : 0) + carry;
+        r[i] = static_cast<Limb>(s);
+        carry = static_cast<Limb>(s >> 64);
+    }
+    return carry;
+}
+
+// r[0, rn) += a[0, an) with rn >= an; returns the carry out of r.
+inline Limb add_into(Limb* r, size_t rn, const Limb* a, size_t an) {
+    Limb carry = 0;
+    size_t i = 0;
+    for (; i < an; ++i) {
+        const unsigned __int128 s = static_cast<unsigned __int128>(r[i]) + a[i] + carry;
+        r[i] = static_cast<Limb>(s);
+        carry = static_cast<Limb>(s >> 64);
+    }
+    for (; carry != 0 && i < rn; ++i) carry = ++r[i] == 0 ? 1 : 0;
+    return carry;
+}
+
+// r[0, rn) -= a[0, an) with rn >= an; returns the borrow out of r.
+inline Limb sub_into(Limb* r, size_t rn, const Limb* a, size_t an) {
+    Limb borrow = 0;
+    size_t i = 0;
+    for (; i < an; ++i) {
+        const Limb ri = r[i];
+        const Limb d = ri - a[i] - borrow;
+        borrow = (ri < a[i] || (ri == a[i] && borrow != 0)) ? 1 : 0;
+        r[i] = d;
+    }
+    for (; borrow != 0 && i < rn; ++i) borrow = r[i]-- == 0 ? 1 : 0;
+    return borrow;
+}
+
+// r[0, an + bn) = a * b. r must not overlap a or b.
+inline void mul_basecase(Limb* r, const Limb* a, size_t an, const Limb* b, size_t bn) {
+    std::fill(r, r + an + bn, Limb{0});
+    for (size_t i = 0; i < an; ++i) {
+        Limb carry = 0;
+        for (size_t j = 0; j < bn; ++j) {
+            const unsigned __int128 t = static_cast<unsigned __int128>(a[i]) * b[j] + r[i + j] + carry;
+            r[i + j] = static_cast<Limb>(t);
+            carry = static_cast<Limb>(t >> 64);
+        }
+        r[i + bn] = carry;
+    }
+}
+
+// Karatsuba split of an n-limb product: low halves of h limbs, high halves
+// of l = n - h limbs, and the (h + 1)-limb half sums feeding the middle term.
+struct KaratsubaSplit {
+    size_t n, h, l;
+    Natural sa, sb;  // a0 + a1, b0 + b1
+    Natural z1;      // (a0 + a1)(b0 + b1), 2h + 2 limbs
+
+    KaratsubaSplit(const Limb* a, const Limb* b, size_t nn)
+        : n(nn), h((nn + 1) / 2), l(nn - (nn + 1) / 2), sa(h + 1), sb(h + 1), z1(2 * h + 2) {
+        sa[h] = add(sa.data(), a, h, a + h, l);
+        sb[h] = add(sb.data(), b, h, b + h, l);
+    }
+
+    // r holds z0 = a0 b0 in [0, 2h) and z2 = a1 b1 in [2h, 2n); adds
+    // (z1 - z0 - z2) << 64h. The middle term fits below 2n - h limbs, so any
+    // higher limbs of z1 are zero after the subtractions.
+    void combine(Limb* r) {
+        (void)sub_into(z1.data(), z1.size(), r, 2 * h);
+        (void)sub_into(z1.data(), z1.size(), r + 2 * h, 2 * l);
+        (void)add_into(r + h, 2 * n - h, z1.data(), std::min(z1.size(), 2 * n - h));
+    }
+};
+
+// r[0, 2n) = a[0, n) * b[0, n).
+inline void mul_karatsuba(Limb* r, const Limb* a, const Limb* b, size_t n) {
+    if (n <= kBaseLimbs) {
+        mul_basecase(r, a, n, b, n);
+        return;
+    }
+    KaratsubaSplit s(a, b, n);
+    mul_karatsuba(r, a, b, s.h);
+    mul_karatsuba(r + 2 * s.h, a + s.h, b + s.h, s.l);
+    mul_karatsuba(s.z1.data(), s.sa.data(), s.sb.data(), s.h + 1);
+    s.combine(r);
+}
+
+// Both operands zero-padded to the longer length, so every product is a
+// balanced n x n Karatsuba; fast-doubling operands differ by at most a limb.
+struct Padded {
+    Natural a, b;
+    size_t n;
+
+    Padded(const Natural& x, const Natural& y) : a(x), b(y), n(std::max(x.size(), y.size())) {
+        a.resize(n, 0);
+        b.resize(n, 0);
+    }
+};
+
+inline Natural mul(const Natural& x, const Natural& y) {
+    if (x.empty() || y.empty()) return {};
+    const Padded p(x, y);
+    Natural r(2 * p.n);
+    mul_karatsuba(r.data(), p.a.data(), p.b.data(), p.n);
+    normalize(r);
+    return r;
+}
+
+inline Natural plus(const Natural& x, const Natural& y) {
+    const Natural& big = x.size() >= y.size() ? x : y;
+    const Natural& small = x.size() >= y.size() ? y : x;
+    Natural r(big.size() + 1);
+    r.back() = add(r.data(), big.data(), big.size(), small.data(), small.size());
+    normalize(r);
+    return r;
+}
+
+// 2 y - x, for 2 y >= x.
+inline Natural twice_minus(const Natural& y, const Natural& x) {
+    Natural r(y.size() + 1);
+    r.back() = add(r.data(), y.data(), y.size(), y.data(), y.size());
+    (void)sub_into(r.data(), r.size(), x.data(), x.size());
+    normalize(r);
+    return r;
+}
+
+struct MulJob {
+    const Natural* a;
+    const Natural* b;
+    Natural* out;
+};
+
+// F(n) with the three products of each doubling step handed to
+// mul_all(std::vector<MulJob>&), which must fill every out before returning.
+template <typename MulAll>
+Natural fib(uint64_t n, MulAll&& mul_all) {
+    Natural a;        // F(k)
+    Natural b{1};     // F(k + 1)
+    std::vector<MulJob> jobs(3);
+    for (int bit = 63 - (n == 0 ? 63 : __builtin_clzll(n)); n != 0 && bit >= 0; --bit) {
+        const Natural t = twice_minus(b, a);
+        Natural c, aa, bb;
+        jobs[0] = MulJob{&a, &t, &c};
+        jobs[1] = MulJob{&a, &a, &aa};
+        jobs[2] = MulJob{&b, &b, &bb};
+        mul_all(jobs);
+        Natural d = plus(aa, bb);
+        if ((n >> bit) & 1U) {
+            b = plus(c, d);
+            a = std::move(d);
+        } else {
+            a = std::move(c);
+            b = std::move(d);
+        }
+    }
+    return a;
+}
+
+inline Natural fib_serial(uint64_t n) {
+    return fib(n, [](std::vector<MulJob>& jobs) {
+        for (MulJob& j : jobs) *j.out = mul(*j.a, *j.b);
+    });
+}
+
+// F(n) mod m for m < 2^63 by the same recurrence, to check big results.
+inline uint64_t fib_mod(uint64_t n, uint64_t m) {
+    uint64_t a = 0, b = 1 % m;
+    for (int bit = 63; bit >= 0; --bit) {
+        const uint64_t t = (2 * b + m - a) % m;
+        const uint64_t c = static_cast<uint64_t>(static_cast<unsigned __int128>(a) * t % m);
+        const uint64_t d = static_cast<uint64_t>(
+            (static_cast<unsigned __int128>(a) * a + static_cast<unsigned __int128>(b) * b) % m);
+        if ((n >> bit) & 1U) {
+            a = d;
+            b = (c + d) % m;
+        } else {
+            a = c;
+            b = d;
+        }
+    }
+    return a;
+}
+
+inline uint64_t mod(const Natural& x, uint64_t m) {
+    unsigned __int128 r = 0;
+    for (size_t i = x.size(); i-- > 0;) r = ((r << 64) | x[i]) % m;
+    return static_cast<uint64_t>(r);
+}
+
+// spawn(std::function<void()>) must run the function asynchronously, e.g. by
+// submitting it to a pool or resuming a coroutine on one.
+template <typename Spawn>
+class ParallelMultiplier {
+public:
+    ParallelMultiplier(Spawn spawn, size_t par_limbs)
+        : spawn_(std::move(spawn)), par_limbs_(std::max(par_limbs, kBaseLimbs + 1)) {}
+
+    // Fills every job's out; all products run concurrently. Blocks the caller,
+    // which must not be a worker of the pool behind spawn.
+    void multiply(std::vector<MulJob>& jobs) {
+        std::vector<Padded> padded;
+        padded.reserve(jobs.size());
+        for (MulJob& j : jobs) {
+            padded.emplace_back(*j.a, *j.b);
+            j.out->assign(2 * padded.back().n, 0);
+        }
+
+        done_ = false;
+        auto root = std::make_shared<Node>(nullptr);
+        // Notify under the lock: the caller may destroy the multiplier as
+        // soon as multiply() returns.
+        root->then = [this](const NodePtr&) {
+            std::lock_guard<std::mutex> lk(done_mutex_);
+            done_ = true;
+            done_cv_.notify_one();
+        };
+        size_t live = 0;
+        for (size_t i = 0; i < jobs.size(); ++i) live += padded[i].n != 0 ? 1 : 0;
+        if (live == 0) {
+            for (MulJob& j : jobs) j.out->clear();
+            return;
+        }
+        root->pending.store(static_cast<int>(live), std::memory_order_relaxed);
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            if (padded[i].n == 0) continue;
+            fork(root, padded[i].a.data(), padded[i].b.data(), padded[i].n, jobs[i].out->data());
+        }
+
+        {
+            std::unique_lock<std::mutex> lk(done_mutex_);
+            done_cv_.wait(lk, [&] { return done_; });
+        }
+        for (MulJob& j : jobs) normalize(*j.out);
+    }
+
+    // Tasks spawned since construction.
+    size_t tasks_spawned() const { return tasks_.load(std::memory_order_relaxed); }
+
+private:
+    struct Node;
+    using NodePtr = std::shared_ptr<Node>;
+    using Job = std::function<void(const NodePtr&)>;
+
+    struct Node {
+        explicit Node(NodePtr p) : parent(std::move(p)) {}
+
+        NodePtr parent;
+        std::atomic<int> pending{0};
+        Job then;  // runs once pending reaches zero
+        std::unique_ptr<KaratsubaSplit> split;
+    };
+
+    void fork(const NodePtr& parent, const Limb* a, const Limb* b, size_t n, Limb* r) {
+        tasks_.fetch_add(1, std::memory_order_relaxed);
+        auto child = std::make_shared<Node>(parent);
+        spawn_([this, child, a, b, n, r] { run(child, a, b, n, r); });
+    }
+
+    // r[0, 2n) = a * b as node self.
+    void run(const NodePtr& self, const Limb* a, const Limb* b, size_t n, Limb* r) {
+        if (n < par_limbs_) {
+            mul_karatsuba(r, a, b, n);
+            finish(self);
+            return;
+        }
+        self->split = std::make_unique<KaratsubaSplit>(a, b, n);
+        KaratsubaSplit& s = *self->split;
+        self->then = [this, r](const NodePtr& node) {
+            node->split->combine(r);
+            node->split.reset();
+            finish(node);
+        };
+        self->pending.store(3, std::memory_order_relaxed);
+        fork(self, a, b, s.h, r);
+        fork(self, a + s.h, b + s.h, s.l, r + 2 * s.h);
+        fork(self, s.sa.data(), s.sb.data(), s.h + 1, s.z1.data());
+    }
+
+    void finish(const NodePtr& node) {
+        NodePtr parent = node->parent;
+        if (parent->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            Job then = std::move(parent->then);
+            then(parent);
+        }
+    }
+
+    Spawn spawn_;
+    size_t par_limbs_;
+    std::atomic<size_t> tasks_{0};
+    std::mutex done_mutex_;
+    std::condition_variable done_cv_;
+    bool done_{false};
+};
+
+}  // namespace bigint
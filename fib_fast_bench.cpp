@@ -16,19 +16,27 @@ Args:
 3rd: threads
 4th: warmup runs
 5th: timed runs
-6th optional: tasks per run (default = threads)
+6th optional: tasks per run (default = threads), or "big"
+
+With "big", each run computes one arbitrary-precision F(fib_n) (e.g. 1000000)
+by fast doubling, with the Karatsuba sub-products forked onto the pool (see
+fib_bigint.h). FIB_BIG_PAR_LIMBS (default 256) is the smallest operand, in
+64-bit limbs, whose sub-products are still forked as tasks.
 */
 
+#include "bench_harness.h"
 #include "thread_pool.h"
 #include "coro_runtime.h"
+#include "fib_bigint.h"
 
 #include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <cstdint>
+#include <cstdlib>
 #include <exception>
-#include <exception>
+#include <functional>
 #include <iostream>
 #include <mutex>
 #include <numeric>
@@ -159,16 +167,79 @@ static double fib_coroutine_batch(ThreadPool& pool,
     return seconds_since(t0);
 }
 
+static size_t big_par_limbs_from_env() {
+    const char* raw = std::getenv("FIB_BIG_PAR_LIMBS");
+    if (raw == nullptr || *raw == '\0') return 256;
+    try {
+        return std::max<size_t>(std::stoul(raw), 1);
+    } catch (...) {
+        return 256;
+    }
+}
+
+// One big F(n). The three products of every doubling step run concurrently
+// and fork their Karatsuba sub-products; the step's additions run on the
+// calling thread between them.
+template <typename Spawn>
+static double fib_big_once(Spawn spawn, uint64_t n, size_t par_limbs, bigint::Natural& out, size_t& tasks_out) {
+    const auto t0 = Clock::now();
+    bigint::ParallelMultiplier<Spawn> par(std::move(spawn), par_limbs);
+    out = bigint::fib(n, [&par](std::vector<bigint::MulJob>& jobs) { par.multiply(jobs); });
+    tasks_out = par.tasks_spawned();
+    return seconds_since(t0);
+}
+
 static void usage(const char* prog) {
     std::cerr
         << "Usage:\n  " << prog
-        << " <pool: classic|elastic|ws|advws|coro> <fib_n> <threads> <warmup> <reps> [tasks]\n\n"
+        << " <pool: classic|elastic|ws|advws|coro> <fib_n> <threads> <warmup> <reps> [tasks|big]\n\n"
         << "Examples:\n"
         << "  " << prog << " classic 90 8 1 3\n"
         << "  " << prog << " ws      90 8 1 3\n"
         << "  " << prog << " elastic 90 8 1 3\n"
         << "  " << prog << " advws   90 8 1 3\n"
-        << "  " << prog << " coro    90 8 1 3\n";
+        << "  " << prog << " coro    90 8 1 3\n"
+        << "  " << prog << " ws      1000000 8 1 3 big\n";
+}
+
+static bool run_big(const std::string& pool_kind, uint64_t fib_n, size_t threads, int warmup, int reps) {
+    const size_t par_limbs = big_par_limbs_from_env();
+    std::cout << "Fibonacci benchmark (big-integer fast doubling, parallel Karatsuba)\n"
+              << "pool=" << pool_kind
+              << " fib_n=" << fib_n
+              << " threads=" << threads
+              << " warmup=" << warmup
+              << " reps=" << reps
+              << " par_limbs=" << par_limbs << "\n";
+
+    bigint::Natural value;
+    size_t tasks = 0;
+    bench::Samples samples;
+    bench::with_pool(pool_kind, threads, [&](ThreadPool& pool) {
+        samples = bench::repeat(bench::repeat_options(warmup, reps), [&] {
+            if (pool_kind == "coro") {
+                auto spawn = [sched = coro::PoolScheduler(pool)](std::function<void()> fn) {
+                    bench::spawn_coro_task(sched, std::move(fn));
+                };
+                return fib_big_once(spawn, fib_n, par_limbs, value, tasks);
+            }
+            auto spawn = [&pool](std::function<void()> fn) { pool.submit(std::move(fn)); };
+            return fib_big_once(spawn, fib_n, par_limbs, value, tasks);
+        });
+    });
+
+    // Independent check: F(n) mod 2^61 - 1 by the same recurrence in 64 bits.
+    const uint64_t p = (uint64_t{1} << 61) - 1;
+    const bool ok = bigint::mod(value, p) == bigint::fib_mod(fib_n, p);
+    bench::Report report("fib_fast", pool_kind, threads);
+    report.param("fib_n", fib_n).param("variant", "big").param("par_limbs", par_limbs);
+    report.metric("bits", bigint::bit_length(value)).metric("tasks_per_run", tasks).metric("check_ok", ok);
+    const bool written = report.finish(samples);
+    std::cout << "Bits: " << bigint::bit_length(value) << "\n";
+    std::cout << "Limbs: " << value.size() << "\n";
+    std::cout << "Tasks per run: " << tasks << "\n";
+    std::cout << "Check mod 2^61-1: " << (ok ? "ok" : "FAILED") << "\n";
+    return ok && written;
 }
 
 int main(int argc, char** argv) {
@@ -183,12 +254,21 @@ int main(int argc, char** argv) {
         const size_t threads = std::stoul(argv[3]);
         const int warmup = std::stoi(argv[4]);
         const int reps = std::stoi(argv[5]);
-        const size_t tasks = (argc >= 7) ? std::stoul(argv[6]) : threads;
+        const bool big = argc >= 7 && std::string(argv[6]) == "big";
+        const size_t tasks = (argc >= 7 && !big) ? std::stoul(argv[6]) : threads;
 
         if (threads == 0 || tasks == 0 || reps <= 0 || warmup < 0) {
             std::cerr << "Invalid args: threads/tasks must be > 0, reps > 0, warmup >= 0\n";
             return 1;
         }
+        if (!bench::is_mode(pool_kind)) {
+            std::cerr << "Unknown pool kind: " << pool_kind << "\n";
+            usage(argv[0]);
+            return 1;
+        }
+        if (big) {
+            return run_big(pool_kind, fib_n, threads, warmup, reps) ? 0 : 1;
+        }
         if (fib_n > 93) {
             std::cerr << "fib_n must be <= 93 for uint64_t exactness\n";
             return 1;
@@ -205,66 +285,27 @@ int main(int argc, char** argv) {
                   << " reps=" << reps
                   << " tasks=" << tasks << "\n";
 
-        double best = 1e100;
-        double sum = 0.0;
         uint64_t last_checksum = 0;
+        bench::Samples samples;
+        bench::with_pool(pool_kind, threads, [&](ThreadPool& pool) {
+            samples = bench::repeat(bench::repeat_options(warmup, reps), [&] {
+                return pool_kind == "coro" ? fib_coroutine_batch(pool, fib_n, tasks, last_checksum)
+                                           : fib_parallel_batch(pool, fib_n, tasks, last_checksum);
+            });
+        });
 
-        auto run_pool = [&](auto& pool) {
-            for (int i = 0; i < warmup; ++i) {
-                uint64_t discard = 0;
-                (void)fib_parallel_batch(pool, fib_n, tasks, discard);
-            }
-            for (int r = 0; r < reps; ++r) {
-                uint64_t checksum = 0;
-                const double t = fib_parallel_batch(pool, fib_n, tasks, checksum);
-                best = std::min(best, t);
-                sum += t;
-                last_checksum = checksum;
-                std::cout << "Run " << r << ": " << t << " s\n";
-            }
-        };
-
-        if (pool_kind == "classic") {
-            ThreadPool pool(threads);
-            run_pool(pool);
-        } else if (pool_kind == "ws") {
-            ThreadPool pool(threads, ThreadPool::PoolKind::WorkStealing);
-            run_pool(pool);
-        } else if (pool_kind == "elastic") {
-            ThreadPool pool(threads, std::max<size_t>(threads * 2, size_t{1}));
-            run_pool(pool);
-        } else if (pool_kind == "advws") {
-            ThreadPool pool(
-                threads,
-                std::max<size_t>(threads * 2, size_t{1}),
-                ThreadPool::PoolKind::AdvancedElasticStealing,
-                std::chrono::milliseconds(200));
-            run_pool(pool);
-        } else if (pool_kind == "coro") {
-            ThreadPool pool(threads);
-            for (int i = 0; i < warmup; ++i) {
-                uint64_t discard = 0;
-                (void)fib_coroutine_batch(pool, fib_n, tasks, discard);
-            }
-            for (int r = 0; r < reps; ++r) {
-                uint64_t checksum = 0;
-                const double t = fib_coroutine_batch(pool, fib_n, tasks, checksum);
-                best = std::min(best, t);
-                sum += t;
-                last_checksum = checksum;
-                std::cout << "Run " << r << ": " << t << " s\n";
-            }
-        } else {
-            std::cerr << "Unknown pool kind: " << pool_kind << "\n";
-            usage(argv[0]);
-            return 1;
-        }
-
-        std::cout << "Best: " << best << " s\n";
-        std::cout << "Avg : " << (sum / reps) << " s\n";
+        bench::Report report("fib_fast", pool_kind, threads);
+        report.param("fib_n", fib_n).param("tasks", tasks);
+        report.metric("fib_value", fib_value)
+            .metric("checksum", last_checksum)
+            .metric("expected_checksum", fib_value * tasks);
+        const bool written = report.finish(samples);
         std::cout << "Fib(" << fib_n << "): " << fib_value << "\n";
         std::cout << "Checksum: " << last_checksum << "\n";
         std::cout << "Expected checksum: " << (fib_value * tasks) << "\n";
+        if (!written) {
+            return 1;
+        }
 
     } catch (const std::exception& ex) {
         std::cerr << "Argument parse error: " << ex.what() << "\n";
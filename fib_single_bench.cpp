@@ -16,9 +16,11 @@ Args:
 3rd: threads
 4th: warmup runs
 5th: timed runs
-6th optional: split_threshold (default 30)
+6th optional: split_threshold (default 30), or auto / auto:N (arena nodes only)
+7th optional: node allocation (arena|shared, default arena)
 */
 
+#include "bench_harness.h"
 #include "thread_pool.h"
 #include "coro_runtime.h"
 
@@ -26,13 +28,17 @@ Args:
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstddef>
 #include <cstdint>
 #include <exception>
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <new>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 using Clock = std::chrono::steady_clock;
 
@@ -54,6 +60,228 @@ static uint64_t fib_seq(unsigned n) {
     return b;
 }
 
+// How tree nodes are allocated and linked. Shared is the original variant
+// (make_shared nodes, std::function recursion); Arena uses per-worker bump
+// arenas, plain parent pointers and direct calls, so comparing the two
+// separates allocation overhead from scheduler overhead.
+enum class NodeAlloc { Arena, Shared };
+
+static const char* node_alloc_name(NodeAlloc a) {
+    return a == NodeAlloc::Arena ? "arena" : "shared";
+}
+
+// Per-thread bump allocator. Nodes are never freed one by one: all nodes of a
+// run are dead once its root completes, so the first allocation of the next
+// run (a new epoch) rewinds the cursor and reuses the chunks already held.
+class NodeArena {
+public:
+    template <typename T>
+    T* allocate(uint64_t epoch) {
+        static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+        if (epoch != epoch_) {
+            epoch_ = epoch;
+            chunk_ = 0;
+            offset_ = 0;
+        }
+        offset_ = (offset_ + alignof(T) - 1) & ~(alignof(T) - 1);
+        if (chunks_.empty() || offset_ + sizeof(T) > kChunkBytes) {
+            if (!chunks_.empty()) ++chunk_;
+            if (chunk_ == chunks_.size()) {
+                chunks_.push_back(std::make_unique<std::byte[]>(kChunkBytes));
+                reserved_bytes().fetch_add(kChunkBytes, std::memory_order_relaxed);
+            }
+            offset_ = 0;
+        }
+        void* p = chunks_[chunk_].get() + offset_;
+        offset_ += sizeof(T);
+        return static_cast<T*>(p);
+    }
+
+    // Chunk bytes held by all threads' arenas.
+    static std::atomic<size_t>& reserved_bytes() {
+        static std::atomic<size_t> bytes{0};
+        return bytes;
+    }
+
+private:
+    static constexpr size_t kChunkBytes = size_t{1} << 16;
+
+    std::vector<std::unique_ptr<std::byte[]>> chunks_;
+    size_t chunk_{0};
+    size_t offset_{0};
+    uint64_t epoch_{0};
+};
+
+static NodeArena& local_arena() {
+    thread_local NodeArena arena;
+    return arena;
+}
+
+// split_threshold argument: a number N, or "auto" / "auto:N". N is the leaf
+// size, where the tree switches to the iterative fib. A fixed cutoff submits
+// every internal node's children as tasks; auto asks the pool at each node
+// (ThreadPool::should_spawn) and expands the node inline when the pool has
+// enough queued work, so N can be small without paying a spawn per node.
+struct Cutoff {
+    unsigned threshold;
+    bool adaptive;
+};
+
+static Cutoff parse_cutoff(const std::string& s, unsigned def) {
+    if (s == "auto") return Cutoff{def, true};
+    if (s.rfind("auto:", 0) == 0) return Cutoff{static_cast<unsigned>(std::stoul(s.substr(5))), true};
+    return Cutoff{static_cast<unsigned>(std::stoul(s)), false};
+}
+
+struct ArenaNode {
+    ArenaNode* parent;
+    uint64_t left;
+    uint64_t right;
+    std::atomic<uint32_t> pending;
+    unsigned n;
+    unsigned depth;
+    bool is_left_child;
+};
+
+// Tree state shared by the pool and coroutine arena variants. Every node,
+// leaves included, comes from the allocating worker's arena, so a spawn
+// captures just (tree, node) and fits std::function's inline storage.
+template <typename Pool>
+class ArenaTree {
+public:
+    ArenaTree(Pool& pool, Cutoff cutoff) : pool_(pool), cutoff_(cutoff) {
+        static std::atomic<uint64_t> epochs{0};
+        epoch_ = epochs.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    ArenaNode* make_node(ArenaNode* parent, unsigned n, bool is_left_child) {
+        ArenaNode* node = local_arena().allocate<ArenaNode>(epoch_);
+        node->parent = parent;
+        node->left = 0;
+        node->right = 0;
+        new (&node->pending) std::atomic<uint32_t>(0);
+        node->n = n;
+        node->depth = parent != nullptr ? parent->depth + 1 : 0;
+        node->is_left_child = is_left_child;
+        return node;
+    }
+
+    // Internal nodes that submitted at least one child as a task.
+    uint64_t wait(uint64_t& spawned_internal_nodes) {
+        std::unique_lock<std::mutex> lk(done_mutex_);
+        done_cv_.wait(lk, [&] { return done_; });
+        spawned_internal_nodes = spawned_.load(std::memory_order_relaxed);
+        return result_;
+    }
+
+protected:
+    // Completes a leaf, or arms an internal node and passes its children to
+    // submit(child). In auto mode the left child is always expanded inline
+    // (lazy task creation) and the right one only goes to submit while the
+    // pool asks for work. Nothing here touches the tree after the last
+    // child call: that call may complete the root.
+    template <typename Submit>
+    void expand(ArenaNode* node, const Submit& submit) {
+        if (node->n <= cutoff_.threshold) {
+            complete(node, fib_seq(node->n));
+            return;
+        }
+        node->pending.store(2, std::memory_order_relaxed);
+        ArenaNode* left = make_node(node, node->n - 1, true);
+        ArenaNode* right = make_node(node, node->n - 2, false);
+        if (!cutoff_.adaptive) {
+            spawned_.fetch_add(1, std::memory_order_relaxed);
+            submit(left);
+            submit(right);
+            return;
+        }
+        if (pool_.should_spawn(node->depth)) {
+            spawned_.fetch_add(1, std::memory_order_relaxed);
+            submit(right);
+            expand(left, submit);
+            return;
+        }
+        expand(left, submit);
+        expand(right, submit);
+    }
+
+    Pool& pool_;
+
+private:
+    void complete(ArenaNode* cur, uint64_t value) {
+        while (ArenaNode* parent = cur->parent) {
+            if (cur->is_left_child) {
+                parent->left = value;
+            } else {
+                parent->right = value;
+            }
+            if (parent->pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                return;
+            }
+            value = parent->left + parent->right;
+            cur = parent;
+        }
+        // Notify under the lock: the tree lives on the waiter's stack and may
+        // be destroyed as soon as wait() sees done_.
+        std::lock_guard<std::mutex> lk(done_mutex_);
+        result_ = value;
+        done_ = true;
+        done_cv_.notify_one();
+    }
+
+    Cutoff cutoff_;
+    uint64_t epoch_;
+    std::mutex done_mutex_;
+    std::condition_variable done_cv_;
+    uint64_t result_{0};
+    bool done_{false};
+    std::atomic<uint64_t> spawned_{0};
+};
+
+template <typename Pool>
+class ArenaFib : public ArenaTree<Pool> {
+public:
+    ArenaFib(Pool& pool, Cutoff cutoff) : ArenaTree<Pool>(pool, cutoff) {}
+
+    void run(ArenaNode* node) {
+        this->expand(node, [this](ArenaNode* child) { this->pool_.submit([this, child] { run(child); }); });
+    }
+};
+
+class ArenaFibCoro : public ArenaTree<ThreadPool> {
+public:
+    ArenaFibCoro(ThreadPool& pool, Cutoff cutoff) : ArenaTree<ThreadPool>(pool, cutoff), sched_(pool) {}
+
+    coro::DetachedTask run(ArenaNode* node) {
+        co_await sched_.schedule();
+        expand(node, [this](ArenaNode* child) { run(child); });
+    }
+
+private:
+    coro::PoolScheduler sched_;
+};
+
+template <typename Pool>
+static uint64_t fib_single_parallel_arena(Pool& pool,
+                                          unsigned n,
+                                          Cutoff cutoff,
+                                          uint64_t& spawned_internal_nodes) {
+    ArenaFib<Pool> tree(pool, cutoff);
+    ArenaNode* root = tree.make_node(nullptr, n, false);
+    pool.submit([&tree, root] { tree.run(root); });
+    return tree.wait(spawned_internal_nodes);
+}
+
+static uint64_t fib_single_parallel_coro_arena(ThreadPool& pool,
+                                               unsigned n,
+                                               Cutoff cutoff,
+                                               uint64_t& spawned_internal_nodes) {
+    ArenaFibCoro tree(pool, cutoff);
+    tree.run(tree.make_node(nullptr, n, false));
+    return tree.wait(spawned_internal_nodes);
+}
+
 template <typename Pool>
 static uint64_t fib_single_parallel(Pool& pool,
                                     unsigned n,
@@ -225,35 +453,44 @@ static uint64_t fib_single_parallel_coro(ThreadPool& pool,
 template <typename Pool>
 static double run_once(Pool& pool,
                        unsigned fib_n,
-                       unsigned split_threshold,
+                       Cutoff cutoff,
+                       NodeAlloc alloc,
                        uint64_t& fib_value,
                        uint64_t& spawned_internal_nodes) {
     const auto t0 = Clock::now();
-    fib_value = fib_single_parallel(pool, fib_n, split_threshold, spawned_internal_nodes);
+    fib_value = alloc == NodeAlloc::Arena
+                    ? fib_single_parallel_arena(pool, fib_n, cutoff, spawned_internal_nodes)
+                    : fib_single_parallel(pool, fib_n, cutoff.threshold, spawned_internal_nodes);
     return seconds_since(t0);
 }
 
 static double run_once_coro(ThreadPool& pool,
                             unsigned fib_n,
-                            unsigned split_threshold,
+                            Cutoff cutoff,
+                            NodeAlloc alloc,
                             uint64_t& fib_value,
                             uint64_t& spawned_internal_nodes) {
     const auto t0 = Clock::now();
-    fib_value = fib_single_parallel_coro(pool, fib_n, split_threshold, spawned_internal_nodes);
+    fib_value = alloc == NodeAlloc::Arena
+                    ? fib_single_parallel_coro_arena(pool, fib_n, cutoff, spawned_internal_nodes)
+                    : fib_single_parallel_coro(pool, fib_n, cutoff.threshold, spawned_internal_nodes);
     return seconds_since(t0);
 }
 
 static void usage(const char* prog) {
     std::cerr
         << "Usage:\n  " << prog
-        << " <pool: classic|elastic|ws|advws|coro> <fib_n> <threads> <warmup> <reps> [split_threshold]\n\n"
+        << " <pool: classic|elastic|ws|advws|coro> <fib_n> <threads> <warmup> <reps>"
+           " [split_threshold|auto|auto:N] [arena|shared]\n\n"
         << "Examples:\n"
         << "  " << prog << " classic 44 8 1 3\n"
         << "  " << prog << " ws      44 8 1 3\n"
         << "  " << prog << " elastic 44 8 1 3\n"
         << "  " << prog << " advws   44 8 1 3\n"
         << "  " << prog << " coro    44 8 1 3\n"
-        << "  " << prog << " ws      50 8 1 3 34\n";
+        << "  " << prog << " ws      50 8 1 3 34\n"
+        << "  " << prog << " ws      44 8 1 3 30 shared\n"
+        << "  " << prog << " ws      44 8 1 3 auto:20\n";
 }
 
 int main(int argc, char** argv) {
@@ -268,7 +505,13 @@ int main(int argc, char** argv) {
         const size_t threads = std::stoul(argv[3]);
         const int warmup = std::stoi(argv[4]);
         const int reps = std::stoi(argv[5]);
-        const unsigned split_threshold = (argc >= 7) ? static_cast<unsigned>(std::stoul(argv[6])) : 30U;
+        const Cutoff cutoff = parse_cutoff((argc >= 7) ? argv[6] : "30", 30U);
+        const std::string alloc_name = (argc >= 8) ? argv[7] : "arena";
+        if (alloc_name != "arena" && alloc_name != "shared") {
+            std::cerr << "node allocation must be arena or shared\n";
+            return 1;
+        }
+        const NodeAlloc alloc = alloc_name == "arena" ? NodeAlloc::Arena : NodeAlloc::Shared;
 
         if (threads == 0 || reps <= 0 || warmup < 0) {
             std::cerr << "Invalid args: threads must be > 0, reps > 0, warmup >= 0\n";
@@ -278,7 +521,11 @@ int main(int argc, char** argv) {
             std::cerr << "fib_n must be <= 93 for uint64_t exactness\n";
             return 1;
         }
-        if (split_threshold < 2U) {
+        if (cutoff.adaptive && alloc == NodeAlloc::Shared) {
+            std::cerr << "auto split_threshold needs arena nodes\n";
+            return 1;
+        }
+        if (cutoff.threshold < 2U) {
             std::cerr << "split_threshold should be >= 2\n";
             return 1;
         }
@@ -289,76 +536,44 @@ int main(int argc, char** argv) {
                   << " threads=" << threads
                   << " warmup=" << warmup
                   << " reps=" << reps
-                  << " split_threshold=" << split_threshold << "\n";
+                  << " split_threshold=" << (cutoff.adaptive ? "auto:" : "") << cutoff.threshold
+                  << " nodes=" << node_alloc_name(alloc) << "\n";
 
-        double best = 1e100;
-        double sum = 0.0;
         uint64_t last_value = 0;
         uint64_t last_spawned = 0;
-
-        auto run_pool = [&](auto& pool) {
-            for (int i = 0; i < warmup; ++i) {
-                uint64_t warm_value = 0;
-                uint64_t warm_spawned = 0;
-                (void)run_once(pool, fib_n, split_threshold, warm_value, warm_spawned);
-            }
-
-            for (int r = 0; r < reps; ++r) {
-                uint64_t value = 0;
-                uint64_t spawned = 0;
-                const double t = run_once(pool, fib_n, split_threshold, value, spawned);
-                best = std::min(best, t);
-                sum += t;
-                last_value = value;
-                last_spawned = spawned;
-                std::cout << "Run " << r << ": " << t << " s\n";
-            }
-        };
-
-        if (pool_kind == "classic") {
-            ThreadPool pool(threads);
-            run_pool(pool);
-        } else if (pool_kind == "ws") {
-            ThreadPool pool(threads, ThreadPool::PoolKind::WorkStealing);
-            run_pool(pool);
-        } else if (pool_kind == "elastic") {
-            ThreadPool pool(threads, std::max<size_t>(threads * 2, size_t{1}));
-            run_pool(pool);
-        } else if (pool_kind == "advws") {
-            ThreadPool pool(
-                threads,
-                std::max<size_t>(threads * 2, size_t{1}),
-                ThreadPool::PoolKind::AdvancedElasticStealing,
-                std::chrono::milliseconds(200));
-            run_pool(pool);
-        } else if (pool_kind == "coro") {
-            ThreadPool pool(threads);
-            for (int i = 0; i < warmup; ++i) {
-                uint64_t warm_value = 0;
-                uint64_t warm_spawned = 0;
-                (void)run_once_coro(pool, fib_n, split_threshold, warm_value, warm_spawned);
-            }
-
-            for (int r = 0; r < reps; ++r) {
-                uint64_t value = 0;
-                uint64_t spawned = 0;
-                const double t = run_once_coro(pool, fib_n, split_threshold, value, spawned);
-                best = std::min(best, t);
-                sum += t;
-                last_value = value;
-                last_spawned = spawned;
-                std::cout << "Run " << r << ": " << t << " s\n";
-            }
-        } else {
+        bench::Samples samples;
+        const bool known = bench::with_pool(pool_kind, threads, [&](ThreadPool& pool) {
+            samples = bench::repeat(bench::repeat_options(warmup, reps), [&] {
+                return pool_kind == "coro" ? run_once_coro(pool, fib_n, cutoff, alloc, last_value, last_spawned)
+                                           : run_once(pool, fib_n, cutoff, alloc, last_value, last_spawned);
+            });
+        });
+        if (!known) {
             std::cerr << "Unknown pool kind: " << pool_kind << "\n";
             usage(argv[0]);
             return 1;
         }
 
-        std::cout << "Best: " << best << " s\n";
-        std::cout << "Avg : " << (sum / reps) << " s\n";
+        bench::Report report("fib_single", pool_kind, threads);
+        report.param("fib_n", fib_n)
+            .param("split_threshold", cutoff.threshold)
+            .param("adaptive", cutoff.adaptive)
+            .param("nodes", node_alloc_name(alloc));
+        report.metric("fib_value", last_value)
+            .metric("expected_value", fib_seq(fib_n))
+            .metric("spawned_internal_nodes", last_spawned);
+        if (alloc == NodeAlloc::Arena) {
+            report.metric("arena_kib", NodeArena::reserved_bytes().load() / 1024);
+        }
+        const bool written = report.finish(samples);
         std::cout << "Fib(" << fib_n << "): " << last_value << "\n";
         std::cout << "Spawned internal nodes: " << last_spawned << "\n";
+        if (alloc == NodeAlloc::Arena) {
+            std::cout << "Arena KiB: " << NodeArena::reserved_bytes().load() / 1024 << "\n";
+        }
+        if (!written) {
+            return 1;
+        }
 
     } catch (const std::exception& ex) {
         std::cerr << "Argument parse error: " << ex.what() << "\n";
@@ -0,0 +1,382 @@
+#pragma once
+
+// Batched small-matrix GEMM for request-sized problems.
+//
+// BatchedMatmul collects independent n x n products C = A * B submitted by
+// concurrent callers during a short window and runs them as one job. Each
+// group of kBatchLanes products is stored interleaved, element (i, j) of
+// product l at [(i * n + j) * kBatchLanes + l], so one SIMD register holds the
+// same element of every product and the kernel vectorizes across the batch
+// instead of inside one small matrix.
+//
+// No pool worker waits for the window. The first product of an open batch
+// arms a deadline on the engine's timer thread; the batch closes when the
+// deadline passes or when a submitter fills it, whichever comes first, and
+// submit() always returns at once. A closed batch is split into its lane
+// groups, which go on a ready queue: each group is posted to the runner given
+// at construction (one pool task per group), and callers that block on their
+// results run queued groups themselves through help_until(), so a pool whose
+// workers are all waiting on batches still makes progress. Coroutines simply
+// suspend and are resumed from the completion callback.
+
+#include "cpu_dispatch.h"
+#include "matmul_kernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace matmul {
+
+constexpr size_t kBatchLanes = 8;
+
+// Read access to one product of a computed batch.
+struct BatchView {
+    const double* data;
+    size_t lane;
+    size_t n;
+
+    double at(size_t i, size_t j) const { return data[(i * n + j) * kBatchLanes + lane]; }
+};
+
+// ---------------------------------------------------------------------------
+// Interleaved kernel: C = A * B for kBatchLanes products at once. The lane
+// dimension is a GCC vector, so every ISA variant below gets full-width
+// registers from the same body.
+// ---------------------------------------------------------------------------
+
+using BatchKernelFn = void (*)(size_t n, const double* a, const double* b, double* c);
+
+typedef double BatchVec __attribute__((vector_size(kBatchLanes * sizeof(double))));
+
+constexpr size_t kBatchCols = 8;  // output columns kept in registers per step
+
+// Accumulators are spelled as a fold over std::index_sequence (as in the
+// micro-kernels) so GCC keeps them in registers instead of a stack array.
+template <size_t... J>
+__attribute__((always_inline)) inline void batch_columns(std::index_sequence<J...>,
+                                                         size_t n,
+                                                         const BatchVec* a_row,
+                                                         const BatchVec* b,
+                                                         BatchVec* c_row) {
+    BatchVec acc[sizeof...(J)];
+    ((acc[J] = BatchVec{}), ...);
+    for (size_t k = 0; k < n; ++k) {
+        const BatchVec aik = a_row[k];
+        const BatchVec* bk = b + k * n;
+        ((acc[J] += aik * bk[J]), ...);
+    }
+    ((c_row[J] = acc[J]), ...);
+}
+
+__attribute__((always_inline)) inline void batch_kernel_body(size_t n, const double* a, const double* b, double* c) {
+    const BatchVec* av = reinterpret_cast<const BatchVec*>(a);
+    const BatchVec* bv = reinterpret_cast<const BatchVec*>(b);
+    BatchVec* cv = reinterpret_cast<BatchVec*>(c);
+    const size_t n_full = n - n % kBatchCols;
+
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n_full; j += kBatchCols) {
+            batch_columns(std::make_index_sequence<kBatchCols>{}, n, av + i * n, bv + j, cv + i * n + j);
+        }
+        for (size_t j = n_full; j < n; ++j) {
+            batch_columns(std::make_index_sequence<1>{}, n, av + i * n, bv + j, cv + i * n + j);
+        }
+    }
+}
+
+inline void batch_kernel_portable(size_t n, const double* a, const double* b, double* c) {
+    batch_kernel_body(n, a, b, c);
+}
+
+#if CPU_DISPATCH_X86
+__attribute__((target("sse2"))) inline void batch_kernel_sse2(size_t n, const double* a, const double* b, double* c) {
+    batch_kernel_body(n, a, b, c);
+}
+
+__attribute__((target("avx2,fma"))) inline void batch_kernel_avx2(size_t n, const double* a, const double* b, double* c) {
+    batch_kernel_body(n, a, b, c);
+}
+
+__attribute__((target("avx512f"))) inline void batch_kernel_avx512(size_t n, const double* a, const double* b, double* c) {
+    batch_kernel_body(n, a, b, c);
+}
+#endif
+
+inline BatchKernelFn batch_kernel_for(cpu::Isa isa) {
+#if CPU_DISPATCH_X86
+    switch (isa) {
+        case cpu::Isa::Sse2: return batch_kernel_sse2;
+        case cpu::Isa::Avx2: return batch_kernel_avx2;
+        case cpu::Isa::Avx512: return batch_kernel_avx512;
+        case cpu::Isa::Portable: break;
+    }
+#else
+    (void)isa;
+#endif
+    return batch_kernel_portable;
+}
+
+// Interleaves kBatchLanes row-major n x n matrices with row stride ld.
+inline void interleave(size_t n, size_t ld, const double* const* src, double* dst) {
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            double* d = dst + (i * n + j) * kBatchLanes;
+            for (size_t l = 0; l < kBatchLanes; ++l) d[l] = src[l][i * ld + j];
+        }
+    }
+}
+
+class BatchedMatmul {
+public:
+    using Done = std::function<void(const BatchView&)>;
+    using Post = std::function<void(std::function<void()>)>;
+
+    struct Stats {
+        uint64_t batches;
+        uint64_t items;
+    };
+
+    // ld is the row stride of every submitted operand (0: dense, ld = n).
+    // post runs a task asynchronously, e.g. pool.submit; without one, the
+    // thread that closes a batch computes it.
+    BatchedMatmul(size_t n, std::chrono::microseconds window, size_t max_batch, size_t ld = 0, Post post = {})
+        : n_(n),
+          ld_(ld != 0 ? ld : n),
+          window_(window),
+          max_batch_(std::max<size_t>(max_batch, 1)),
+          kernel_(batch_kernel_for(cpu::selected_isa())),
+          post_(std::move(post)),
+          timer_([this] { timer_loop(); }) {}
+
+    BatchedMatmul(const BatchedMatmul&) = delete;
+    BatchedMatmul& operator=(const BatchedMatmul&) = delete;
+
+    // Products still in an open batch are not computed after destruction.
+    // Waits for every posted group task to run, so the runner must still be
+    // working; destroying the runner first is also fine if it drains its
+    // queue on the way out, as ThreadPool does.
+    ~BatchedMatmul() {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            stop_ = true;
+        }
+        timer_cv_.notify_one();
+        timer_.join();
+        std::unique_lock<std::mutex> lk(m_);
+        ready_cv_.wait(lk, [&] { return posted_ == 0; });
+    }
+
+    // Queues count products C = A * B and returns without waiting. done runs
+    // once per product on whichever thread computes its lane group; it must
+    // not call submit() itself.
+    void submit(const double* a, const double* b, size_t count, const Done& done) {
+        if (count == 0) return;
+
+        std::vector<std::vector<Item>> closed;
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            for (size_t i = 0; i < count; ++i) {
+                pending_.push_back(Item{a, b, done});
+            }
+            while (pending_.size() >= max_batch_) {
+                closed.push_back(take_batch_locked());
+            }
+            if (pending_.empty()) {
+                armed_ = false;
+            } else if (!armed_) {
+                armed_ = true;
+                deadline_ = std::chrono::steady_clock::now() + window_;
+                timer_cv_.notify_one();
+            }
+        }
+        for (std::vector<Item>& batch : closed) {
+            dispatch(std::move(batch));
+        }
+    }
+
+    // Runs queued lane groups on the calling thread until done() is true.
+    // done() is evaluated under the engine lock and must not call back into
+    // the engine. A group that finishes wakes every helper to re-check.
+    template <typename Pred>
+    void help_until(Pred&& done) {
+        std::unique_lock<std::mutex> lk(m_);
+        while (!done()) {
+            if (ready_.empty()) {
+                ready_cv_.wait(lk);
+                continue;
+            }
+            const Group g = std::move(ready_.front());
+            ready_.pop_front();
+            lk.unlock();
+            run_group(g);
+            lk.lock();
+            ready_cv_.notify_all();
+        }
+    }
+
+    Stats stats() const {
+        return Stats{batches_.load(std::memory_order_relaxed), items_.load(std::memory_order_relaxed)};
+    }
+
+    std::chrono::microseconds window() const { return window_; }
+    size_t max_batch() const { return max_batch_; }
+
+private:
+    struct Item {
+        const double* a;
+        const double* b;
+        Done done;
+    };
+
+    // Lane group [first, first + kBatchLanes) of a closed batch.
+    struct Group {
+        std::shared_ptr<const std::vector<Item>> batch;
+        size_t first;
+    };
+
+    std::vector<Item> take_batch_locked() {
+        const size_t take = std::min(pending_.size(), max_batch_);
+        std::vector<Item> batch(std::make_move_iterator(pending_.begin()),
+                                std::make_move_iterator(pending_.begin() + static_cast<std::ptrdiff_t>(take)));
+        pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(take));
+        return batch;
+    }
+
+    // Closes whatever is pending once the window of its first product ends.
+    void timer_loop() {
+        std::unique_lock<std::mutex> lk(m_);
+        while (!stop_) {
+            if (!armed_) {
+                timer_cv_.wait(lk);
+                continue;
+            }
+            if (std::chrono::steady_clock::now() < deadline_) {
+                timer_cv_.wait_until(lk, deadline_);
+                continue;
+            }
+            armed_ = false;
+            std::vector<std::vector<Item>> closed;
+            while (!pending_.empty()) {
+                closed.push_back(take_batch_locked());
+            }
+            lk.unlock();
+            for (std::vector<Item>& batch : closed) {
+                dispatch(std::move(batch));
+            }
+            lk.lock();
+        }
+    }
+
+    void dispatch(std::vector<Item> items) {
+        batches_.fetch_add(1, std::memory_order_relaxed);
+        items_.fetch_add(items.size(), std::memory_order_relaxed);
+        const auto batch = std::make_shared<const std::vector<Item>>(std::move(items));
+        const size_t groups = (batch->size() + kBatchLanes - 1) / kBatchLanes;
+        if (!post_) {
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                for (size_t g = 0; g < groups; ++g) {
+                    ready_.push_back(Group{batch, g * kBatchLanes});
+                }
+            }
+            ready_cv_.notify_all();
+            while (run_ready()) {
+            }
+            return;
+        }
+        // Groups are posted in the same critical section that queues them,
+        // so no helper can finish a group (and let its caller tear down the
+        // runner) while this thread is still posting. post_ only enqueues; a
+        // task that finds the queue empty lost its group to a helper.
+        std::lock_guard<std::mutex> lk(m_);
+        for (size_t g = 0; g < groups; ++g) {
+            ready_.push_back(Group{batch, g * kBatchLanes});
+            ++posted_;
+            post_([this] { run_posted(); });
+        }
+        ready_cv_.notify_all();
+    }
+
+    void run_posted() {
+        (void)run_ready();
+        std::lock_guard<std::mutex> lk(m_);
+        if (--posted_ == 0) ready_cv_.notify_all();
+    }
+
+    bool run_ready() {
+        Group g;
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            if (ready_.empty()) return false;
+            g = std::move(ready_.front());
+            ready_.pop_front();
+        }
+        run_group(g);
+        std::lock_guard<std::mutex> lk(m_);
+        ready_cv_.notify_all();
+        return true;
+    }
+
+    void run_group(const Group& g) {
+        const size_t nn = n_ * n_;
+        thread_local AlignedBuffer a_il;
+        thread_local AlignedBuffer b_il;
+        thread_local AlignedBuffer c_il;
+        a_il.resize(nn * kBatchLanes);
+        b_il.resize(nn * kBatchLanes);
+        c_il.resize(nn * kBatchLanes);
+
+        const std::vector<Item>& batch = *g.batch;
+        const size_t used = std::min(kBatchLanes, batch.size() - g.first);
+        const double* as[kBatchLanes];
+        const double* bs[kBatchLanes];
+        for (size_t l = 0; l < kBatchLanes; ++l) {
+            // Unused lanes repeat the first product; their results are dropped.
+            const Item& it = batch[g.first + (l < used ? l : 0)];
+            as[l] = it.a;
+            bs[l] = it.b;
+        }
+        interleave(n_, ld_, as, a_il.data());
+        interleave(n_, ld_, bs, b_il.data());
+        kernel_(n_, a_il.data(), b_il.data(), c_il.data());
+        for (size_t l = 0; l < used; ++l) {
+            batch[g.first + l].done(BatchView{c_il.data(), l, n_});
+        }
+    }
+
+    size_t n_;
+    size_t ld_;
+    std::chrono::microseconds window_;
+    size_t max_batch_;
+    BatchKernelFn kernel_;
+    Post post_;
+
+    std::mutex m_;
+    std::condition_variable timer_cv_;
+    std::condition_variable ready_cv_;
+    std::vector<Item> pending_;
+    std::deque<Group> ready_;
+    size_t posted_{0};  // group tasks handed to post_ and not yet run
+    bool armed_{false};
+    bool stop_{false};
+    std::chrono::steady_clock::time_point deadline_;
+
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> items_{0};
+
+    std::thread timer_;  // last: starts after every other member is initialized
+};
+
+}  // namespace matmul
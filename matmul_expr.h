@@ -0,0 +1,507 @@
+#pragma once
+
+// Matrix chain expressions F0 F1 ... Fn-1 (+ D) evaluated as one tile DAG.
+//
+// Running a chain as separate gemm calls puts a full barrier between the
+// products: the next product cannot start until the slowest tile of the
+// previous one finishes, so workers idle on every tail. ExprDag instead
+// schedules BS x BS output tiles of all products at once:
+//
+//   - The parenthesization comes from the classic matrix-chain dynamic
+//     program over the factor dimensions (fewest multiply-adds).
+//   - For a product node P = L R, tile (i, j) of P needs row panel i of L
+//     and column panel j of R. When L or R is itself a product, each of its
+//     row (or column) panels keeps a counter of unfinished tiles; the tile
+//     that brings it to zero releases the matching row (or column) of P.
+//   - A P tile holds one pending count per product child and is spawned by
+//     whichever release brings it to zero, so no task ever blocks.
+//   - The addend D is copied into each root tile just before the tile
+//     accumulates its product (beta = 1).
+//
+// Intermediate products live in temporaries kept between evaluate() calls.
+// evaluate_expr_barrier() runs the same plan product by product with
+// gemm_tasks, for comparison.
+
+#include "matmul_gemm.h"
+#include "matmul_kernels.h"
+#include "matmul_matrix.h"
+#include "matmul_verify.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace matmul {
+
+// Row-major view of an input matrix.
+struct ExprOperand {
+    const double* data{nullptr};
+    size_t rows{0};
+    size_t cols{0};
+    size_t ld{0};
+};
+
+inline ExprOperand expr_operand(const Matrix& m) { return ExprOperand{m.data(), m.rows(), m.cols(), m.ld()}; }
+
+class MatrixExpr {
+public:
+    static MatrixExpr product(std::vector<ExprOperand> factors) {
+        if (factors.empty()) throw std::invalid_argument("matrix expression: empty product");
+        for (size_t f = 0; f < factors.size(); ++f) {
+            if (factors[f].ld < std::max<size_t>(factors[f].cols, 1)) {
+                throw std::invalid_argument("matrix expression: factor " + std::to_string(f) +
+                                            " has ld smaller than its row length");
+            }
+            if (f > 0 && factors[f - 1].cols != factors[f].rows) {
+                throw std::invalid_argument("matrix expression: factor " + std::to_string(f - 1) + " is " +
+                                            std::to_string(factors[f - 1].rows) + "x" +
+                                            std::to_string(factors[f - 1].cols) + " but factor " +
+                                            std::to_string(f) + " has " + std::to_string(factors[f].rows) +
+                                            " rows");
+            }
+        }
+        MatrixExpr e;
+        e.factors_ = std::move(factors);
+        return e;
+    }
+
+    MatrixExpr& plus(const ExprOperand& d) {
+        if (d.rows != rows() || d.cols != cols() || d.ld < std::max<size_t>(d.cols, 1)) {
+            throw std::invalid_argument("matrix expression: addend must be " + std::to_string(rows()) + "x" +
+                                        std::to_string(cols()));
+        }
+        addend_ = d;
+        return *this;
+    }
+
+    size_t rows() const { return factors_.front().rows; }
+    size_t cols() const { return factors_.back().cols; }
+    const std::vector<ExprOperand>& factors() const { return factors_; }
+    const std::optional<ExprOperand>& addend() const { return addend_; }
+
+    // p0 .. pn: factor f is p[f] x p[f + 1].
+    std::vector<size_t> dims() const {
+        std::vector<size_t> p{rows()};
+        for (const ExprOperand& f : factors_) p.push_back(f.cols);
+        return p;
+    }
+
+private:
+    MatrixExpr() = default;
+
+    std::vector<ExprOperand> factors_;
+    std::optional<ExprOperand> addend_;
+};
+
+// ---------------------------------------------------------------------------
+// Parenthesization
+// ---------------------------------------------------------------------------
+
+// A binary product tree over factors [first, last]. Nodes are stored
+// children first; the root is the last node.
+struct ChainPlan {
+    struct Node {
+        size_t first, last;  // factor range
+        int left{-1};        // child node indices; -1 for a leaf (first == last)
+        int right{-1};
+        int parent{-1};
+    };
+    std::vector<Node> nodes;
+    double flops{0.0};  // 2 * multiply-adds of all products
+
+    size_t root() const { return nodes.size() - 1; }
+    bool is_product(int n) const { return n >= 0 && nodes[static_cast<size_t>(n)].left >= 0; }
+};
+
+// Multiply-add count of one product: (p[i] x p[k+1]) * (p[k+1] x p[j+1]).
+inline double chain_product_cost(const std::vector<size_t>& p, size_t i, size_t k, size_t j) {
+    return static_cast<double>(p[i]) * static_cast<double>(p[k + 1]) * static_cast<double>(p[j + 1]);
+}
+
+// Matrix-chain order by dynamic programming, O(n^3) in the number of factors.
+inline ChainPlan plan_chain(const std::vector<size_t>& p) {
+    if (p.size() < 2) throw std::invalid_argument("plan_chain: need at least one factor");
+    const size_t n = p.size() - 1;
+    std::vector<double> cost(n * n, 0.0);
+    std::vector<size_t> split(n * n, 0);
+    for (size_t len = 2; len <= n; ++len) {
+        for (size_t i = 0; i + len <= n; ++i) {
+            const size_t j = i + len - 1;
+            double best = std::numeric_limits<double>::infinity();
+            for (size_t k = i; k < j; ++k) {
+                const double c = cost[i * n + k] + cost[(k + 1) * n + j] + chain_product_cost(p, i, k, j);
+                if (c <= best) {  // ties go to the later split: left to right
+                    best = c;
+                    split[i * n + j] = k;
+                }
+            }
+            cost[i * n + j] = best;
+        }
+    }
+
+    ChainPlan plan;
+    plan.flops = 2.0 * cost[n - 1];
+    auto build = [&](auto&& self, size_t i, size_t j) -> int {
+        ChainPlan::Node node{i, j};
+        if (i != j) {
+            const size_t k = split[i * n + j];
+            node.left = self(self, i, k);
+            node.right = self(self, k + 1, j);
+        }
+        plan.nodes.push_back(node);
+        const int id = static_cast<int>(plan.nodes.size() - 1);
+        if (node.left >= 0) {
+            plan.nodes[static_cast<size_t>(node.left)].parent = id;
+            plan.nodes[static_cast<size_t>(node.right)].parent = id;
+        }
+        return id;
+    };
+    build(build, 0, n - 1);
+    return plan;
+}
+
+// "((M0 M1) M2)"-style description of the plan.
+inline std::string describe_chain(const ChainPlan& plan) {
+    auto text = [&](auto&& self, size_t id) -> std::string {
+        const ChainPlan::Node& node = plan.nodes[id];
+        if (node.left < 0) return "M" + std::to_string(node.first);
+        return "(" + self(self, static_cast<size_t>(node.left)) + " " + self(self, static_cast<size_t>(node.right)) +
+               ")";
+    };
+    return text(text, plan.root());
+}
+
+// Multiply-adds of evaluating the chain strictly left to right, for reporting.
+inline double chain_flops_left_to_right(const std::vector<size_t>& p) {
+    double madds = 0.0;
+    for (size_t j = 1; j + 1 < p.size(); ++j) madds += chain_product_cost(p, 0, j - 1, j);
+    return 2.0 * madds;
+}
+
+// ---------------------------------------------------------------------------
+// Shared evaluation state
+// ---------------------------------------------------------------------------
+
+// Where each plan node's value lives: the factor itself, a temporary, or
+// (for the root) the caller's output.
+struct ExprBuffers {
+    std::vector<Matrix> temps;  // indexed by plan node; empty for leaves and the root
+    std::vector<ExprOperand> value;
+    std::vector<double*> dest;  // writable value of product nodes, nullptr for leaves
+
+    void bind(const MatrixExpr& e, const ChainPlan& plan, double* out, size_t ldo) {
+        const std::vector<size_t> p = e.dims();
+        temps.resize(plan.nodes.size());
+        value.assign(plan.nodes.size(), ExprOperand{});
+        dest.assign(plan.nodes.size(), nullptr);
+        for (size_t id = 0; id < plan.nodes.size(); ++id) {
+            const ChainPlan::Node& node = plan.nodes[id];
+            const size_t rows = p[node.first], cols = p[node.last + 1];
+            if (node.left < 0) {
+                value[id] = e.factors()[node.first];
+            } else if (id == plan.root()) {
+                value[id] = ExprOperand{out, rows, cols, ldo};
+                dest[id] = out;
+            } else {
+                if (temps[id].rows() != rows || temps[id].cols() != cols) temps[id] = Matrix(rows, cols);
+                value[id] = ExprOperand{temps[id].data(), rows, cols, temps[id].ld()};
+                dest[id] = temps[id].data();
+            }
+        }
+    }
+};
+
+// Copies tile (i0, j0) of d into out.
+inline void copy_tile(const ExprOperand& d, double* out, size_t ldo, size_t bs, size_t i0, size_t j0) {
+    const size_t m = std::min(bs, d.rows - i0);
+    const size_t n = std::min(bs, d.cols - j0);
+    for (size_t i = 0; i < m; ++i) {
+        const double* src = d.data + (i0 + i) * d.ld + j0;
+        std::copy(src, src + n, out + (i0 + i) * ldo + j0);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Tile DAG
+// ---------------------------------------------------------------------------
+
+// spawn(std::function<void()>) must run the function asynchronously, e.g. by
+// submitting it to a pool or resuming a coroutine on one.
+template <typename Spawn>
+class ExprDag {
+public:
+    ExprDag(Spawn spawn, const Kernel& kernel, size_t bs)
+        : spawn_(std::move(spawn)), kernel_(kernel), bs_(std::max<size_t>(bs, 1)) {}
+
+    // out (rows x cols, ld ldo) = the expression. out must not alias a factor.
+    void evaluate(const MatrixExpr& e, double* out, size_t ldo) {
+        if (ldo < std::max<size_t>(e.cols(), 1)) throw std::invalid_argument("ExprDag: ldo smaller than row length");
+        plan_ = plan_chain(e.dims());
+        addend_ = e.addend();
+        buffers_.bind(e, plan_, out, ldo);
+        tasks_.store(0, std::memory_order_relaxed);
+        early_.store(0, std::memory_order_relaxed);
+
+        const size_t root = plan_.root();
+        const std::vector<size_t> p = e.dims();
+        if (std::find(p.begin(), p.end(), size_t{0}) != p.end()) {
+            // An empty output, or a zero inner dimension that makes the
+            // product zero: out = D (or 0). A product node without tiles
+            // would never release its parent, so the DAG is not built.
+            for (size_t i = 0; i < e.rows(); ++i) {
+                for (size_t j = 0; j < e.cols(); ++j) {
+                    out[i * ldo + j] = addend_ ? addend_->data[i * addend_->ld + j] : 0.0;
+                }
+            }
+            return;
+        }
+        if (!plan_.is_product(static_cast<int>(root))) {
+            // A single factor: out = F0 (+ D).
+            const ExprOperand& f = buffers_.value[root];
+            for (size_t i = 0; i < f.rows; ++i) {
+                for (size_t j = 0; j < f.cols; ++j) {
+                    out[i * ldo + j] = f.data[i * f.ld + j] + (addend_ ? addend_->data[i * addend_->ld + j] : 0.0);
+                }
+            }
+            return;
+        }
+
+        // Counters for every product node, then release the tiles whose
+        // children are both inputs.
+        state_ = std::make_unique<NodeState[]>(plan_.nodes.size());
+        std::vector<size_t> ready;
+        for (size_t id = 0; id < plan_.nodes.size(); ++id) {
+            if (!plan_.is_product(static_cast<int>(id))) continue;
+            const ChainPlan::Node& node = plan_.nodes[id];
+            NodeState& st = state_[id];
+            st.tiles_i = (buffers_.value[id].rows + bs_ - 1) / bs_;
+            st.tiles_j = (buffers_.value[id].cols + bs_ - 1) / bs_;
+            const uint32_t deps = (plan_.is_product(node.left) ? 1u : 0u) + (plan_.is_product(node.right) ? 1u : 0u);
+            st.pending = std::make_unique<std::atomic<uint32_t>[]>(st.tiles_i * st.tiles_j);
+            for (size_t t = 0; t < st.tiles_i * st.tiles_j; ++t) st.pending[t].store(deps, std::memory_order_relaxed);
+            st.remaining.store(st.tiles_i * st.tiles_j, std::memory_order_relaxed);
+            // This node's panels feed its parent: row panels if it is the
+            // left child, column panels if it is the right child.
+            if (id != root) {
+                const bool left_child = plan_.nodes[static_cast<size_t>(node.parent)].left == static_cast<int>(id);
+                const size_t panels = left_child ? st.tiles_i : st.tiles_j;
+                st.panel_left = std::make_unique<std::atomic<uint32_t>[]>(panels);
+                for (size_t q = 0; q < panels; ++q) {
+                    st.panel_left[q].store(static_cast<uint32_t>(left_child ? st.tiles_j : st.tiles_i),
+                                           std::memory_order_relaxed);
+                }
+            }
+            if (deps == 0) ready.push_back(id);
+        }
+        done_ = false;
+        for (size_t id : ready) {
+            const NodeState& st = state_[id];
+            for (size_t t = 0; t < st.tiles_i * st.tiles_j; ++t) spawn_tile(id, t / st.tiles_j, t % st.tiles_j);
+        }
+
+        std::unique_lock<std::mutex> lk(done_mutex_);
+        done_cv_.wait(lk, [&] { return done_; });
+    }
+
+    const ChainPlan& plan() const { return plan_; }
+    // Tile tasks run by the last evaluate().
+    size_t tasks_spawned() const { return tasks_.load(std::memory_order_relaxed); }
+    // Tiles that started while a product they read from was still running,
+    // i.e. the overlap a barrier between products would have removed.
+    size_t tiles_started_early() const { return early_.load(std::memory_order_relaxed); }
+
+private:
+    struct NodeState {
+        size_t tiles_i{0}, tiles_j{0};
+        std::unique_ptr<std::atomic<uint32_t>[]> pending;     // per tile: unready child panels
+        std::unique_ptr<std::atomic<uint32_t>[]> panel_left;  // per panel fed to the parent: tiles left
+        std::atomic<size_t> remaining{0};                     // tiles of this node not finished
+    };
+
+    void spawn_tile(size_t id, size_t ti, size_t tj) {
+        tasks_.fetch_add(1, std::memory_order_relaxed);
+        spawn_([this, id, ti, tj] { run_tile(id, ti, tj); });
+    }
+
+    void release(size_t id, size_t ti, size_t tj) {
+        NodeState& st = state_[id];
+        if (st.pending[ti * st.tiles_j + tj].fetch_sub(1, std::memory_order_acq_rel) == 1) spawn_tile(id, ti, tj);
+    }
+
+    void run_tile(size_t id, size_t ti, size_t tj) {
+        const ChainPlan::Node& node = plan_.nodes[id];
+        for (const int child : {node.left, node.right}) {
+            if (plan_.is_product(child) &&
+                state_[static_cast<size_t>(child)].remaining.load(std::memory_order_relaxed) != 0) {
+                early_.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+        }
+
+        const ExprOperand& l = buffers_.value[static_cast<size_t>(node.left)];
+        const ExprOperand& r = buffers_.value[static_cast<size_t>(node.right)];
+        const ExprOperand& c = buffers_.value[id];
+        double* dst = buffers_.dest[id];
+        const size_t i0 = ti * bs_, j0 = tj * bs_;
+        const bool add = id == plan_.root() && addend_.has_value();
+        if (add) copy_tile(*addend_, dst, c.ld, bs_, i0, j0);
+        gemm_tile(kernel_, Trans::No, Trans::No, c.rows, c.cols, l.cols, 1.0, l.data, l.ld, r.data, r.ld,
+                  add ? 1.0 : 0.0, dst, c.ld, bs_, i0, j0);
+        finish_tile(id, ti, tj);
+    }
+
+    void finish_tile(size_t id, size_t ti, size_t tj) {
+        NodeState& st = state_[id];
+        const ChainPlan::Node& node = plan_.nodes[id];
+        if (id == plan_.root()) {
+            if (st.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lk(done_mutex_);
+                done_ = true;
+                done_cv_.notify_one();
+            }
+            return;
+        }
+        st.remaining.fetch_sub(1, std::memory_order_relaxed);
+        // Bounds are copied first: once the last release has spawned the
+        // final root tile, evaluate() may return and reset the state.
+        const size_t parent = static_cast<size_t>(node.parent);
+        const size_t parent_tiles_i = state_[parent].tiles_i, parent_tiles_j = state_[parent].tiles_j;
+        if (plan_.nodes[parent].left == static_cast<int>(id)) {
+            // Row panel ti complete: row ti of the parent can read it.
+            if (st.panel_left[ti].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                for (size_t j = 0; j < parent_tiles_j; ++j) release(parent, ti, j);
+            }
+        } else if (st.panel_left[tj].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            // Column panel tj complete: column tj of the parent can read it.
+            for (size_t i = 0; i < parent_tiles_i; ++i) release(parent, i, tj);
+        }
+    }
+
+    Spawn spawn_;
+    const Kernel& kernel_;
+    size_t bs_;
+    ChainPlan plan_;
+    std::optional<ExprOperand> addend_;
+    ExprBuffers buffers_;
+    std::unique_ptr<NodeState[]> state_;
+    std::atomic<size_t> tasks_{0};
+    std::atomic<size_t> early_{0};
+    std::mutex done_mutex_;
+    std::condition_variable done_cv_;
+    bool done_{false};
+};
+
+// ---------------------------------------------------------------------------
+// Barrier baseline and verification
+// ---------------------------------------------------------------------------
+
+// Same plan, one gemm_tasks call per product in dependency order (children
+// first), so every product waits for the whole previous one.
+template <typename RunTasks>
+void evaluate_expr_barrier(RunTasks&& run_tasks_fn, const MatrixExpr& e, double* out, size_t ldo,
+                           ExprBuffers& buffers, const GemmOptions& opt = {}) {
+    const ChainPlan plan = plan_chain(e.dims());
+    buffers.bind(e, plan, out, ldo);
+    const size_t root = plan.root();
+    const std::optional<ExprOperand>& d = e.addend();
+    if (!plan.is_product(static_cast<int>(root))) {
+        const ExprOperand& f = buffers.value[root];
+        for (size_t i = 0; i < f.rows; ++i) {
+            for (size_t j = 0; j < f.cols; ++j) out[i * ldo + j] = f.data[i * f.ld + j] + (d ? d->data[i * d->ld + j] : 0.0);
+        }
+        return;
+    }
+    if (d) {
+        const size_t bs = std::max<size_t>(opt.bs, 1);
+        const size_t tiles_j = (e.cols() + bs - 1) / bs;
+        run_tasks_fn(((e.rows() + bs - 1) / bs) * tiles_j,
+                     [&](size_t t) { copy_tile(*d, out, ldo, bs, (t / tiles_j) * bs, (t % tiles_j) * bs); });
+    }
+    for (size_t id = 0; id < plan.nodes.size(); ++id) {
+        const ChainPlan::Node& node = plan.nodes[id];
+        if (node.left < 0) continue;
+        const ExprOperand& l = buffers.value[static_cast<size_t>(node.left)];
+        const ExprOperand& r = buffers.value[static_cast<size_t>(node.right)];
+        const ExprOperand& c = buffers.value[id];
+        gemm_tasks(run_tasks_fn, Trans::No, Trans::No, c.rows, c.cols, l.cols, 1.0, l.data, l.ld, r.data, r.ld,
+                   id == root && d ? 1.0 : 0.0, buffers.dest[id], c.ld, opt);
+    }
+}
+
+// Freivalds check of out against the expression: out r is compared with
+// F0 (F1 (... (Fn-1 r))) + D r, one matrix-vector product per factor.
+template <typename RunTasks>
+VerifyResult freivalds_verify_expr(RunTasks&& run_tasks_fn, const MatrixExpr& e, const double* out, size_t ldo,
+                                   uint64_t seed, const VerifyOptions& opt = {}) {
+    const auto t0 = std::chrono::steady_clock::now();
+    const double tol = opt.tolerance > 0.0 ? opt.tolerance : default_verify_tolerance<double>();
+    const size_t step = std::max<size_t>(opt.rows_per_task, 1);
+    const uint64_t key = mix64(seed);
+    const size_t n = e.cols();
+
+    std::vector<double> y(n), y_abs(n);
+    for (size_t j = 0; j < n; ++j) {
+        y[j] = counter_uniform(key, j);
+        y_abs[j] = std::abs(y[j]);
+    }
+    const std::vector<double> r = y;
+    const std::vector<ExprOperand>& f = e.factors();
+    for (size_t idx = f.size(); idx-- > 0;) {
+        std::vector<double> z(f[idx].rows), z_abs(f[idx].rows);
+        run_tasks_fn((f[idx].rows + step - 1) / step, [&](size_t t) {
+            const size_t i0 = t * step;
+            verify_gemv_rows(Trans::No, f[idx].data, f[idx].ld, i0, std::min(f[idx].rows, i0 + step), f[idx].cols,
+                             y.data(), y_abs.data(), z.data(), z_abs.data());
+        });
+        y.swap(z);
+        y_abs.swap(z_abs);
+    }
+
+    VerifyResult res;
+    std::atomic<size_t> bad{0};
+    std::mutex max_mutex;
+    const std::optional<ExprOperand>& d = e.addend();
+    run_tasks_fn((e.rows() + step - 1) / step, [&](size_t t) {
+        const size_t i0 = t * step;
+        const size_t i1 = std::min(e.rows(), i0 + step);
+        size_t local_bad = 0;
+        double local_max = 0.0;
+        for (size_t i = i0; i < i1; ++i) {
+            double w = 0.0, want = y[i], want_abs = y_abs[i];
+            for (size_t j = 0; j < n; ++j) w += out[i * ldo + j] * r[j];
+            if (d) {
+                for (size_t j = 0; j < n; ++j) {
+                    want += d->data[i * d->ld + j] * r[j];
+                    want_abs += std::abs(d->data[i * d->ld + j] * r[j]);
+                }
+            }
+            const double err = std::abs(w - want);
+            const double allowed = tol * want_abs;
+            const double ratio = allowed > 0.0 ? err / allowed
+                                               : (err == 0.0 ? 0.0 : std::numeric_limits<double>::infinity());
+            if (!(ratio <= 1.0)) ++local_bad;
+            local_max = std::max(local_max, std::isnan(ratio) ? std::numeric_limits<double>::infinity() : ratio);
+        }
+        bad.fetch_add(local_bad, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lk(max_mutex);
+        res.max_error = std::max(res.max_error, local_max);
+    });
+    res.bad_rows = bad.load(std::memory_order_relaxed);
+    res.ok = res.bad_rows == 0;
+    res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return res;
+}
+
+}  // namespace matmul
@@ -0,0 +1,348 @@
+#pragma once
+
+// Matrix files and out-of-core gemm.
+//
+// File format: one 4 KiB header page ("MATMULv1", then rows and cols as
+// uint64) followed by rows * cols dense row-major doubles in native byte
+// order. Data starting on a page boundary lets map_matrix_file() mmap it
+// straight into a Matrix (copy-on-write, ld = cols).
+//
+// ooc_gemm() computes C = A * B between files with a fixed memory budget.
+// C is produced one P x P block at a time; for each block the K dimension is
+// walked in P-wide steps, each step reading an A panel (P x P) and a B panel
+// (P x P) with pread. While the pool multiplies one pair of panels, a loader
+// thread reads the next pair (after a POSIX_FADV_WILLNEED hint for the pair
+// after that), and a finished C block is written back with pwrite by a writer
+// thread while the next block is computed. P is the largest multiple of BS
+// for which the two A/B panel pairs and two C blocks fit the budget.
+
+#include "matmul_gemm.h"
+#include "matmul_kernels.h"
+#include "matmul_matrix.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace matmul {
+
+constexpr size_t kMatrixFileHeader = 4096;
+constexpr char kMatrixFileMagic[8] = {'M', 'A', 'T', 'M', 'U', 'L', 'v', '1'};
+
+inline std::runtime_error file_error(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+// Positioned I/O on a matrix file. Blocks are (rows x cols) windows at
+// (r0, c0); a full-width window is one contiguous pread/pwrite.
+class MatrixFile {
+public:
+    static MatrixFile open(const std::string& path, bool writable = false) {
+        MatrixFile f(path, ::open(path.c_str(), writable ? O_RDWR : O_RDONLY));
+        f.read_header();
+        return f;
+    }
+
+    // Creates (or truncates) a zero-filled rows x cols file.
+    static MatrixFile create(const std::string& path, size_t rows, size_t cols) {
+        MatrixFile f(path, ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644));
+        f.rows_ = rows;
+        f.cols_ = cols;
+        char header[kMatrixFileHeader] = {};
+        const uint64_t dims[2] = {rows, cols};
+        std::memcpy(header, kMatrixFileMagic, sizeof(kMatrixFileMagic));
+        std::memcpy(header + sizeof(kMatrixFileMagic), dims, sizeof(dims));
+        f.pwrite_all(header, sizeof(header), 0);
+        if (::ftruncate(f.fd_, static_cast<off_t>(f.file_bytes())) != 0) {
+            throw file_error("ftruncate", path);
+        }
+        return f;
+    }
+
+    MatrixFile(MatrixFile&& other) noexcept
+        : path_(std::move(other.path_)), fd_(std::exchange(other.fd_, -1)), rows_(other.rows_), cols_(other.cols_) {}
+
+    MatrixFile(const MatrixFile&) = delete;
+    MatrixFile& operator=(const MatrixFile&) = delete;
+    MatrixFile& operator=(MatrixFile&&) = delete;
+
+    ~MatrixFile() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    size_t rows() const { return rows_; }
+    size_t cols() const { return cols_; }
+    const std::string& path() const { return path_; }
+    size_t file_bytes() const { return kMatrixFileHeader + rows_ * cols_ * sizeof(double); }
+
+    void read_block(size_t r0, size_t rows, size_t c0, size_t cols, double* dst, size_t ld) const {
+        if (c0 == 0 && cols == cols_ && ld == cols_) {
+            pread_all(dst, rows * cols * sizeof(double), offset(r0, 0));
+            return;
+        }
+        for (size_t i = 0; i < rows; ++i) {
+            pread_all(dst + i * ld, cols * sizeof(double), offset(r0 + i, c0));
+        }
+    }
+
+    void write_block(size_t r0, size_t rows, size_t c0, size_t cols, const double* src, size_t ld) {
+        if (c0 == 0 && cols == cols_ && ld == cols_) {
+            pwrite_all(src, rows * cols * sizeof(double), offset(r0, 0));
+            return;
+        }
+        for (size_t i = 0; i < rows; ++i) {
+            pwrite_all(src + i * ld, cols * sizeof(double), offset(r0 + i, c0));
+        }
+    }
+
+    // Read-ahead hint for the block rows [r0, r0 + rows) x columns
+    // [c0, c0 + cols): one range when the rows are full width, else one per row.
+    void will_need(size_t r0, size_t rows, size_t c0, size_t cols) const {
+        rows = std::min(rows, rows_ - std::min(r0, rows_));
+        cols = std::min(cols, cols_ - std::min(c0, cols_));
+        if (rows == 0 || cols == 0) return;
+#ifdef POSIX_FADV_WILLNEED
+        if (c0 == 0 && cols == cols_) {
+            (void)::posix_fadvise(fd_, static_cast<off_t>(offset(r0, 0)),
+                                  static_cast<off_t>(rows * cols_ * sizeof(double)), POSIX_FADV_WILLNEED);
+            return;
+        }
+        for (size_t i = 0; i < rows; ++i) {
+            (void)::posix_fadvise(fd_, static_cast<off_t>(offset(r0 + i, c0)),
+                                  static_cast<off_t>(cols * sizeof(double)), POSIX_FADV_WILLNEED);
+        }
+#endif
+    }
+
+    double at(size_t i, size_t j) const {
+        double v = 0.0;
+        pread_all(&v, sizeof(v), offset(i, j));
+        return v;
+    }
+
+private:
+    MatrixFile(std::string path, int fd) : path_(std::move(path)), fd_(fd) {
+        if (fd_ < 0) throw file_error("cannot open", path_);
+    }
+
+    void read_header() {
+        char header[sizeof(kMatrixFileMagic) + 2 * sizeof(uint64_t)] = {};
+        pread_all(header, sizeof(header), 0);
+        if (std::memcmp(header, kMatrixFileMagic, sizeof(kMatrixFileMagic)) != 0) {
+            throw std::runtime_error("not a matrix file (bad magic): " + path_);
+        }
+        uint64_t dims[2];
+        std::memcpy(dims, header + sizeof(kMatrixFileMagic), sizeof(dims));
+        rows_ = dims[0];
+        cols_ = dims[1];
+        struct stat st {};
+        if (::fstat(fd_, &st) != 0) throw file_error("fstat", path_);
+        if (static_cast<size_t>(st.st_size) < file_bytes()) {
+            throw std::runtime_error("matrix file truncated: " + path_);
+        }
+    }
+
+    size_t offset(size_t i, size_t j) const { return kMatrixFileHeader + (i * cols_ + j) * sizeof(double); }
+
+    void pread_all(void* dst, size_t len, size_t off) const {
+        char* p = static_cast<char*>(dst);
+        while (len > 0) {
+            const ssize_t n = ::pread(fd_, p, len, static_cast<off_t>(off));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) throw file_error("pread", path_);
+            p += n;
+            off += static_cast<size_t>(n);
+            len -= static_cast<size_t>(n);
+        }
+    }
+
+    void pwrite_all(const void* src, size_t len, size_t off) {
+        const char* p = static_cast<const char*>(src);
+        while (len > 0) {
+            const ssize_t n = ::pwrite(fd_, p, len, static_cast<off_t>(off));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) throw file_error("pwrite", path_);
+            p += n;
+            off += static_cast<size_t>(n);
+            len -= static_cast<size_t>(n);
+        }
+    }
+
+    std::string path_;
+    int fd_{-1};
+    size_t rows_{0};
+    size_t cols_{0};
+};
+
+// Writes a rows x cols file with the values init_random(..., seed, ...)
+// would produce, so file-backed and in-memory runs multiply the same data.
+inline void create_random_matrix_file(const std::string& path, size_t rows, size_t cols, uint64_t seed) {
+    MatrixFile f = MatrixFile::create(path, rows, cols);
+    const uint64_t key = mix64(seed);
+    const size_t rows_per_write = std::max<size_t>(1, (size_t{8} << 20) / std::max<size_t>(cols * sizeof(double), 1));
+    std::vector<double> buf(rows_per_write * cols);
+    for (size_t r0 = 0; r0 < rows; r0 += rows_per_write) {
+        const size_t n = std::min(rows_per_write, rows - r0);
+        for (size_t i = 0; i < n; ++i) {
+            const uint64_t base = static_cast<uint64_t>(r0 + i) * cols;
+            for (size_t j = 0; j < cols; ++j) buf[i * cols + j] = counter_uniform(key, base + j);
+        }
+        f.write_block(r0, n, 0, cols, buf.data(), cols);
+    }
+}
+
+inline Matrix map_matrix_file(const std::string& path) {
+    const MatrixFile f = MatrixFile::open(path);
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw file_error("cannot open", path);
+    const size_t len = f.file_bytes();
+    void* p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) throw file_error("mmap", path);
+#ifdef MADV_WILLNEED
+    (void)::madvise(p, len, MADV_WILLNEED);
+#endif
+
+    Matrix m;
+    m.rows_ = f.rows();
+    m.cols_ = f.cols();
+    m.ld_ = f.cols();
+    m.set_mapping(p, len, static_cast<char*>(p) + kMatrixFileHeader, base_page_size(), PageMode::File);
+    return m;
+}
+
+struct OocOptions {
+    GemmOptions gemm;                          // kernel, BS and schedule for each panel product
+    size_t memory_bytes{size_t{512} << 20};  // budget for panels and C blocks
+};
+
+struct OocStats {
+    size_t panel{0};          // P
+    size_t steps{0};          // panel products
+    uint64_t bytes_read{0};
+    uint64_t bytes_written{0};
+    double io_wait_s{0.0};    // compute waiting for a panel pair or a C write-back
+    double compute_s{0.0};
+};
+
+// Two A/B panel pairs and two C blocks: 6 P^2 doubles.
+inline size_t ooc_panel(size_t memory_bytes, size_t bs) {
+    bs = std::max<size_t>(bs, 1);
+    const size_t p = static_cast<size_t>(std::sqrt(static_cast<double>(memory_bytes) / (6.0 * sizeof(double))));
+    return std::max(bs, p / bs * bs);
+}
+
+// C = A * B between files (A: M x K, B: K x N, C: M x N, all nn).
+// run_tasks_fn follows the gemm_tasks contract.
+template <typename RunTasks>
+OocStats ooc_gemm(RunTasks&& run_tasks_fn,
+                  const MatrixFile& a, const MatrixFile& b, MatrixFile& c,
+                  const OocOptions& opt) {
+    const size_t M = a.rows(), K = a.cols(), N = b.cols();
+    if (b.rows() != K || c.rows() != M || c.cols() != N) {
+        throw std::invalid_argument("ooc_gemm: dimension mismatch between " + a.path() + ", " + b.path() +
+                                    " and " + c.path());
+    }
+    using Clock = std::chrono::steady_clock;
+    auto since = [](Clock::time_point t0) { return std::chrono::duration<double>(Clock::now() - t0).count(); };
+
+    OocStats st;
+    const size_t P = ooc_panel(opt.memory_bytes, opt.gemm.bs);
+    st.panel = P;
+
+    struct Step {
+        size_t i0, j0, k0;
+    };
+    std::vector<Step> steps;
+    for (size_t i0 = 0; i0 < M; i0 += P) {
+        for (size_t j0 = 0; j0 < N; j0 += P) {
+            for (size_t k0 = 0; k0 < K; k0 += P) steps.push_back(Step{i0, j0, k0});
+        }
+    }
+    st.steps = steps.size();
+    if (steps.empty()) return st;
+
+    struct Panels {
+        AlignedBuffer a, b;
+    };
+    Panels panels[2];
+    AlignedBuffer c_blocks[2];
+    for (int s = 0; s < 2; ++s) {
+        panels[s].a.resize(P * P);
+        panels[s].b.resize(P * P);
+        c_blocks[s].resize(P * P);
+    }
+
+    // Only the P x P blocks the step reads, not the full-width rows around them.
+    auto hint = [&](size_t s) {
+        if (s >= steps.size()) return;
+        a.will_need(steps[s].i0, P, steps[s].k0, P);
+        b.will_need(steps[s].k0, P, steps[s].j0, P);
+    };
+    auto load = [&](size_t s) {
+        const Step& q = steps[s];
+        const size_t m = std::min(P, M - q.i0), n = std::min(P, N - q.j0), k = std::min(P, K - q.k0);
+        hint(s + 1);
+        a.read_block(q.i0, m, q.k0, k, panels[s % 2].a.data(), k);
+        b.read_block(q.k0, k, q.j0, n, panels[s % 2].b.data(), n);
+    };
+
+    std::future<void> loading = std::async(std::launch::async, load, size_t{0});
+    std::future<void> writing;
+    size_t cur_c = 0;
+
+    for (size_t s = 0; s < steps.size(); ++s) {
+        const Step& q = steps[s];
+        const size_t m = std::min(P, M - q.i0), n = std::min(P, N - q.j0), k = std::min(P, K - q.k0);
+
+        auto t0 = Clock::now();
+        loading.get();
+        st.io_wait_s += since(t0);
+        if (s + 1 < steps.size()) {
+            loading = std::async(std::launch::async, load, s + 1);
+        }
+        st.bytes_read += (m * k + k * n) * sizeof(double);
+
+        t0 = Clock::now();
+        gemm_tasks(run_tasks_fn, Trans::No, Trans::No, m, n, k,
+                   1.0, panels[s % 2].a.data(), k, panels[s % 2].b.data(), n,
+                   q.k0 == 0 ? 0.0 : 1.0, c_blocks[cur_c].data(), n, opt.gemm);
+        st.compute_s += since(t0);
+
+        if (q.k0 + P >= K) {
+            // One write-back in flight: the previous one used the other C
+            // buffer, which the next block is about to overwrite.
+            if (writing.valid()) {
+                t0 = Clock::now();
+                writing.get();
+                st.io_wait_s += since(t0);
+            }
+            const double* block = c_blocks[cur_c].data();
+            writing = std::async(std::launch::async, [&c, q, m, n, block] {
+                c.write_block(q.i0, m, q.j0, n, block, n);
+            });
+            st.bytes_written += m * n * sizeof(double);
+            cur_c ^= 1;
+        }
+    }
+
+    const auto t0 = Clock::now();
+    if (writing.valid()) writing.get();
+    st.io_wait_s += since(t0);
+    return st;
+}
+
+}  // namespace matmul
@@ -0,0 +1,144 @@
+#pragma once
+
+// Compile-time specialized C = A * B for square N x N row-major matrices with
+// a fixed block size, for the small per-request products of
+// mini_http_server_matmul.
+//
+// With N and BS as template parameters every loop bound, leading dimension and
+// tile offset is a constant: the k loop of a register tile is unrolled, the
+// first K block starts from zero accumulators instead of a separate zero-fill
+// pass, and there are no row/column remainders. Only the sizes listed in
+// kFixedSizes are instantiated; find_fixed_kernel() returns nullptr for
+// anything else so callers keep the generic blocked loop.
+
+#include "cpu_dispatch.h"
+
+#include <cstddef>
+#include <utility>
+
+namespace matmul {
+
+using FixedKernelFn = void (*)(const double* a, const double* b, double* c);
+
+// Register tile: MR rows x two W-wide vectors. The vector type is aligned(8)
+// so loads and stores from plain double arrays are unaligned accesses.
+template <size_t N, size_t BS, size_t W, size_t... R>
+__attribute__((always_inline)) inline void fixed_tile(std::index_sequence<R...>,
+                                                      bool first,
+                                                      const double* a,
+                                                      const double* b,
+                                                      double* c) {
+    typedef double Vec __attribute__((vector_size(W * sizeof(double)), aligned(sizeof(double))));
+    Vec c0[sizeof...(R)], c1[sizeof...(R)];
+    if (first) {
+        ((c0[R] = Vec{}, c1[R] = Vec{}), ...);
+    } else {
+        ((c0[R] = *reinterpret_cast<const Vec*>(c + R * N),
+          c1[R] = *reinterpret_cast<const Vec*>(c + R * N + W)), ...);
+    }
+    // Unrolling further (fully, for BS=16) made GCC spill AVX-512 accumulators.
+#pragma GCC unroll 4
+    for (size_t p = 0; p < BS; ++p) {
+        const Vec b0 = *reinterpret_cast<const Vec*>(b + p * N);
+        const Vec b1 = *reinterpret_cast<const Vec*>(b + p * N + W);
+        ((c0[R] += a[R * N + p] * b0, c1[R] += a[R * N + p] * b1), ...);
+    }
+    ((*reinterpret_cast<Vec*>(c + R * N) = c0[R], *reinterpret_cast<Vec*>(c + R * N + W) = c1[R]), ...);
+}
+
+template <size_t N, size_t BS, size_t W, size_t MR>
+__attribute__((always_inline)) inline void fixed_body(const double* a, const double* b, double* c) {
+    constexpr size_t NR = 2 * W;
+    static_assert(N % BS == 0, "N must be a multiple of BS");
+    static_assert(BS % MR == 0 && BS % NR == 0, "BS must be a multiple of the register tile");
+
+    for (size_t i0 = 0; i0 < N; i0 += BS) {
+        for (size_t j0 = 0; j0 < N; j0 += BS) {
+            for (size_t k0 = 0; k0 < N; k0 += BS) {
+                for (size_t i = i0; i < i0 + BS; i += MR) {
+                    for (size_t j = j0; j < j0 + BS; j += NR) {
+                        fixed_tile<N, BS, W>(std::make_index_sequence<MR>{}, k0 == 0,
+                                             a + i * N + k0, b + k0 * N + j, c + i * N + j);
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <size_t N, size_t BS>
+void matmul_fixed_portable(const double* a, const double* b, double* c) {
+    fixed_body<N, BS, 2, 4>(a, b, c);
+}
+
+#if CPU_DISPATCH_X86
+template <size_t N, size_t BS>
+__attribute__((target("sse2"))) void matmul_fixed_sse2(const double* a, const double* b, double* c) {
+    fixed_body<N, BS, 2, 4>(a, b, c);
+}
+
+template <size_t N, size_t BS>
+__attribute__((target("avx2,fma"))) void matmul_fixed_avx2(const double* a, const double* b, double* c) {
+    fixed_body<N, BS, 4, 4>(a, b, c);
+}
+
+template <size_t N, size_t BS>
+__attribute__((target("avx512f"))) void matmul_fixed_avx512(const double* a, const double* b, double* c) {
+    fixed_body<N, BS, 8, 8>(a, b, c);
+}
+#endif
+
+template <size_t N, size_t BS>
+FixedKernelFn fixed_kernel_for(cpu::Isa isa) {
+#if CPU_DISPATCH_X86
+    switch (isa) {
+        case cpu::Isa::Sse2: return matmul_fixed_sse2<N, BS>;
+        case cpu::Isa::Avx2: return matmul_fixed_avx2<N, BS>;
+        case cpu::Isa::Avx512: return matmul_fixed_avx512<N, BS>;
+        case cpu::Isa::Portable: break;
+    }
+#else
+    (void)isa;
+#endif
+    return matmul_fixed_portable<N, BS>;
+}
+
+// C = A * B for the process-wide dispatched ISA.
+template <size_t N, size_t BS>
+void matmul_fixed(const double* a, const double* b, double* c) {
+    static const FixedKernelFn fn = fixed_kernel_for<N, BS>(cpu::selected_isa());
+    fn(a, b, c);
+}
+
+struct FixedSize {
+    size_t n;
+    size_t bs;
+    FixedKernelFn (*for_isa)(cpu::Isa);
+};
+
+// Every (N, BS) with an instantiated specialization. BS >= 16 keeps the
+// 16-column AVX-512 register tile inside one block.
+inline constexpr FixedSize kFixedSizes[] = {
+    {16, 16, fixed_kernel_for<16, 16>},
+    {32, 16, fixed_kernel_for<32, 16>},
+    {32, 32, fixed_kernel_for<32, 32>},
+    {48, 16, fixed_kernel_for<48, 16>},
+    {64, 16, fixed_kernel_for<64, 16>},
+    {64, 32, fixed_kernel_for<64, 32>},
+    {64, 64, fixed_kernel_for<64, 64>},
+    {96, 32, fixed_kernel_for<96, 32>},
+    {128, 32, fixed_kernel_for<128, 32>},
+    {128, 64, fixed_kernel_for<128, 64>},
+};
+
+// Specialization for an n x n product with block size bs, or nullptr.
+inline FixedKernelFn find_fixed_kernel(size_t n, size_t bs, cpu::Isa isa) {
+    for (const FixedSize& s : kFixedSizes) {
+        if (s.n == n && s.bs == bs) {
+            return s.for_isa(isa);
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace matmul
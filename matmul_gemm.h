@@ -0,0 +1,374 @@
+#pragma once
+
+// General matrix multiply on the tile scheduler:
+//
+//   C = alpha * op(A) * op(B) + beta * C
+//
+// op(X) is X or X^T. All matrices are row-major with explicit leading
+// dimensions: op(A) is M x K, op(B) is K x N and C is M x N. Every BS x BS
+// output tile is one independent task, so the same code runs on any pool kind
+// (gemm) or on any other task runner, e.g. coroutines (gemm_tasks).
+//
+// When the output has fewer tiles than workers (small C, long K), gemm
+// switches to split-K: each (tile, K slice) task writes a private partial
+// tile and a second parallel phase sums the partials into C in a fixed
+// order, so results do not depend on scheduling.
+//
+// Tiles are handed to the runner in opt.order (matmul_order.h); the order
+// only changes which tiles run together, never the result.
+//
+// Operands are read in place when no transform is needed. A transposed
+// operand, or A with alpha != 1, is copied per K block into a thread-local
+// scratch buffer in the orientation the micro-kernels expect. beta == 0
+// overwrites C without reading it, as in BLAS.
+
+#include "matmul_kernels.h"
+#include "matmul_order.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace matmul {
+
+enum class Trans { No, Yes };
+
+enum class GemmSchedule { Auto, OutputTiles, SplitK };
+
+struct GemmOptions {
+    const Kernel* kernel{nullptr};  // nullptr: dispatched_kernel()
+    size_t bs{64};                  // output tile edge and K block
+    GemmSchedule schedule{GemmSchedule::Auto};
+    size_t workers{0};              // threads behind the runner; 0: hardware_concurrency
+    size_t splits{0};               // split-K slices; 0: derived from shape and workers
+    TileOrder order{TileOrder::RowMajor};
+};
+
+struct GemmPlan {
+    size_t tiles;   // output tiles
+    size_t splits;  // K slices per tile; 1 means plain output tiling
+};
+
+// Output tile of task t under opt.order: order[t], or t when order is empty.
+inline size_t ordered_tile(const std::vector<uint32_t>& order, size_t t) {
+    return order.empty() ? t : order[t];
+}
+
+// Minimum K depth per slice under Auto; shallower slices spend more time in
+// the reduction than they save in parallelism.
+constexpr size_t kSplitKMinDepth = 256;
+
+// Largest split-K partial buffer (in doubles, 16 MiB) kept alive in the
+// calling thread between calls. Bigger requests get a buffer that is freed
+// when the call returns, so one huge multiply does not pin its scratch for
+// the lifetime of the thread.
+constexpr size_t kSplitKScratchKeep = size_t{2} << 20;
+
+inline size_t gemm_workers(const GemmOptions& opt) {
+    return opt.workers != 0 ? opt.workers : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+inline GemmPlan plan_gemm(size_t M, size_t N, size_t K, const GemmOptions& opt) {
+    const size_t bs = std::max<size_t>(opt.bs, 1);
+    const size_t tiles = ((M + bs - 1) / bs) * ((N + bs - 1) / bs);
+    const size_t k_blocks = std::max<size_t>((K + bs - 1) / bs, 1);
+    const size_t workers = gemm_workers(opt);
+    // Two tasks per worker leaves some slack for uneven tiles.
+    const size_t wanted = tiles == 0 ? 1 : (2 * workers + tiles - 1) / tiles;
+
+    size_t splits = 1;
+    switch (opt.schedule) {
+        case GemmSchedule::OutputTiles:
+            break;
+        case GemmSchedule::SplitK:
+            splits = opt.splits != 0 ? opt.splits : std::max<size_t>(wanted, 2);
+            break;
+        case GemmSchedule::Auto:
+            if (tiles < workers) {
+                splits = std::min(wanted, K / kSplitKMinDepth);
+            }
+            break;
+    }
+    return GemmPlan{tiles, std::clamp<size_t>(splits, 1, k_blocks)};
+}
+
+// Runs fn(0) .. fn(count - 1) as pool tasks and blocks until all of them finish.
+template <typename Pool, typename Fn>
+void run_tasks(Pool& pool, size_t count, const Fn& fn) {
+    if (count == 0) return;
+
+    // done is only touched under m, so the waiter cannot see the last count
+    // (and return, ending the lifetime of everything captured here) until the
+    // last task has released the lock and stopped using the frame.
+    size_t done = 0;
+    std::mutex m;
+    std::condition_variable cv;
+
+    for (size_t t = 0; t < count; ++t) {
+        pool.submit([&, t] {
+            fn(t);
+            std::lock_guard<std::mutex> lk(m);
+            if (++done == count) cv.notify_one();
+        });
+    }
+
+    std::unique_lock<std::mutex> lk(m);
+    cv.wait(lk, [&] { return done == count; });
+}
+
+// run_tasks for callers that are themselves pool workers. The caller claims
+// indices too and submits at most lanes - 1 helpers, so it only ever waits on
+// helpers that are already running an index: one still queued behind busy
+// workers finds nothing left to claim and returns without touching fn. That
+// makes nesting safe on every pool kind, including a saturated fixed pool,
+// and lanes == 1 is a plain serial loop. Returns the number of indices run by
+// helpers.
+template <typename Pool, typename Fn>
+size_t run_tasks_nested(Pool& pool, size_t count, size_t lanes, const Fn& fn) {
+    lanes = std::min(lanes, count);
+    if (lanes <= 1) {
+        for (size_t t = 0; t < count; ++t) fn(t);
+        return 0;
+    }
+
+    // Shared with helpers that may start after this call has returned.
+    struct State {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::mutex m;
+        std::condition_variable cv;
+    };
+    const auto st = std::make_shared<State>();
+    const Fn* f = &fn;
+
+    for (size_t h = 1; h < lanes; ++h) {
+        pool.submit([st, f, count] {
+            for (size_t t; (t = st->next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+                (*f)(t);
+                if (st->done.fetch_add(1, std::memory_order_acq_rel) + 1 == count) {
+                    std::lock_guard<std::mutex> lk(st->m);
+                    st->cv.notify_one();
+                }
+            }
+        });
+    }
+
+    size_t own = 0;
+    for (size_t t; (t = st->next.fetch_add(1, std::memory_order_relaxed)) < count; ++own) fn(t);
+    const size_t total = st->done.fetch_add(own, std::memory_order_acq_rel) + own;
+    if (total != count) {
+        std::unique_lock<std::mutex> lk(st->m);
+        st->cv.wait(lk, [&] { return st->done.load(std::memory_order_acquire) == count; });
+    }
+    return count - own;
+}
+
+inline void scale_tile(size_t m, size_t n, double beta, double* c, size_t ldc) {
+    if (beta == 1.0) return;
+    for (size_t i = 0; i < m; ++i) {
+        double* ci = c + i * ldc;
+        if (beta == 0.0) {
+            std::fill(ci, ci + n, 0.0);
+        } else {
+            for (size_t j = 0; j < n; ++j) ci[j] *= beta;
+        }
+    }
+}
+
+// One output tile: C[i0.., j0..] = alpha * op(A) * op(B) + beta * C.
+inline void gemm_tile(const Kernel& kernel,
+                      Trans trans_a, Trans trans_b,
+                      size_t M, size_t N, size_t K,
+                      double alpha,
+                      const double* a, size_t lda,
+                      const double* b, size_t ldb,
+                      double beta,
+                      double* c, size_t ldc,
+                      size_t bs, size_t i0, size_t j0) {
+    const size_t m = std::min(bs, M - i0);
+    const size_t n = std::min(bs, N - j0);
+    double* ct = c + i0 * ldc + j0;
+
+    // beta == 0 with a non-empty product: the first k-block overwrites the
+    // tile, so it is never zero-filled (or read) beforehand.
+    const bool overwrite_first = beta == 0.0 && K > 0 && alpha != 0.0;
+    if (!overwrite_first) scale_tile(m, n, beta, ct, ldc);
+    if (K == 0 || alpha == 0.0) return;
+
+    const bool copy_a = trans_a == Trans::Yes || alpha != 1.0;
+    const bool copy_b = trans_b == Trans::Yes;
+    thread_local AlignedBuffer a_buf;
+    thread_local AlignedBuffer b_buf;
+    if (copy_a) a_buf.resize(bs * bs);
+    if (copy_b) b_buf.resize(bs * bs);
+
+    for (size_t k0 = 0; k0 < K; k0 += bs) {
+        const size_t kc = std::min(bs, K - k0);
+
+        const double* ak = a + i0 * lda + k0;
+        size_t ak_ld = lda;
+        if (copy_a) {
+            double* dst = a_buf.data();
+            if (trans_a == Trans::No) {
+                for (size_t r = 0; r < m; ++r) {
+                    for (size_t p = 0; p < kc; ++p) dst[r * kc + p] = alpha * ak[r * lda + p];
+                }
+            } else {
+                const double* src = a + k0 * lda + i0;
+                for (size_t p = 0; p < kc; ++p) {
+                    for (size_t r = 0; r < m; ++r) dst[r * kc + p] = alpha * src[p * lda + r];
+                }
+            }
+            ak = dst;
+            ak_ld = kc;
+        }
+
+        const double* bk = b + k0 * ldb + j0;
+        size_t bk_ld = ldb;
+        if (copy_b) {
+            double* dst = b_buf.data();
+            const double* src = b + j0 * ldb + k0;
+            for (size_t j = 0; j < n; ++j) {
+                for (size_t p = 0; p < kc; ++p) dst[p * n + j] = src[j * ldb + p];
+            }
+            bk = dst;
+            bk_ld = n;
+        }
+
+        multiply_block(kernel, m, n, kc, ak, ak_ld, bk, bk_ld, ct, ldc, overwrite_first && k0 == 0);
+    }
+}
+
+inline void check_gemm_args(Trans trans_a, Trans trans_b,
+                            size_t M, size_t N, size_t K,
+                            size_t lda, size_t ldb, size_t ldc, size_t bs) {
+    const size_t a_cols = trans_a == Trans::No ? K : M;
+    const size_t b_cols = trans_b == Trans::No ? N : K;
+    if (bs == 0) {
+        throw std::invalid_argument("gemm: block size must be > 0");
+    }
+    if (lda < std::max<size_t>(a_cols, 1) || ldb < std::max<size_t>(b_cols, 1) ||
+        ldc < std::max<size_t>(N, 1)) {
+        throw std::invalid_argument("gemm: leading dimension smaller than row length (lda=" +
+                                    std::to_string(lda) + " ldb=" + std::to_string(ldb) +
+                                    " ldc=" + std::to_string(ldc) + ")");
+    }
+}
+
+// Split-K body. Slice s covers K blocks [s * k_blocks / splits, (s + 1) *
+// k_blocks / splits) and writes alpha * op(A) * op(B) for that slice into
+// partial s (M x N, ld = N). The reduction then applies beta and sums the
+// partials row block by row block.
+template <typename RunTasks>
+void gemm_split_k(RunTasks&& run_tasks_fn,
+                  const Kernel& kernel, const GemmPlan& plan, size_t workers,
+                  const std::vector<uint32_t>& order,
+                  Trans trans_a, Trans trans_b,
+                  size_t M, size_t N, size_t K,
+                  double alpha,
+                  const double* a, size_t lda,
+                  const double* b, size_t ldb,
+                  double beta,
+                  double* c, size_t ldc,
+                  size_t bs) {
+    const size_t splits = plan.splits;
+    const size_t tiles_j = (N + bs - 1) / bs;
+    const size_t k_blocks = (K + bs - 1) / bs;
+    const size_t partial_size = M * N;
+
+    // Reused across calls from the same caller thread up to kSplitKScratchKeep.
+    thread_local AlignedBuffer scratch;
+    AlignedBuffer oversized;
+    double* partials = nullptr;
+    if (splits * partial_size <= kSplitKScratchKeep) {
+        scratch.resize(splits * partial_size);
+        partials = scratch.data();
+    } else {
+        oversized.resize(splits * partial_size);
+        partials = oversized.data();
+    }
+
+    run_tasks_fn(plan.tiles * splits, [&](size_t t) {
+        const size_t tile = ordered_tile(order, t / splits);
+        const size_t s = t % splits;
+        const size_t k_lo = std::min(K, (s * k_blocks / splits) * bs);
+        const size_t k_hi = std::min(K, ((s + 1) * k_blocks / splits) * bs);
+        const double* a_slice = trans_a == Trans::No ? a + k_lo : a + k_lo * lda;
+        const double* b_slice = trans_b == Trans::No ? b + k_lo * ldb : b + k_lo;
+        gemm_tile(kernel, trans_a, trans_b, M, N, k_hi - k_lo, alpha, a_slice, lda, b_slice, ldb,
+                  0.0, partials + s * partial_size, N,
+                  bs, (tile / tiles_j) * bs, (tile % tiles_j) * bs);
+    });
+
+    const size_t rows_per_task = std::max<size_t>(1, (M + 2 * workers - 1) / (2 * workers));
+    run_tasks_fn((M + rows_per_task - 1) / rows_per_task, [&](size_t t) {
+        const size_t r0 = t * rows_per_task;
+        const size_t r1 = std::min(M, r0 + rows_per_task);
+        scale_tile(r1 - r0, N, beta, c + r0 * ldc, ldc);
+        for (size_t s = 0; s < splits; ++s) {
+            const double* p = partials + s * partial_size;
+            for (size_t i = r0; i < r1; ++i) {
+                double* ci = c + i * ldc;
+                const double* pi = p + i * N;
+                for (size_t j = 0; j < N; ++j) ci[j] += pi[j];
+            }
+        }
+    });
+}
+
+// gemm on a caller-supplied runner: run_tasks_fn(count, fn) must call
+// fn(0) .. fn(count - 1), possibly in parallel, and return once all finish.
+template <typename RunTasks>
+void gemm_tasks(RunTasks&& run_tasks_fn,
+                Trans trans_a, Trans trans_b,
+                size_t M, size_t N, size_t K,
+                double alpha,
+                const double* a, size_t lda,
+                const double* b, size_t ldb,
+                double beta,
+                double* c, size_t ldc,
+                const GemmOptions& opt = {}) {
+    check_gemm_args(trans_a, trans_b, M, N, K, lda, ldb, ldc, opt.bs);
+    if (M == 0 || N == 0) return;
+
+    const Kernel& kernel = opt.kernel != nullptr ? *opt.kernel : dispatched_kernel();
+    const size_t bs = opt.bs;
+    const GemmPlan plan = plan_gemm(M, N, K, opt);
+    const size_t tiles_j = (N + bs - 1) / bs;
+    const std::vector<uint32_t>& order =
+        cached_tile_order((M + bs - 1) / bs, tiles_j, opt.order, gemm_workers(opt));
+    if (plan.splits > 1 && alpha != 0.0) {
+        gemm_split_k(run_tasks_fn, kernel, plan, gemm_workers(opt), order, trans_a, trans_b, M, N, K,
+                     alpha, a, lda, b, ldb, beta, c, ldc, bs);
+        return;
+    }
+
+    run_tasks_fn(plan.tiles, [&](size_t t) {
+        const size_t tile = ordered_tile(order, t);
+        gemm_tile(kernel, trans_a, trans_b, M, N, K, alpha, a, lda, b, ldb, beta, c, ldc,
+                  bs, (tile / tiles_j) * bs, (tile % tiles_j) * bs);
+    });
+}
+
+template <typename Pool>
+void gemm(Pool& pool,
+          Trans trans_a, Trans trans_b,
+          size_t M, size_t N, size_t K,
+          double alpha,
+          const double* a, size_t lda,
+          const double* b, size_t ldb,
+          double beta,
+          double* c, size_t ldc,
+          const GemmOptions& opt = {}) {
+    gemm_tasks([&](size_t count, const auto& fn) { run_tasks(pool, count, fn); },
+               trans_a, trans_b, M, N, K, alpha, a, lda, b, ldb, beta, c, ldc, opt);
+}
+
+}  // namespace matmul
@@ -0,0 +1,425 @@
+#pragma once
+
+// Register-blocked double-precision matmul micro-kernels shared by
+// matrix_mul_bench, mini_http_server_matmul and the matrix unit tests.
+//
+// Every kernel computes C[rows x nr] += A[rows x kc] * B[kc x nr] on row-major
+// operands with explicit leading dimensions, keeping the whole C block in
+// registers for the full k loop. The overwrite variants (C = A * B, beta = 0)
+// start from zero accumulators and never read C, so callers producing a fresh
+// result skip the zero-fill pass. Vector variants are compiled with per-function
+// target attributes, so the default build flags stay unchanged; "auto" resolves
+// to the kernel for the ISA chosen once by cpu_dispatch.h.
+
+#include "cpu_dispatch.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if CPU_DISPATCH_X86
+#include <immintrin.h>
+#endif
+
+namespace matmul {
+
+using MicroKernelFn = void (*)(size_t kc,
+                               const double* a, size_t lda,
+                               const double* b, size_t ldb,
+                               double* c, size_t ldc);
+
+constexpr size_t kMaxMr = 8;
+constexpr size_t kMaxNr = 16;
+
+struct Kernel {
+    const char* name;
+    size_t mr;
+    size_t nr;
+    // rows[r - 1] handles an r x nr block, so row remainders stay vectorized.
+    MicroKernelFn rows[kMaxMr];
+    MicroKernelFn rows_overwrite[kMaxMr];  // same blocks, C = A * B
+};
+
+// Portable 4x4 kernel: plain arrays the compiler keeps in registers.
+template <size_t R, bool Accumulate = true>
+inline void micro_portable(size_t kc,
+                           const double* a, size_t lda,
+                           const double* b, size_t ldb,
+                           double* c, size_t ldc) {
+    constexpr size_t NR = 4;
+    double acc[R][NR];
+    for (size_t r = 0; r < R; ++r) {
+        for (size_t j = 0; j < NR; ++j) acc[r][j] = Accumulate ? c[r * ldc + j] : 0.0;
+    }
+    for (size_t p = 0; p < kc; ++p) {
+        const double* bp = b + p * ldb;
+        for (size_t r = 0; r < R; ++r) {
+            const double ar = a[r * lda + p];
+            for (size_t j = 0; j < NR; ++j) acc[r][j] += ar * bp[j];
+        }
+    }
+    for (size_t r = 0; r < R; ++r) {
+        for (size_t j = 0; j < NR; ++j) c[r * ldc + j] = acc[r][j];
+    }
+}
+
+// The vector kernels spell their row loops as folds over std::index_sequence
+// so every accumulator index is a compile-time constant; with plain loops GCC
+// keeps the vector accumulator arrays in memory and spills after every FMA.
+
+#if CPU_DISPATCH_X86
+// SSE2 4x4 kernel: 8 xmm accumulators + 2 B vectors + 1 broadcast.
+template <bool Accumulate, size_t... R>
+__attribute__((target("sse2"))) inline void micro_sse2_rows(std::index_sequence<R...>,
+                                                            size_t kc,
+                                                            const double* a, size_t lda,
+                                                            const double* b, size_t ldb,
+                                                            double* c, size_t ldc) {
+    __m128d c0[sizeof...(R)], c1[sizeof...(R)];
+    if constexpr (Accumulate) {
+        ((c0[R] = _mm_loadu_pd(c + R * ldc), c1[R] = _mm_loadu_pd(c + R * ldc + 2)), ...);
+    } else {
+        ((c0[R] = _mm_setzero_pd(), c1[R] = _mm_setzero_pd()), ...);
+    }
+    for (size_t p = 0; p < kc; ++p) {
+        const __m128d b0 = _mm_loadu_pd(b + p * ldb);
+        const __m128d b1 = _mm_loadu_pd(b + p * ldb + 2);
+        ((c0[R] = _mm_add_pd(c0[R], _mm_mul_pd(_mm_set1_pd(a[R * lda + p]), b0)),
+          c1[R] = _mm_add_pd(c1[R], _mm_mul_pd(_mm_set1_pd(a[R * lda + p]), b1))), ...);
+    }
+    ((_mm_storeu_pd(c + R * ldc, c0[R]), _mm_storeu_pd(c + R * ldc + 2, c1[R])), ...);
+}
+
+template <size_t R, bool Accumulate = true>
+__attribute__((target("sse2"))) inline void micro_sse2(size_t kc,
+                                                       const double* a, size_t lda,
+                                                       const double* b, size_t ldb,
+                                                       double* c, size_t ldc) {
+    micro_sse2_rows<Accumulate>(std::make_index_sequence<R>{}, kc, a, lda, b, ldb, c, ldc);
+}
+
+// AVX2/FMA 6x8 kernel: 12 ymm accumulators + 2 B vectors + 1 broadcast.
+template <bool Accumulate, size_t... R>
+__attribute__((target("avx2,fma"))) inline void micro_avx2_rows(std::index_sequence<R...>,
+                                                                size_t kc,
+                                                                const double* a, size_t lda,
+                                                                const double* b, size_t ldb,
+                                                                double* c, size_t ldc) {
+    __m256d c0[sizeof...(R)], c1[sizeof...(R)];
+    if constexpr (Accumulate) {
+        ((c0[R] = _mm256_loadu_pd(c + R * ldc), c1[R] = _mm256_loadu_pd(c + R * ldc + 4)), ...);
+    } else {
+        ((c0[R] = _mm256_setzero_pd(), c1[R] = _mm256_setzero_pd()), ...);
+    }
+    for (size_t p = 0; p < kc; ++p) {
+        const __m256d b0 = _mm256_loadu_pd(b + p * ldb);
+        const __m256d b1 = _mm256_loadu_pd(b + p * ldb + 4);
+        ((c0[R] = _mm256_fmadd_pd(_mm256_broadcast_sd(a + R * lda + p), b0, c0[R]),
+          c1[R] = _mm256_fmadd_pd(_mm256_broadcast_sd(a + R * lda + p), b1, c1[R])), ...);
+    }
+    ((_mm256_storeu_pd(c + R * ldc, c0[R]), _mm256_storeu_pd(c + R * ldc + 4, c1[R])), ...);
+}
+
+template <size_t R, bool Accumulate = true>
+__attribute__((target("avx2,fma"))) inline void micro_avx2(size_t kc,
+                                                           const double* a, size_t lda,
+                                                           const double* b, size_t ldb,
+                                                           double* c, size_t ldc) {
+    micro_avx2_rows<Accumulate>(std::make_index_sequence<R>{}, kc, a, lda, b, ldb, c, ldc);
+}
+
+// AVX-512 8x16 kernel: 16 zmm accumulators, half the register file left for loads.
+template <bool Accumulate, size_t... R>
+__attribute__((target("avx512f"))) inline void micro_avx512_rows(std::index_sequence<R...>,
+                                                                 size_t kc,
+                                                                 const double* a, size_t lda,
+                                                                 const double* b, size_t ldb,
+                                                                 double* c, size_t ldc) {
+    __m512d c0[sizeof...(R)], c1[sizeof...(R)];
+    if constexpr (Accumulate) {
+        ((c0[R] = _mm512_loadu_pd(c + R * ldc), c1[R] = _mm512_loadu_pd(c + R * ldc + 8)), ...);
+    } else {
+        ((c0[R] = _mm512_setzero_pd(), c1[R] = _mm512_setzero_pd()), ...);
+    }
+    for (size_t p = 0; p < kc; ++p) {
+        const __m512d b0 = _mm512_loadu_pd(b + p * ldb);
+        const __m512d b1 = _mm512_loadu_pd(b + p * ldb + 8);
+        ((c0[R] = _mm512_fmadd_pd(_mm512_set1_pd(a[R * lda + p]), b0, c0[R]),
+          c1[R] = _mm512_fmadd_pd(_mm512_set1_pd(a[R * lda + p]), b1, c1[R])), ...);
+    }
+    ((_mm512_storeu_pd(c + R * ldc, c0[R]), _mm512_storeu_pd(c + R * ldc + 8, c1[R])), ...);
+}
+
+template <size_t R, bool Accumulate = true>
+__attribute__((target("avx512f"))) inline void micro_avx512(size_t kc,
+                                                            const double* a, size_t lda,
+                                                            const double* b, size_t ldb,
+                                                            double* c, size_t ldc) {
+    micro_avx512_rows<Accumulate>(std::make_index_sequence<R>{}, kc, a, lda, b, ldb, c, ldc);
+}
+#endif
+
+inline const Kernel& portable_kernel() {
+    static const Kernel k{"portable", 4, 4,
+                          {micro_portable<1>, micro_portable<2>, micro_portable<3>, micro_portable<4>,
+                           nullptr, nullptr, nullptr, nullptr},
+                          {micro_portable<1, false>, micro_portable<2, false>, micro_portable<3, false>,
+                           micro_portable<4, false>, nullptr, nullptr, nullptr, nullptr}};
+    return k;
+}
+
+#if CPU_DISPATCH_X86
+inline const Kernel& sse2_kernel() {
+    static const Kernel k{"sse2", 4, 4,
+                          {micro_sse2<1>, micro_sse2<2>, micro_sse2<3>, micro_sse2<4>,
+                           nullptr, nullptr, nullptr, nullptr},
+                          {micro_sse2<1, false>, micro_sse2<2, false>, micro_sse2<3, false>, micro_sse2<4, false>,
+                           nullptr, nullptr, nullptr, nullptr}};
+    return k;
+}
+
+inline const Kernel& avx2_kernel() {
+    static const Kernel k{"avx2", 6, 8,
+                          {micro_avx2<1>, micro_avx2<2>, micro_avx2<3>,
+                           micro_avx2<4>, micro_avx2<5>, micro_avx2<6>,
+                           nullptr, nullptr},
+                          {micro_avx2<1, false>, micro_avx2<2, false>, micro_avx2<3, false>,
+                           micro_avx2<4, false>, micro_avx2<5, false>, micro_avx2<6, false>,
+                           nullptr, nullptr}};
+    return k;
+}
+
+inline const Kernel& avx512_kernel() {
+    static const Kernel k{"avx512", 8, 16,
+                          {micro_avx512<1>, micro_avx512<2>, micro_avx512<3>, micro_avx512<4>,
+                           micro_avx512<5>, micro_avx512<6>, micro_avx512<7>, micro_avx512<8>},
+                          {micro_avx512<1, false>, micro_avx512<2, false>, micro_avx512<3, false>,
+                           micro_avx512<4, false>, micro_avx512<5, false>, micro_avx512<6, false>,
+                           micro_avx512<7, false>, micro_avx512<8, false>}};
+    return k;
+}
+#endif
+
+inline const Kernel& kernel_for(cpu::Isa isa) {
+#if CPU_DISPATCH_X86
+    switch (isa) {
+        case cpu::Isa::Sse2: return sse2_kernel();
+        case cpu::Isa::Avx2: return avx2_kernel();
+        case cpu::Isa::Avx512: return avx512_kernel();
+        case cpu::Isa::Portable: break;
+    }
+#else
+    (void)isa;
+#endif
+    return portable_kernel();
+}
+
+// All kernels the current CPU can run, slowest first.
+inline std::vector<const Kernel*> supported_kernels() {
+    std::vector<const Kernel*> out;
+    for (cpu::Isa isa : {cpu::Isa::Portable, cpu::Isa::Sse2, cpu::Isa::Avx2, cpu::Isa::Avx512}) {
+        if (cpu::supports(cpu::features(), isa)) {
+            out.push_back(&kernel_for(isa));
+        }
+    }
+    return out;
+}
+
+// Kernel for the process-wide dispatched ISA (see cpu_dispatch.h).
+inline const Kernel& dispatched_kernel() {
+    return kernel_for(cpu::selected_isa());
+}
+
+// "auto" selects the dispatched kernel. Returns nullptr for unknown names and
+// for kernels the CPU cannot run.
+inline const Kernel* find_kernel(const std::string& name) {
+    if (name == "auto") {
+        return &dispatched_kernel();
+    }
+    for (const Kernel* k : supported_kernels()) {
+        if (name == k->name) {
+            return k;
+        }
+    }
+    return nullptr;
+}
+
+// C[m x n] += A[m x kc] * B[kc x n], or C = A * B with overwrite set. Full-width
+// column blocks go through the micro-kernel; the last n % nr columns fall back
+// to a scalar loop.
+inline void multiply_block(const Kernel& k,
+                           size_t m, size_t n, size_t kc,
+                           const double* a, size_t lda,
+                           const double* b, size_t ldb,
+                           double* c, size_t ldc,
+                           bool overwrite = false) {
+    const size_t n_full = n - n % k.nr;
+    for (size_t i = 0; i < m; i += k.mr) {
+        const size_t rows = std::min(k.mr, m - i);
+        const MicroKernelFn fn = overwrite ? k.rows_overwrite[rows - 1] : k.rows[rows - 1];
+        const double* ai = a + i * lda;
+        double* ci = c + i * ldc;
+        for (size_t j = 0; j < n_full; j += k.nr) {
+            fn(kc, ai, lda, b + j, ldb, ci + j, ldc);
+        }
+        if (n_full == n) {
+            continue;
+        }
+        for (size_t r = 0; r < rows; ++r) {
+            if (overwrite) std::fill(ci + r * ldc + n_full, ci + r * ldc + n, 0.0);
+            for (size_t p = 0; p < kc; ++p) {
+                const double arp = ai[r * lda + p];
+                const double* bp = b + p * ldb;
+                for (size_t j = n_full; j < n; ++j) {
+                    ci[r * ldc + j] += arp * bp[j];
+                }
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// GotoBLAS-style packed path.
+//
+// B is packed per (KC x NC) panel into NR-wide column slivers padded with
+// zeros, so every micro-kernel call runs at full width with ldb = NR. A is
+// packed per (MC x KC) block into contiguous row-major storage (lda = KC),
+// which makes each MR-row sliver one contiguous run. The caller owns the
+// parallel schedule; everything below is single-threaded and shares nothing.
+// ---------------------------------------------------------------------------
+
+struct CacheInfo {
+    size_t l1d;
+    size_t l2;
+    size_t l3;
+};
+
+// Falls back to conservative defaults where sysconf does not report caches.
+inline CacheInfo detect_caches() {
+    CacheInfo info{32 * 1024, 1024 * 1024, 8 * 1024 * 1024};
+#if defined(_SC_LEVEL1_DCACHE_SIZE)
+    auto query = [](int name, size_t& out) {
+        const long v = ::sysconf(name);
+        if (v > 0) out = static_cast<size_t>(v);
+    };
+    query(_SC_LEVEL1_DCACHE_SIZE, info.l1d);
+    query(_SC_LEVEL2_CACHE_SIZE, info.l2);
+    query(_SC_LEVEL3_CACHE_SIZE, info.l3);
+#endif
+    return info;
+}
+
+struct PackedBlocking {
+    size_t mc;
+    size_t kc;
+    size_t nc;
+};
+
+// Sizes each packed operand to half of the cache level it should live in:
+// a KC x NR B sliver in L1, an MC x KC A block in L2, a KC x NC B panel in L3.
+inline PackedBlocking packed_blocking_for(const Kernel& k, const CacheInfo& caches) {
+    auto round_down = [](size_t v, size_t m) { return std::max(m, v - v % m); };
+    PackedBlocking pb{};
+    pb.kc = std::clamp<size_t>(caches.l1d / 2 / (k.nr * sizeof(double)), 64, 512);
+    pb.kc = round_down(pb.kc, 8);
+    pb.mc = round_down(std::clamp<size_t>(caches.l2 / 2 / (pb.kc * sizeof(double)), k.mr, 1024), k.mr);
+    pb.nc = round_down(std::clamp<size_t>(caches.l3 / 2 / (pb.kc * sizeof(double)), k.nr, 4096), k.nr);
+    return pb;
+}
+
+// 64-byte aligned, uninitialized scratch storage for packed panels.
+class AlignedBuffer {
+public:
+    AlignedBuffer() = default;
+    explicit AlignedBuffer(size_t count) { resize(count); }
+
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+    ~AlignedBuffer() { std::free(data_); }
+
+    void resize(size_t count) {
+        if (count <= size_) return;
+        std::free(data_);
+        const size_t bytes = ((count * sizeof(double) + 63) / 64) * 64;
+        data_ = static_cast<double*>(std::aligned_alloc(64, bytes));
+        if (data_ == nullptr) {
+            size_ = 0;
+            throw std::bad_alloc();
+        }
+        size_ = count;
+    }
+
+    double* data() { return data_; }
+    const double* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    double* data_{nullptr};
+    size_t size_{0};
+};
+
+inline size_t packed_b_size(size_t kc, size_t n, size_t nr) {
+    return kc * ((n + nr - 1) / nr) * nr;
+}
+
+// Packs A[m x kc] (row-major, stride lda) into ap with stride kc.
+inline void pack_a(size_t m, size_t kc, const double* a, size_t lda, double* ap) {
+    for (size_t r = 0; r < m; ++r) {
+        std::memcpy(ap + r * kc, a + r * lda, kc * sizeof(double));
+    }
+}
+
+// Packs B[kc x n] (row-major, stride ldb) into NR-wide slivers; sliver s
+// starts at bp + s * kc * nr and the last one is zero padded.
+inline void pack_b(size_t kc, size_t n, const double* b, size_t ldb, double* bp, size_t nr) {
+    for (size_t j0 = 0; j0 < n; j0 += nr) {
+        const size_t cols = std::min(nr, n - j0);
+        double* dst = bp + (j0 / nr) * kc * nr;
+        for (size_t p = 0; p < kc; ++p) {
+            const double* src = b + p * ldb + j0;
+            size_t j = 0;
+            for (; j < cols; ++j) dst[p * nr + j] = src[j];
+            for (; j < nr; ++j) dst[p * nr + j] = 0.0;
+        }
+    }
+}
+
+// C[m x n] += Ap[m x kc] * Bp[kc x n] on packed operands. jr is the outer
+// loop so one B sliver stays in L1 while every A sliver of the block streams
+// past it. Partial-width slivers compute into a scratch block first.
+inline void packed_macro_kernel(const Kernel& k,
+                                size_t m, size_t n, size_t kc,
+                                const double* ap, const double* bp,
+                                double* c, size_t ldc) {
+    alignas(64) double tmp[kMaxMr * kMaxNr];
+    for (size_t jr = 0; jr < n; jr += k.nr) {
+        const double* b_sliver = bp + (jr / k.nr) * kc * k.nr;
+        const size_t cols = std::min(k.nr, n - jr);
+        for (size_t ir = 0; ir < m; ir += k.mr) {
+            const size_t rows = std::min(k.mr, m - ir);
+            const MicroKernelFn fn = k.rows[rows - 1];
+            double* c_block = c + ir * ldc + jr;
+            if (cols == k.nr) {
+                fn(kc, ap + ir * kc, kc, b_sliver, k.nr, c_block, ldc);
+                continue;
+            }
+            std::fill(tmp, tmp + rows * k.nr, 0.0);
+            fn(kc, ap + ir * kc, kc, b_sliver, k.nr, tmp, k.nr);
+            for (size_t r = 0; r < rows; ++r) {
+                for (size_t j = 0; j < cols; ++j) {
+                    c_block[r * ldc + j] += tmp[r * k.nr + j];
+                }
+            }
+        }
+    }
+}
+
+}  // namespace matmul
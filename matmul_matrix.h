@@ -0,0 +1,327 @@
+#pragma once
+
+// Row-major double matrix storage for the matmul code paths.
+//
+// Every row starts on a 64-byte boundary (the leading dimension is rounded up
+// to 8 doubles). With padding enabled, a leading dimension that is a power of
+// two of at least 512 bytes gets one extra cache line, so walking down a
+// column no longer maps every row to the same L1/L2 sets.
+//
+// Large matrices are mmap'd so they can sit on huge pages:
+//   hugetlb: MAP_HUGETLB from the reserved pool (vm.nr_hugepages); falls back
+//            to thp when nothing is reserved
+//   thp:     2 MiB aligned anonymous mapping + MADV_HUGEPAGE; falls back to
+//            small pages when transparent huge pages are disabled
+//   small:   base pages; a plain mmap from kHugeThreshold bytes up, else a
+//            64-byte aligned heap allocation
+//   auto:    thp from kHugeThreshold bytes up, small below
+// Memory from mmap is zero and untouched until first written, so the thread
+// that first writes a page decides where it lives (see init_random); heap
+// allocations are zero-filled.
+//
+// init_random fills a matrix from a counter-based generator: element (i, j)
+// is a pure function of (seed, i * cols + j), so the result is the same for
+// any split of the rows across tasks and any number of threads.
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace matmul {
+
+enum class PageMode { Auto, Small, Thp, HugeTlb, File };
+
+inline const char* page_mode_name(PageMode mode) {
+    switch (mode) {
+        case PageMode::Auto: return "auto";
+        case PageMode::Small: return "small";
+        case PageMode::Thp: return "thp";
+        case PageMode::HugeTlb: return "hugetlb";
+        case PageMode::File: return "file";
+    }
+    return "auto";
+}
+
+inline std::optional<PageMode> parse_page_mode(std::string_view name) {
+    if (name == "auto") return PageMode::Auto;
+    if (name == "small") return PageMode::Small;
+    if (name == "thp") return PageMode::Thp;
+    if (name == "hugetlb") return PageMode::HugeTlb;
+    return std::nullopt;
+}
+
+struct MatrixOptions {
+    PageMode pages{PageMode::Auto};
+    bool pad{true};  // pad power-of-two leading dimensions by one cache line
+};
+
+constexpr size_t kMatrixAlign = 64;
+constexpr size_t kHugeThreshold = size_t{4} << 20;
+
+inline size_t base_page_size() {
+    const long p = ::sysconf(_SC_PAGESIZE);
+    return p > 0 ? static_cast<size_t>(p) : 4096;
+}
+
+// Default huge page size from /proc/meminfo ("Hugepagesize: 2048 kB").
+inline size_t huge_page_size() {
+    static const size_t size = [] {
+        std::ifstream in("/proc/meminfo");
+        std::string key;
+        size_t kb = 0;
+        while (in >> key) {
+            if (key == "Hugepagesize:" && (in >> kb)) {
+                return kb * 1024;
+            }
+            in.ignore(256, '\n');
+        }
+        return size_t{2} << 20;
+    }();
+    return size;
+}
+
+// False when /sys/kernel/mm/transparent_hugepage/enabled reads "[never]" or
+// does not exist.
+inline bool thp_available() {
+    static const bool available = [] {
+        std::ifstream in("/sys/kernel/mm/transparent_hugepage/enabled");
+        std::string line;
+        return std::getline(in, line) && line.find("[never]") == std::string::npos;
+    }();
+    return available;
+}
+
+inline size_t matrix_ld(size_t cols, bool pad) {
+    constexpr size_t per_line = kMatrixAlign / sizeof(double);
+    size_t ld = (std::max<size_t>(cols, 1) + per_line - 1) / per_line * per_line;
+    if (pad && ld * sizeof(double) >= 512 && (ld & (ld - 1)) == 0) {
+        ld += per_line;
+    }
+    return ld;
+}
+
+class Matrix;
+Matrix map_matrix_file(const std::string& path);
+
+class Matrix {
+public:
+    Matrix() = default;
+
+    Matrix(size_t rows, size_t cols, const MatrixOptions& opt = {})
+        : rows_(rows), cols_(cols), ld_(matrix_ld(cols, opt.pad)) {
+        allocate(opt.pages);
+    }
+
+    Matrix(const Matrix&) = delete;
+    Matrix& operator=(const Matrix&) = delete;
+
+    Matrix(Matrix&& other) noexcept { swap(other); }
+
+    Matrix& operator=(Matrix&& other) noexcept {
+        if (this != &other) {
+            Matrix(std::move(other)).swap(*this);
+        }
+        return *this;
+    }
+
+    ~Matrix() { release(); }
+
+    size_t rows() const { return rows_; }
+    size_t cols() const { return cols_; }
+    size_t ld() const { return ld_; }              // row stride in elements
+    size_t padding() const { return ld_ - cols_; }  // elements past cols in each row
+    size_t bytes() const { return rows_ * ld_ * sizeof(double); }
+    size_t page_size() const { return page_size_; }
+    PageMode backing() const { return backing_; }  // Small, Thp, HugeTlb or File
+
+    double* data() { return data_; }
+    const double* data() const { return data_; }
+    double* row(size_t i) { return data_ + i * ld_; }
+    const double* row(size_t i) const { return data_ + i * ld_; }
+    double& operator()(size_t i, size_t j) { return data_[i * ld_ + j]; }
+    double operator()(size_t i, size_t j) const { return data_[i * ld_ + j]; }
+
+    void swap(Matrix& other) noexcept {
+        std::swap(rows_, other.rows_);
+        std::swap(cols_, other.cols_);
+        std::swap(ld_, other.ld_);
+        std::swap(data_, other.data_);
+        std::swap(map_base_, other.map_base_);
+        std::swap(map_bytes_, other.map_bytes_);
+        std::swap(page_size_, other.page_size_);
+        std::swap(backing_, other.backing_);
+    }
+
+private:
+    // Private copy-on-write mapping of a matrix file (matmul_file.h).
+    friend Matrix map_matrix_file(const std::string& path);
+
+    void allocate(PageMode mode) {
+        const size_t bytes = std::max<size_t>(this->bytes(), kMatrixAlign);
+        if (mode == PageMode::Auto || mode == PageMode::File) {
+            mode = bytes >= kHugeThreshold ? PageMode::Thp : PageMode::Small;
+        }
+        if (mode == PageMode::HugeTlb && map_hugetlb(bytes)) return;
+        if ((mode == PageMode::HugeTlb || mode == PageMode::Thp) && thp_available() && map_thp(bytes)) return;
+        allocate_small(bytes);
+    }
+
+    bool map_hugetlb(size_t bytes) {
+#ifdef MAP_HUGETLB
+        const size_t huge = huge_page_size();
+        const size_t len = (bytes + huge - 1) / huge * huge;
+        void* p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p == MAP_FAILED) return false;
+        set_mapping(p, len, p, huge, PageMode::HugeTlb);
+        return true;
+#else
+        (void)bytes;
+        return false;
+#endif
+    }
+
+    // Over-maps by one huge page so the matrix can start on a huge page
+    // boundary; khugepaged and the fault path only back aligned ranges.
+    bool map_thp(size_t bytes) {
+#ifdef MADV_HUGEPAGE
+        const size_t huge = huge_page_size();
+        const size_t len = (bytes + huge - 1) / huge * huge;
+        void* p = ::mmap(nullptr, len + huge, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) return false;
+        const uintptr_t base = reinterpret_cast<uintptr_t>(p);
+        const uintptr_t aligned = (base + huge - 1) / huge * huge;
+        if (aligned > base) ::munmap(p, aligned - base);
+        const size_t tail = (base + len + huge) - (aligned + len);
+        if (tail > 0) ::munmap(reinterpret_cast<void*>(aligned + len), tail);
+        void* start = reinterpret_cast<void*>(aligned);
+        if (::madvise(start, len, MADV_HUGEPAGE) != 0) {
+            set_mapping(start, len, start, base_page_size(), PageMode::Small);
+            return true;
+        }
+        set_mapping(start, len, start, huge, PageMode::Thp);
+        return true;
+#else
+        (void)bytes;
+        return false;
+#endif
+    }
+
+    void allocate_small(size_t bytes) {
+        if (bytes >= kHugeThreshold) {
+            const size_t page = base_page_size();
+            const size_t len = (bytes + page - 1) / page * page;
+            void* p = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) throw std::bad_alloc();
+            set_mapping(p, len, p, page, PageMode::Small);
+            return;
+        }
+        const size_t len = (bytes + kMatrixAlign - 1) / kMatrixAlign * kMatrixAlign;
+        void* p = std::aligned_alloc(kMatrixAlign, len);
+        if (p == nullptr) throw std::bad_alloc();
+        std::memset(p, 0, len);
+        data_ = static_cast<double*>(p);
+        page_size_ = base_page_size();
+        backing_ = PageMode::Small;
+    }
+
+    void set_mapping(void* base, size_t len, void* data, size_t page, PageMode backing) {
+        map_base_ = base;
+        map_bytes_ = len;
+        data_ = static_cast<double*>(data);
+        page_size_ = page;
+        backing_ = backing;
+    }
+
+    void release() {
+        if (map_base_ != nullptr) {
+            ::munmap(map_base_, map_bytes_);
+        } else {
+            std::free(data_);
+        }
+        data_ = nullptr;
+        map_base_ = nullptr;
+        map_bytes_ = 0;
+    }
+
+    size_t rows_{0};
+    size_t cols_{0};
+    size_t ld_{0};
+    double* data_{nullptr};
+    void* map_base_{nullptr};  // non-null when data_ came from mmap
+    size_t map_bytes_{0};
+    size_t page_size_{0};
+    PageMode backing_{PageMode::Small};
+};
+
+// "thp(2M)" / "small(4K)": backing and page size for benchmark banners.
+inline std::string describe_pages(const Matrix& m) {
+    const size_t p = m.page_size();
+    const std::string size = p >= (size_t{1} << 20) ? std::to_string(p >> 20) + "M" : std::to_string(p >> 10) + "K";
+    return std::string(page_mode_name(m.backing())) + "(" + size + ")";
+}
+
+// SplitMix64 finalizer.
+inline uint64_t mix64(uint64_t z) {
+    z += 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Uniform double in [-1, 1) for counter i of the stream selected by key.
+inline double counter_uniform(uint64_t key, uint64_t i) {
+    const uint64_t bits = mix64(key ^ mix64(i));
+    return static_cast<double>(bits >> 11) * 0x1.0p-52 - 1.0;
+}
+
+// Rows per init task: one tile row (bs rows) so each task touches the pages
+// of the row panel that the same position in the compute schedule reads.
+// run_tasks_fn(count, fn) follows the gemm_tasks contract.
+template <typename RunTasks>
+void init_random(RunTasks&& run_tasks_fn, Matrix& m, uint64_t seed, size_t rows_per_task) {
+    const size_t step = std::max<size_t>(rows_per_task, 1);
+    const uint64_t key = mix64(seed);
+    run_tasks_fn((m.rows() + step - 1) / step, [&](size_t t) {
+        const size_t r1 = std::min(m.rows(), (t + 1) * step);
+        for (size_t i = t * step; i < r1; ++i) {
+            double* row = m.row(i);
+            const uint64_t base = static_cast<uint64_t>(i) * m.cols();
+            for (size_t j = 0; j < m.cols(); ++j) row[j] = counter_uniform(key, base + j);
+        }
+    });
+}
+
+// Zero-fills row panels on the pool, which first-touches fresh mmap'd pages.
+template <typename RunTasks>
+void init_zero(RunTasks&& run_tasks_fn, Matrix& m, size_t rows_per_task) {
+    const size_t step = std::max<size_t>(rows_per_task, 1);
+    run_tasks_fn((m.rows() + step - 1) / step, [&](size_t t) {
+        const size_t r1 = std::min(m.rows(), (t + 1) * step);
+        for (size_t i = t * step; i < r1; ++i) std::fill(m.row(i), m.row(i) + m.ld(), 0.0);
+    });
+}
+
+// MATMUL_PAGES=auto|small|thp|hugetlb and MATMUL_PAD=0|1 (default auto, 1).
+inline MatrixOptions matrix_options_from_env() {
+    MatrixOptions opt;
+    if (const char* p = std::getenv("MATMUL_PAGES"); p != nullptr && *p != '\0') {
+        if (const auto mode = parse_page_mode(p)) opt.pages = *mode;
+    }
+    if (const char* p = std::getenv("MATMUL_PAD"); p != nullptr && *p != '\0') {
+        opt.pad = std::string_view(p) != "0";
+    }
+    return opt;
+}
+
+}  // namespace matmul
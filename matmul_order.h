@@ -0,0 +1,145 @@
+#pragma once
+
+// Output tile orderings for the tiled gemm schedule.
+//
+// gemm submits one task per BS x BS output tile, and the pools start tasks
+// roughly in submission order, so the order decides which tiles run at the
+// same time. Row-major keeps one A row panel hot but walks every B column
+// panel before returning to it; the other orders keep concurrently running
+// tiles close together so their A and B panels are shared in L3:
+//
+//   row      (ti, tj) row by row, the original order
+//   morton   Z-order: recursive 2x2 quadrants
+//   hilbert  Hilbert curve: like morton, but consecutive tiles always share
+//            an A row panel or a B column panel
+//   bpanel   groups of G tile rows; inside a group, all G tiles of one B
+//            column panel run before the next panel (G = workers), so each
+//            wave of tasks reads one B panel and G A panels that stay cached
+//
+// Curves are generated on the enclosing power-of-two square and clipped to
+// the tile grid, so every tile appears exactly once for any shape.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace matmul {
+
+enum class TileOrder { RowMajor, Morton, Hilbert, BPanel };
+
+inline const char* tile_order_name(TileOrder order) {
+    switch (order) {
+        case TileOrder::RowMajor: return "row";
+        case TileOrder::Morton: return "morton";
+        case TileOrder::Hilbert: return "hilbert";
+        case TileOrder::BPanel: return "bpanel";
+    }
+    return "row";
+}
+
+inline std::optional<TileOrder> parse_tile_order(std::string_view name) {
+    if (name == "row") return TileOrder::RowMajor;
+    if (name == "morton") return TileOrder::Morton;
+    if (name == "hilbert") return TileOrder::Hilbert;
+    if (name == "bpanel") return TileOrder::BPanel;
+    return std::nullopt;
+}
+
+// Even bits of v packed into the low half.
+inline uint32_t morton_compact(uint64_t v) {
+    v &= 0x5555555555555555ull;
+    v = (v | (v >> 1)) & 0x3333333333333333ull;
+    v = (v | (v >> 2)) & 0x0f0f0f0f0f0f0f0full;
+    v = (v | (v >> 4)) & 0x00ff00ff00ff00ffull;
+    v = (v | (v >> 8)) & 0x0000ffff0000ffffull;
+    v = (v | (v >> 16)) & 0x00000000ffffffffull;
+    return static_cast<uint32_t>(v);
+}
+
+// Position d along the Hilbert curve of a side x side square (side a power of two).
+inline void hilbert_point(uint64_t side, uint64_t d, uint64_t& row, uint64_t& col) {
+    uint64_t x = 0, y = 0;
+    for (uint64_t s = 1; s < side; s *= 2) {
+        const uint64_t rx = 1 & (d / 2);
+        const uint64_t ry = 1 & (d ^ rx);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            std::swap(x, y);
+        }
+        x += s * rx;
+        y += s * ry;
+        d /= 4;
+    }
+    row = y;
+    col = x;
+}
+
+// Tile indices (ti * tiles_j + tj) in execution order. group is G for bpanel.
+inline std::vector<uint32_t> make_tile_order(size_t tiles_i, size_t tiles_j, TileOrder order, size_t group) {
+    std::vector<uint32_t> seq;
+    seq.reserve(tiles_i * tiles_j);
+    auto emit = [&](uint64_t ti, uint64_t tj) {
+        if (ti < tiles_i && tj < tiles_j) seq.push_back(static_cast<uint32_t>(ti * tiles_j + tj));
+    };
+
+    uint64_t side = 1;
+    while (side < std::max(tiles_i, tiles_j)) side *= 2;
+
+    switch (order) {
+        case TileOrder::RowMajor:
+            for (size_t t = 0; t < tiles_i * tiles_j; ++t) seq.push_back(static_cast<uint32_t>(t));
+            break;
+        case TileOrder::Morton:
+            for (uint64_t d = 0; d < side * side; ++d) emit(morton_compact(d >> 1), morton_compact(d));
+            break;
+        case TileOrder::Hilbert:
+            for (uint64_t d = 0; d < side * side; ++d) {
+                uint64_t ti = 0, tj = 0;
+                hilbert_point(side, d, ti, tj);
+                emit(ti, tj);
+            }
+            break;
+        case TileOrder::BPanel: {
+            const size_t g = std::clamp<size_t>(group, 1, std::max<size_t>(tiles_i, 1));
+            for (size_t gi = 0; gi < tiles_i; gi += g) {
+                const size_t rows = std::min(g, tiles_i - gi);
+                for (size_t tj = 0; tj < tiles_j; ++tj) {
+                    for (size_t ti = gi; ti < gi + rows; ++ti) emit(ti, tj);
+                }
+            }
+            break;
+        }
+    }
+    return seq;
+}
+
+// make_tile_order() cached per calling thread for the last grid it was asked
+// for; gemm calls with the same shape reuse it. Empty for row-major, where
+// task t is tile t.
+inline const std::vector<uint32_t>& cached_tile_order(size_t tiles_i, size_t tiles_j, TileOrder order, size_t group) {
+    struct Cached {
+        size_t tiles_i{0}, tiles_j{0}, group{0};
+        TileOrder order{TileOrder::RowMajor};
+        std::vector<uint32_t> seq;
+    };
+    static const std::vector<uint32_t> identity;
+    if (order == TileOrder::RowMajor) return identity;
+    thread_local Cached cache;
+    if (cache.seq.empty() || cache.tiles_i != tiles_i || cache.tiles_j != tiles_j ||
+        cache.order != order || cache.group != group) {
+        cache.seq = make_tile_order(tiles_i, tiles_j, order, group);
+        cache.tiles_i = tiles_i;
+        cache.tiles_j = tiles_j;
+        cache.order = order;
+        cache.group = group;
+    }
+    return cache.seq;
+}
+
+}  // namespace matmul
@@ -0,0 +1,293 @@
+#pragma once
+
+// Divide-and-conquer matmul as nested fork-join tasks.
+//
+// recursive: cache-oblivious C += A * B. The largest of M, N and K is halved
+// until every dimension fits the base case, which is one micro-kernel block
+// product. Halving M or N forks two independent children; halving K runs the
+// halves one after the other, because both accumulate into the same C.
+//
+// strassen: Strassen-Winograd (7 products, 15 additions) for square even
+// sizes above the cutoff, recursing into itself for the 7 products and into
+// the classic recursion below the cutoff or on odd sizes. Each level holds
+// 15 (n/2)^2 temporaries until its products are combined.
+//
+// Tasks never block. As in fib_single_bench, every node carries a pending
+// child counter and a parent pointer; the child that finishes last runs the
+// node's continuation, which either forks the next stage or completes the
+// node towards its parent. Only the caller of multiply() waits.
+
+#include "matmul_kernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace matmul {
+
+// spawn(std::function<void()>) must run the function asynchronously, e.g. by
+// submitting it to a pool or resuming a coroutine on one.
+template <typename Spawn>
+class ForkJoinMatmul {
+public:
+    ForkJoinMatmul(Spawn spawn, const Kernel& kernel, size_t base, size_t strassen_cutoff)
+        : spawn_(std::move(spawn)),
+          kernel_(kernel),
+          base_(std::max<size_t>(base, 1)),
+          strassen_cutoff_(strassen_cutoff) {}
+
+    // C = A * B (C is overwritten). strassen_cutoff == 0 disables Strassen.
+    void multiply(size_t m, size_t n, size_t k,
+                  const double* a, size_t lda,
+                  const double* b, size_t ldb,
+                  double* c, size_t ldc) {
+        const Sub root_problem{m, n, k, a, lda, b, ldb, c, ldc};
+        done_ = false;
+        tasks_.store(0, std::memory_order_relaxed);
+
+        auto root = std::make_shared<Node>(nullptr);
+        if (strassen_cutoff_ != 0) {
+            fork_root(root, [this, root_problem](const NodePtr& self) { strassen(self, root_problem); });
+        } else {
+            zero(root_problem);
+            fork_root(root, [this, root_problem](const NodePtr& self) { classic(self, root_problem); });
+        }
+
+        std::unique_lock<std::mutex> lk(done_mutex_);
+        done_cv_.wait(lk, [&] { return done_; });
+    }
+
+    // Tasks spawned by the last multiply().
+    size_t tasks_spawned() const { return tasks_.load(std::memory_order_relaxed); }
+
+    // Strassen levels applied to an n x n problem.
+    size_t strassen_levels(size_t n) const {
+        size_t levels = 0;
+        while (strassen_cutoff_ != 0 && n > strassen_cutoff_ && n % 2 == 0) {
+            n /= 2;
+            ++levels;
+        }
+        return levels;
+    }
+
+private:
+    struct Node;
+    using NodePtr = std::shared_ptr<Node>;
+    using Job = std::function<void(const NodePtr&)>;
+
+    struct Node {
+        explicit Node(NodePtr p) : parent(std::move(p)) {}
+
+        NodePtr parent;
+        std::atomic<int> pending{0};
+        Job then;                     // runs once pending reaches zero
+        std::vector<double> scratch;  // Strassen temporaries
+    };
+
+    struct Sub {
+        size_t m, n, k;
+        const double* a;
+        size_t lda;
+        const double* b;
+        size_t ldb;
+        double* c;
+        size_t ldc;
+    };
+
+    void fork_root(const NodePtr& root, Job job) {
+        tasks_.fetch_add(1, std::memory_order_relaxed);
+        spawn_([root, job = std::move(job)] { job(root); });
+    }
+
+    // Must be called before the forks it waits for.
+    void join(const NodePtr& self, int children, Job then) {
+        self->then = std::move(then);
+        self->pending.store(children, std::memory_order_relaxed);
+    }
+
+    void fork(const NodePtr& parent, Job job) {
+        tasks_.fetch_add(1, std::memory_order_relaxed);
+        auto child = std::make_shared<Node>(parent);
+        spawn_([child, job = std::move(job)] { job(child); });
+    }
+
+    void finish(const NodePtr& node) {
+        NodePtr parent = node->parent;
+        if (!parent) {
+            // Notify under the lock: multiply() may return and the caller
+            // destroy this object as soon as it sees done_.
+            std::lock_guard<std::mutex> lk(done_mutex_);
+            done_ = true;
+            done_cv_.notify_one();
+            return;
+        }
+        if (parent->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            Job then = std::move(parent->then);
+            then(parent);
+        }
+    }
+
+    Job finish_job() {
+        return [this](const NodePtr& self) { finish(self); };
+    }
+
+    // Split point rounded to a multiple of 16 so children stay aligned with
+    // every kernel's register block when the size allows it.
+    static size_t split_point(size_t x) {
+        const size_t h = ((x / 2 + 15) / 16) * 16;
+        return h < x ? h : x / 2;
+    }
+
+    static void zero(const Sub& p) {
+        for (size_t i = 0; i < p.m; ++i) {
+            std::fill(p.c + i * p.ldc, p.c + i * p.ldc + p.n, 0.0);
+        }
+    }
+
+    // C += A * B.
+    void classic(const NodePtr& self, const Sub& p) {
+        if (p.m <= base_ && p.n <= base_ && p.k <= base_) {
+            multiply_block(kernel_, p.m, p.n, p.k, p.a, p.lda, p.b, p.ldb, p.c, p.ldc);
+            finish(self);
+            return;
+        }
+
+        if (p.m >= p.n && p.m >= p.k) {
+            const size_t h = split_point(p.m);
+            const Sub top{h, p.n, p.k, p.a, p.lda, p.b, p.ldb, p.c, p.ldc};
+            const Sub bottom{p.m - h, p.n, p.k, p.a + h * p.lda, p.lda, p.b, p.ldb, p.c + h * p.ldc, p.ldc};
+            join(self, 2, finish_job());
+            fork(self, [this, top](const NodePtr& s) { classic(s, top); });
+            fork(self, [this, bottom](const NodePtr& s) { classic(s, bottom); });
+        } else if (p.n >= p.k) {
+            const size_t h = split_point(p.n);
+            const Sub left{p.m, h, p.k, p.a, p.lda, p.b, p.ldb, p.c, p.ldc};
+            const Sub right{p.m, p.n - h, p.k, p.a, p.lda, p.b + h, p.ldb, p.c + h, p.ldc};
+            join(self, 2, finish_job());
+            fork(self, [this, left](const NodePtr& s) { classic(s, left); });
+            fork(self, [this, right](const NodePtr& s) { classic(s, right); });
+        } else {
+            const size_t h = split_point(p.k);
+            const Sub first{p.m, p.n, h, p.a, p.lda, p.b, p.ldb, p.c, p.ldc};
+            const Sub second{p.m, p.n, p.k - h, p.a + h, p.lda, p.b + h * p.ldb, p.ldb, p.c, p.ldc};
+            join(self, 1, [this, second](const NodePtr& s) {
+                join(s, 1, finish_job());
+                fork(s, [this, second](const NodePtr& child) { classic(child, second); });
+            });
+            fork(self, [this, first](const NodePtr& s) { classic(s, first); });
+        }
+    }
+
+    // C = A * B.
+    void strassen(const NodePtr& self, const Sub& p) {
+        if (p.m != p.n || p.n != p.k || p.n <= strassen_cutoff_ || p.n % 2 != 0) {
+            zero(p);
+            classic(self, p);
+            return;
+        }
+
+        const size_t h = p.n / 2;
+        const size_t hh = h * h;
+        self->scratch.resize(15 * hh);
+        double* t = self->scratch.data();
+        double* s1 = t;
+        double* s2 = t + hh;
+        double* s3 = t + 2 * hh;
+        double* s4 = t + 3 * hh;
+        double* t1 = t + 4 * hh;
+        double* t2 = t + 5 * hh;
+        double* t3 = t + 6 * hh;
+        double* t4 = t + 7 * hh;
+        double* prod = t + 8 * hh;  // M1 .. M7
+
+        const double* a11 = p.a;
+        const double* a12 = p.a + h;
+        const double* a21 = p.a + h * p.lda;
+        const double* a22 = a21 + h;
+        const double* b11 = p.b;
+        const double* b12 = p.b + h;
+        const double* b21 = p.b + h * p.ldb;
+        const double* b22 = b21 + h;
+
+        for (size_t i = 0; i < h; ++i) {
+            const size_t ra = i * p.lda;
+            const size_t rb = i * p.ldb;
+            const size_t r = i * h;
+            for (size_t j = 0; j < h; ++j) {
+                s1[r + j] = a21[ra + j] + a22[ra + j];
+                s2[r + j] = s1[r + j] - a11[ra + j];
+                s3[r + j] = a11[ra + j] - a21[ra + j];
+                s4[r + j] = a12[ra + j] - s2[r + j];
+                t1[r + j] = b12[rb + j] - b11[rb + j];
+                t2[r + j] = b22[rb + j] - t1[r + j];
+                t3[r + j] = b22[rb + j] - b12[rb + j];
+                t4[r + j] = t2[r + j] - b21[rb + j];
+            }
+        }
+
+        const Sub products[7] = {
+            {h, h, h, a11, p.lda, b11, p.ldb, prod, h},           // M1 = A11 B11
+            {h, h, h, a12, p.lda, b21, p.ldb, prod + hh, h},      // M2 = A12 B21
+            {h, h, h, s4, h, b22, p.ldb, prod + 2 * hh, h},       // M3 = S4 B22
+            {h, h, h, a22, p.lda, t4, h, prod + 3 * hh, h},       // M4 = A22 T4
+            {h, h, h, s1, h, t1, h, prod + 4 * hh, h},            // M5 = S1 T1
+            {h, h, h, s2, h, t2, h, prod + 5 * hh, h},            // M6 = S2 T2
+            {h, h, h, s3, h, t3, h, prod + 6 * hh, h},            // M7 = S3 T3
+        };
+
+        join(self, 7, [this, p, h](const NodePtr& s) {
+            combine(p, h, s->scratch.data() + 8 * h * h);
+            std::vector<double>().swap(s->scratch);
+            finish(s);
+        });
+        for (const Sub& q : products) {
+            fork(self, [this, q](const NodePtr& s) { strassen(s, q); });
+        }
+    }
+
+    // C11 = M1 + M2, C12 = U4 + M3, C21 = U3 - M4, C22 = U3 + M5 with
+    // U2 = M1 + M6, U3 = U2 + M7, U4 = U2 + M5.
+    static void combine(const Sub& p, size_t h, const double* prod) {
+        const size_t hh = h * h;
+        const double* m1 = prod;
+        const double* m2 = prod + hh;
+        const double* m3 = prod + 2 * hh;
+        const double* m4 = prod + 3 * hh;
+        const double* m5 = prod + 4 * hh;
+        const double* m6 = prod + 5 * hh;
+        const double* m7 = prod + 6 * hh;
+        for (size_t i = 0; i < h; ++i) {
+            double* c11 = p.c + i * p.ldc;
+            double* c12 = c11 + h;
+            double* c21 = p.c + (i + h) * p.ldc;
+            double* c22 = c21 + h;
+            const size_t r = i * h;
+            for (size_t j = 0; j < h; ++j) {
+                const double u2 = m1[r + j] + m6[r + j];
+                const double u3 = u2 + m7[r + j];
+                c11[j] = m1[r + j] + m2[r + j];
+                c12[j] = u2 + m5[r + j] + m3[r + j];
+                c21[j] = u3 - m4[r + j];
+                c22[j] = u3 + m5[r + j];
+            }
+        }
+    }
+
+    Spawn spawn_;
+    const Kernel& kernel_;
+    size_t base_;
+    size_t strassen_cutoff_;
+    std::atomic<size_t> tasks_{0};
+
+    std::mutex done_mutex_;
+    std::condition_variable done_cv_;
+    bool done_{false};
+};
+
+}  // namespace matmul
@@ -0,0 +1,339 @@
+#pragma once
+
+// Compressed sparse row (CSR) matrices and parallel SpMV / SpMM.
+//
+// Sparse rows are irregular: a power-law matrix has a few rows with
+// thousands of nonzeros and many with a handful, so splitting the rows into
+// equal counts leaves one task with most of the work. partition_by_nnz()
+// instead cuts the rows into contiguous ranges of about equal cost
+// (nonzeros + 1 per row, so empty rows still count for writing y). Cuts stay
+// on row boundaries, so a single row heavier than the target becomes a task
+// of its own; with a few tasks per worker the pool absorbs the rest.
+//
+// Generators (power-law and banded) are counter-based like init_random, so
+// a matrix depends only on its parameters and seed; Matrix Market files
+// (coordinate real|integer|pattern, general|symmetric|skew-symmetric) load
+// into the same type.
+//
+// The *_tasks functions take run_tasks_fn(count, fn) with the gemm_tasks
+// contract, one task per partition range.
+
+#include "matmul_matrix.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace matmul {
+
+struct CsrMatrix {
+    size_t rows{0};
+    size_t cols{0};
+    std::vector<size_t> row_ptr;  // rows + 1 entries
+    std::vector<uint32_t> col;    // column of each nonzero, ascending within a row
+    std::vector<double> val;
+
+    size_t nnz() const { return row_ptr.empty() ? 0 : row_ptr.back(); }
+    size_t row_nnz(size_t i) const { return row_ptr[i + 1] - row_ptr[i]; }
+};
+
+inline void check_csr_cols(size_t cols) {
+    if (cols > std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument("CSR column indices are 32-bit; too many columns: " + std::to_string(cols));
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Generators
+// ---------------------------------------------------------------------------
+
+// Fills val and the sorted, distinct columns of each row on the pool once
+// row_ptr is known. Each row draws its columns from (key, row): len sorted
+// samples in [0, cols - len] plus their rank are strictly increasing.
+template <typename RunTasks>
+void fill_csr_rows(RunTasks&& run_tasks_fn, CsrMatrix& a, uint64_t seed, size_t rows_per_task) {
+    const uint64_t key = mix64(seed);
+    const size_t step = std::max<size_t>(rows_per_task, 1);
+    a.col.resize(a.nnz());
+    a.val.resize(a.nnz());
+    run_tasks_fn((a.rows + step - 1) / step, [&](size_t t) {
+        const size_t r1 = std::min(a.rows, (t + 1) * step);
+        for (size_t i = t * step; i < r1; ++i) {
+            const size_t p0 = a.row_ptr[i];
+            const size_t len = a.row_nnz(i);
+            const double span = static_cast<double>(a.cols - len + 1);
+            uint32_t* c = a.col.data() + p0;
+            for (size_t p = 0; p < len; ++p) {
+                const double u = 0.5 * (counter_uniform(key ^ 0xc01u, p0 + p) + 1.0);  // [0, 1)
+                c[p] = static_cast<uint32_t>(std::min(span - 1.0, std::floor(u * span)));
+            }
+            std::sort(c, c + len);
+            for (size_t p = 0; p < len; ++p) {
+                c[p] += static_cast<uint32_t>(p);
+                a.val[p0 + p] = counter_uniform(key, p0 + p);
+            }
+        }
+    });
+}
+
+// Row lengths follow a Pareto tail with exponent alpha (> 1) and mean about
+// avg_nnz, capped at cols; a larger alpha gives more uniform rows. Lengths
+// are drawn independently per row, or with sorted_rows set, taken at evenly
+// spaced quantiles so the heaviest rows come first (like a degree-sorted
+// graph), which is the worst case for equal row counts.
+template <typename RunTasks>
+CsrMatrix make_powerlaw_csr(RunTasks&& run_tasks_fn, size_t rows, size_t cols, double avg_nnz, double alpha,
+                            uint64_t seed, bool sorted_rows = false) {
+    if (alpha <= 1.0) throw std::invalid_argument("power-law alpha must be > 1");
+    check_csr_cols(cols);
+    CsrMatrix a;
+    a.rows = rows;
+    a.cols = cols;
+    a.row_ptr.assign(rows + 1, 0);
+    const uint64_t key = mix64(seed ^ 0x9e3779b97f4a7c15ull);
+    const double x_min = avg_nnz * (alpha - 1.0) / alpha;
+    for (size_t i = 0; i < rows; ++i) {
+        const double u = sorted_rows ? (static_cast<double>(i) + 0.5) / static_cast<double>(rows)
+                                     : 0.5 * (1.0 - counter_uniform(key, i));  // (0, 1]
+        const double len = std::ceil(x_min * std::pow(u, -1.0 / alpha) - 0.5);
+        a.row_ptr[i + 1] = a.row_ptr[i] + static_cast<size_t>(std::clamp(len, 0.0, static_cast<double>(cols)));
+    }
+    fill_csr_rows(run_tasks_fn, a, seed, 4096);
+    return a;
+}
+
+// Square n x n matrix with nonzeros at |i - j| <= half_bandwidth.
+template <typename RunTasks>
+CsrMatrix make_banded_csr(RunTasks&& run_tasks_fn, size_t n, size_t half_bandwidth, uint64_t seed) {
+    check_csr_cols(n);
+    CsrMatrix a;
+    a.rows = n;
+    a.cols = n;
+    a.row_ptr.assign(n + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        const size_t lo = i > half_bandwidth ? i - half_bandwidth : 0;
+        const size_t hi = std::min(n, i + half_bandwidth + 1);
+        a.row_ptr[i + 1] = a.row_ptr[i] + (hi - lo);
+    }
+    a.col.resize(a.nnz());
+    a.val.resize(a.nnz());
+    const uint64_t key = mix64(seed);
+    const size_t step = 4096;
+    run_tasks_fn((n + step - 1) / step, [&](size_t t) {
+        const size_t r1 = std::min(n, (t + 1) * step);
+        for (size_t i = t * step; i < r1; ++i) {
+            const size_t lo = i > half_bandwidth ? i - half_bandwidth : 0;
+            for (size_t p = a.row_ptr[i]; p < a.row_ptr[i + 1]; ++p) {
+                a.col[p] = static_cast<uint32_t>(lo + (p - a.row_ptr[i]));
+                a.val[p] = counter_uniform(key, p);
+            }
+        }
+    });
+    return a;
+}
+
+// ---------------------------------------------------------------------------
+// Matrix Market
+// ---------------------------------------------------------------------------
+
+// Reads a coordinate Matrix Market file. Symmetric and skew-symmetric files
+// are expanded to both triangles, pattern entries become 1.0, and duplicate
+// entries are summed.
+inline CsrMatrix load_matrix_market(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("cannot open " + path);
+
+    std::string line;
+    if (!std::getline(in, line)) throw std::runtime_error("empty Matrix Market file: " + path);
+    std::istringstream banner(line);
+    std::string tag, object, format, field, symmetry;
+    banner >> tag >> object >> format >> field >> symmetry;
+    for (std::string* s : {&object, &format, &field, &symmetry}) {
+        std::transform(s->begin(), s->end(), s->begin(), [](unsigned char ch) { return std::tolower(ch); });
+    }
+    if (tag != "%%MatrixMarket" || object != "matrix") {
+        throw std::runtime_error("not a Matrix Market matrix: " + path);
+    }
+    if (format != "coordinate") throw std::runtime_error("only coordinate Matrix Market files are supported: " + path);
+    const bool pattern = field == "pattern";
+    if (!pattern && field != "real" && field != "integer") {
+        throw std::runtime_error("unsupported Matrix Market field '" + field + "': " + path);
+    }
+    const bool symmetric = symmetry == "symmetric";
+    const bool skew = symmetry == "skew-symmetric";
+    if (!symmetric && !skew && symmetry != "general") {
+        throw std::runtime_error("unsupported Matrix Market symmetry '" + symmetry + "': " + path);
+    }
+
+    while (std::getline(in, line) && (line.empty() || line[0] == '%')) {
+    }
+    size_t rows = 0, cols = 0, entries = 0;
+    if (!(std::istringstream(line) >> rows >> cols >> entries)) {
+        throw std::runtime_error("bad Matrix Market size line: " + path);
+    }
+    check_csr_cols(cols);
+
+    struct Entry {
+        size_t i;
+        uint32_t j;
+        double v;
+    };
+    std::vector<Entry> triplets;
+    triplets.reserve(symmetric || skew ? 2 * entries : entries);
+    for (size_t e = 0; e < entries; ++e) {
+        size_t i = 0, j = 0;
+        double v = 1.0;
+        if (!(in >> i >> j) || (!pattern && !(in >> v))) {
+            throw std::runtime_error("Matrix Market file ends after " + std::to_string(e) + " of " +
+                                     std::to_string(entries) + " entries: " + path);
+        }
+        if (i == 0 || j == 0 || i > rows || j > cols) {
+            throw std::runtime_error("Matrix Market entry out of range: " + path);
+        }
+        triplets.push_back({i - 1, static_cast<uint32_t>(j - 1), v});
+        if ((symmetric || skew) && i != j) triplets.push_back({j - 1, static_cast<uint32_t>(i - 1), skew ? -v : v});
+    }
+
+    std::sort(triplets.begin(), triplets.end(),
+              [](const Entry& x, const Entry& y) { return x.i != y.i ? x.i < y.i : x.j < y.j; });
+    CsrMatrix a;
+    a.rows = rows;
+    a.cols = cols;
+    a.row_ptr.assign(rows + 1, 0);
+    a.col.reserve(triplets.size());
+    a.val.reserve(triplets.size());
+    for (size_t e = 0; e < triplets.size(); ++e) {
+        const Entry& t = triplets[e];
+        if (e > 0 && triplets[e - 1].i == t.i && triplets[e - 1].j == t.j) {
+            a.val.back() += t.v;
+            continue;
+        }
+        a.col.push_back(t.j);
+        a.val.push_back(t.v);
+        ++a.row_ptr[t.i + 1];
+    }
+    for (size_t i = 0; i < rows; ++i) a.row_ptr[i + 1] += a.row_ptr[i];
+    return a;
+}
+
+// ---------------------------------------------------------------------------
+// Partitioning
+// ---------------------------------------------------------------------------
+
+enum class SparsePartition { Rows, Nnz };
+
+inline const char* sparse_partition_name(SparsePartition p) {
+    return p == SparsePartition::Rows ? "rows" : "nnz";
+}
+
+inline std::optional<SparsePartition> parse_sparse_partition(std::string_view name) {
+    if (name == "rows") return SparsePartition::Rows;
+    if (name == "nnz") return SparsePartition::Nnz;
+    return std::nullopt;
+}
+
+// Row boundaries (first 0, last rows) of up to `parts` ranges with equal row counts.
+inline std::vector<size_t> partition_by_rows(size_t rows, size_t parts) {
+    parts = std::clamp<size_t>(parts, 1, std::max<size_t>(rows, 1));
+    std::vector<size_t> bounds(parts + 1);
+    for (size_t p = 0; p <= parts; ++p) bounds[p] = rows * p / parts;
+    return bounds;
+}
+
+// Row boundaries of up to `parts` ranges with about equal nonzeros + rows.
+// Ranges that would be empty (a row heavier than the target) are dropped.
+inline std::vector<size_t> partition_by_nnz(const CsrMatrix& a, size_t parts) {
+    parts = std::max<size_t>(parts, 1);
+    const size_t total = a.nnz() + a.rows;
+    std::vector<size_t> bounds{0};
+    for (size_t p = 1; p < parts; ++p) {
+        const size_t target = total / parts * p + total % parts * p / parts;
+        // First row boundary whose cost prefix reaches the target.
+        size_t lo = bounds.back(), hi = a.rows;
+        while (lo < hi) {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (a.row_ptr[mid] + mid < target) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo > bounds.back() && lo < a.rows) bounds.push_back(lo);
+    }
+    bounds.push_back(a.rows);
+    if (bounds.size() == 2 && a.rows == 0) bounds.pop_back();
+    return bounds;
+}
+
+inline std::vector<size_t> partition_csr(const CsrMatrix& a, SparsePartition how, size_t parts) {
+    return how == SparsePartition::Rows ? partition_by_rows(a.rows, parts) : partition_by_nnz(a, parts);
+}
+
+// Largest range's nonzeros over the mean: 1.0 is perfectly balanced.
+inline double partition_imbalance(const CsrMatrix& a, const std::vector<size_t>& bounds) {
+    if (bounds.size() < 2 || a.nnz() == 0) return 1.0;
+    size_t heaviest = 0;
+    for (size_t p = 0; p + 1 < bounds.size(); ++p) {
+        heaviest = std::max(heaviest, a.row_ptr[bounds[p + 1]] - a.row_ptr[bounds[p]]);
+    }
+    const double mean = static_cast<double>(a.nnz()) / static_cast<double>(bounds.size() - 1);
+    return static_cast<double>(heaviest) / mean;
+}
+
+// ---------------------------------------------------------------------------
+// Kernels
+// ---------------------------------------------------------------------------
+
+// y[i] = A[i, :] x for rows [r0, r1).
+inline void spmv_rows(const CsrMatrix& a, const double* x, double* y, size_t r0, size_t r1) {
+    const size_t* rp = a.row_ptr.data();
+    const uint32_t* col = a.col.data();
+    const double* val = a.val.data();
+    for (size_t i = r0; i < r1; ++i) {
+        double s = 0.0;
+        for (size_t p = rp[i]; p < rp[i + 1]; ++p) s += val[p] * x[col[p]];
+        y[i] = s;
+    }
+}
+
+// C[i, 0:n) = A[i, :] B for rows [r0, r1), with B dense (cols x n, row-major).
+// Each nonzero scales one B row into the C row, which stays in L1 for the
+// narrow n this is used with, and the inner loop vectorizes over n.
+inline void spmm_rows(const CsrMatrix& a, const double* b, size_t ldb, size_t n, double* c, size_t ldc,
+                      size_t r0, size_t r1) {
+    const size_t* rp = a.row_ptr.data();
+    const uint32_t* col = a.col.data();
+    const double* val = a.val.data();
+    for (size_t i = r0; i < r1; ++i) {
+        double* __restrict ci = c + i * ldc;
+        std::fill(ci, ci + n, 0.0);
+        for (size_t p = rp[i]; p < rp[i + 1]; ++p) {
+            const double v = val[p];
+            const double* __restrict bk = b + static_cast<size_t>(col[p]) * ldb;
+            for (size_t j = 0; j < n; ++j) ci[j] += v * bk[j];
+        }
+    }
+}
+
+template <typename RunTasks>
+void spmv_tasks(RunTasks&& run_tasks_fn, const CsrMatrix& a, const std::vector<size_t>& bounds, const double* x,
+                double* y) {
+    if (bounds.size() < 2) return;
+    run_tasks_fn(bounds.size() - 1, [&](size_t t) { spmv_rows(a, x, y, bounds[t], bounds[t + 1]); });
+}
+
+template <typename RunTasks>
+void spmm_tasks(RunTasks&& run_tasks_fn, const CsrMatrix& a, const std::vector<size_t>& bounds, const double* b,
+                size_t ldb, size_t n, double* c, size_t ldc) {
+    if (bounds.size() < 2) return;
+    run_tasks_fn(bounds.size() - 1, [&](size_t t) { spmm_rows(a, b, ldb, n, c, ldc, bounds[t], bounds[t + 1]); });
+}
+
+}  // namespace matmul
@@ -0,0 +1,187 @@
+#pragma once
+
+// Block-size / micro-kernel autotuner for the tiled matmul with a persistent
+// on-disk cache.
+//
+// Entries are keyed by CPU model, cache sizes, matrix size, pool kind and
+// thread count, so one cache file can be shared across machines (for example
+// via a home directory on NFS). The file is plain CSV:
+//
+//   cpu_model,l1d,l2,l3,n,pool,threads,bs,kernel,gflops
+//
+// Location: $MATMUL_TUNING_CACHE, else $XDG_CACHE_HOME/concurrency_in_cpp/,
+// else $HOME/.cache/concurrency_in_cpp/, else the working directory.
+
+#include "cpu_dispatch.h"
+#include "matmul_kernels.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace matmul {
+
+struct TuningKey {
+    std::string cpu_model;
+    CacheInfo caches;
+    size_t n;
+    std::string pool;
+    size_t threads;
+};
+
+struct TunedParams {
+    size_t bs;
+    std::string kernel;
+    double gflops;
+};
+
+inline TuningKey make_tuning_key(size_t n, const std::string& pool, size_t threads) {
+    std::string model = cpu::model_name();
+    std::replace(model.begin(), model.end(), ',', ' ');
+    return TuningKey{model, detect_caches(), n, pool, threads};
+}
+
+inline std::string default_tuning_cache_path() {
+    if (const char* p = std::getenv("MATMUL_TUNING_CACHE"); p != nullptr && *p != '\0') {
+        return p;
+    }
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    const char* home = std::getenv("HOME");
+    std::filesystem::path dir;
+    if (xdg != nullptr && *xdg != '\0') {
+        dir = std::filesystem::path(xdg) / "concurrency_in_cpp";
+    } else if (home != nullptr && *home != '\0') {
+        dir = std::filesystem::path(home) / ".cache" / "concurrency_in_cpp";
+    } else {
+        return "matmul_tuning.csv";
+    }
+    return (dir / "matmul_tuning.csv").string();
+}
+
+inline std::string tuning_key_prefix(const TuningKey& key) {
+    std::ostringstream os;
+    os << key.cpu_model << ',' << key.caches.l1d << ',' << key.caches.l2 << ',' << key.caches.l3
+       << ',' << key.n << ',' << key.pool << ',' << key.threads << ',';
+    return os.str();
+}
+
+inline std::optional<TunedParams> load_tuned(const std::string& path, const TuningKey& key) {
+    std::ifstream in(path);
+    if (!in) {
+        return std::nullopt;
+    }
+    const std::string prefix = tuning_key_prefix(key);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.rfind(prefix, 0) != 0) {
+            continue;
+        }
+        std::istringstream rest(line.substr(prefix.size()));
+        std::string bs, kernel, gflops;
+        if (!std::getline(rest, bs, ',') || !std::getline(rest, kernel, ',') || !std::getline(rest, gflops)) {
+            continue;
+        }
+        try {
+            return TunedParams{static_cast<size_t>(std::stoul(bs)), kernel, std::stod(gflops)};
+        } catch (...) {
+            continue;
+        }
+    }
+    return std::nullopt;
+}
+
+// Replaces any existing entry for the key. Writes through a temp file and a
+// rename so a concurrent reader never sees a half-written cache.
+inline bool store_tuned(const std::string& path, const TuningKey& key, const TunedParams& params) {
+    const std::string prefix = tuning_key_prefix(key);
+    std::vector<std::string> lines;
+    {
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.rfind(prefix, 0) != 0 && line.rfind("cpu_model,", 0) != 0) {
+                lines.push_back(line);
+            }
+        }
+    }
+
+    std::error_code ec;
+    const std::filesystem::path target(path);
+    if (target.has_parent_path()) {
+        std::filesystem::create_directories(target.parent_path(), ec);
+    }
+
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out << "cpu_model,l1d,l2,l3,n,pool,threads,bs,kernel,gflops\n";
+        for (const std::string& line : lines) {
+            out << line << '\n';
+        }
+        out << prefix << params.bs << ',' << params.kernel << ',' << params.gflops << '\n';
+        if (!out) {
+            return false;
+        }
+    }
+    std::filesystem::rename(tmp, target, ec);
+    return !ec;
+}
+
+// Block sizes worth trying for an N x N problem: multiples of every kernel's
+// register block that still leave at least one full tile.
+inline std::vector<size_t> candidate_block_sizes(size_t n) {
+    std::vector<size_t> out;
+    for (size_t bs : {16, 32, 48, 64, 96, 128, 192, 256}) {
+        if (bs <= n) {
+            out.push_back(bs);
+        }
+    }
+    if (out.empty()) {
+        out.push_back(n);
+    }
+    return out;
+}
+
+// Exhaustive search over kernels x candidate block sizes. measure(kernel, bs)
+// must return the best wall time in seconds for one multiply; progress is
+// written to log when it is non-null. The first candidate is the fallback, so
+// a result always names a real kernel and block size even if no measurement
+// produced a usable time.
+template <typename Measure>
+TunedParams autotune(size_t n,
+                     const std::vector<const Kernel*>& kernels,
+                     Measure&& measure,
+                     std::ostream* log) {
+    std::optional<TunedParams> best;
+    const double flops = 2.0 * static_cast<double>(n) * static_cast<double>(n) * static_cast<double>(n);
+    for (const Kernel* k : kernels) {
+        for (size_t bs : candidate_block_sizes(n)) {
+            const double t = measure(*k, bs);
+            const double gflops = t > 0.0 ? flops / t * 1e-9 : 0.0;
+            if (log != nullptr) {
+                const size_t tiles = (n + bs - 1) / bs;
+                *log << "tune: kernel=" << k->name << " BS=" << bs
+                     << " tiles=" << tiles * tiles
+                     << " time=" << t << " s GFLOPS=" << gflops << "\n";
+            }
+            if (!best.has_value() || gflops > best->gflops) {
+                best = TunedParams{bs, k->name, gflops};
+            }
+        }
+    }
+    if (!best.has_value()) {
+        return TunedParams{candidate_block_sizes(n).front(), portable_kernel().name, 0.0};
+    }
+    return *best;
+}
+
+}  // namespace matmul
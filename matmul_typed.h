@@ -0,0 +1,343 @@
+#pragma once
+
+// Matmul templated on storage type T and accumulator type Acc, for the
+// non-double element types of matrix_mul_bench:
+//
+//   float       float storage, float accumulate
+//   float_dacc  float storage, double accumulate
+//   int32       int32_t storage and accumulate (wraps on overflow)
+//   int64       int64_t storage and accumulate
+//   bf16        bfloat16 storage, float accumulate; bf16 -> float is a
+//               16-bit shift done in software, so no bf16 ISA is needed
+//
+// double keeps the engine in matmul_gemm.h, which also has split-K, packed
+// and fork-join variants; this one covers the tiled schedule.
+//
+// Each BS x BS output tile is one task. The tile accumulates the whole K
+// range into a per-thread Acc scratch block and converts to T once at the
+// end, so float_dacc really sums in double across K blocks. The register
+// tile is MR rows x two Acc vectors; B loads convert T -> Acc lane-wise
+// (widen float to double, shift bf16 into the high half of a float), so one
+// body vectorizes for every type. ISA variants are compiled with target
+// attributes as in matmul_kernels.h.
+
+#include "cpu_dispatch.h"
+#include "matmul_gemm.h"
+#include "matmul_kernels.h"
+#include "matmul_matrix.h"
+#include "matmul_order.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace matmul {
+
+// bfloat16: the high 16 bits of an IEEE float.
+struct bf16 {
+    uint16_t bits;
+};
+
+inline float bf16_to_float(bf16 x) {
+    const uint32_t u = static_cast<uint32_t>(x.bits) << 16;
+    float f;
+    std::memcpy(&f, &u, sizeof f);
+    return f;
+}
+
+// Round to nearest even; NaNs stay quiet NaNs.
+inline bf16 float_to_bf16(float f) {
+    uint32_t u;
+    std::memcpy(&u, &f, sizeof u);
+    if ((u & 0x7fffffffu) > 0x7f800000u) {
+        return bf16{static_cast<uint16_t>((u >> 16) | 0x40u)};
+    }
+    u += 0x7fffu + ((u >> 16) & 1u);
+    return bf16{static_cast<uint16_t>(u >> 16)};
+}
+
+template <typename Acc, typename T>
+inline Acc to_acc(T x) {
+    if constexpr (std::is_same_v<T, bf16>) {
+        return static_cast<Acc>(bf16_to_float(x));
+    } else {
+        return static_cast<Acc>(x);
+    }
+}
+
+template <typename T, typename Acc>
+inline T from_acc(Acc x) {
+    if constexpr (std::is_same_v<T, bf16>) {
+        return float_to_bf16(static_cast<float>(x));
+    } else {
+        return static_cast<T>(x);
+    }
+}
+
+enum class DType { Double, Float, FloatDoubleAcc, Int32, Int64, Bf16 };
+
+inline const char* dtype_name(DType t) {
+    switch (t) {
+        case DType::Double: return "double";
+        case DType::Float: return "float";
+        case DType::FloatDoubleAcc: return "float_dacc";
+        case DType::Int32: return "int32";
+        case DType::Int64: return "int64";
+        case DType::Bf16: return "bf16";
+    }
+    return "double";
+}
+
+inline std::optional<DType> parse_dtype(std::string_view name) {
+    if (name == "double") return DType::Double;
+    if (name == "float") return DType::Float;
+    if (name == "float_dacc") return DType::FloatDoubleAcc;
+    if (name == "int32") return DType::Int32;
+    if (name == "int64") return DType::Int64;
+    if (name == "bf16") return DType::Bf16;
+    return std::nullopt;
+}
+
+// ---------------------------------------------------------------------------
+// Kernels: C[m x n] += A[m x kc] * B[kc x n] with C in Acc.
+// ---------------------------------------------------------------------------
+
+// GCC vector of W lanes of E.
+template <typename E, size_t W>
+struct SimdOf {
+    typedef E type __attribute__((vector_size(W * sizeof(E))));
+};
+
+// W consecutive T loaded into v, a vector of W Acc lanes.
+template <typename V, typename T, typename Acc, size_t W>
+__attribute__((always_inline)) inline void load_as_acc(V& v, const T* p) {
+    if constexpr (std::is_same_v<T, Acc>) {
+        std::memcpy(&v, p, sizeof v);
+    } else if constexpr (std::is_same_v<T, bf16>) {
+        static_assert(std::is_same_v<Acc, float>, "bf16 accumulates in float");
+        using H = typename SimdOf<uint16_t, W>::type;
+        using U = typename SimdOf<uint32_t, W>::type;
+        H h;
+        std::memcpy(&h, p, sizeof h);
+        const U u = __builtin_convertvector(h, U) << 16;
+        std::memcpy(&v, &u, sizeof v);
+    } else {
+        using S = typename SimdOf<T, W>::type;
+        S s;
+        std::memcpy(&s, p, sizeof s);
+        v = __builtin_convertvector(s, V);
+    }
+}
+
+// As in the double micro-kernels, the row loop is a fold over
+// std::index_sequence so the accumulators stay in registers.
+template <typename T, typename Acc, size_t W, size_t... R>
+__attribute__((always_inline)) inline void typed_tile(std::index_sequence<R...>,
+                                                      size_t kc,
+                                                      const T* a, size_t lda,
+                                                      const T* b, size_t ldb,
+                                                      Acc* c, size_t ldc) {
+    using V = typename SimdOf<Acc, W>::type;
+    V c0[sizeof...(R)], c1[sizeof...(R)];
+    ((std::memcpy(&c0[R], c + R * ldc, sizeof(V)), std::memcpy(&c1[R], c + R * ldc + W, sizeof(V))), ...);
+    for (size_t p = 0; p < kc; ++p) {
+        V b0, b1;
+        load_as_acc<V, T, Acc, W>(b0, b + p * ldb);
+        load_as_acc<V, T, Acc, W>(b1, b + p * ldb + W);
+        ((c0[R] += to_acc<Acc>(a[R * lda + p]) * b0, c1[R] += to_acc<Acc>(a[R * lda + p]) * b1), ...);
+    }
+    ((std::memcpy(c + R * ldc, &c0[R], sizeof(V)), std::memcpy(c + R * ldc + W, &c1[R], sizeof(V))), ...);
+}
+
+template <typename T, typename Acc, size_t W, size_t MR>
+__attribute__((always_inline)) inline void typed_block_body(size_t m, size_t n, size_t kc,
+                                                            const T* a, size_t lda,
+                                                            const T* b, size_t ldb,
+                                                            Acc* c, size_t ldc) {
+    constexpr size_t NR = 2 * W;
+    const size_t n_full = n - n % NR;
+    size_t i = 0;
+    for (; i + MR <= m; i += MR) {
+        for (size_t j = 0; j < n_full; j += NR) {
+            typed_tile<T, Acc, W>(std::make_index_sequence<MR>{}, kc, a + i * lda, lda, b + j, ldb,
+                                  c + i * ldc + j, ldc);
+        }
+    }
+    for (; i < m; ++i) {
+        for (size_t j = 0; j < n_full; j += NR) {
+            typed_tile<T, Acc, W>(std::make_index_sequence<1>{}, kc, a + i * lda, lda, b + j, ldb,
+                                  c + i * ldc + j, ldc);
+        }
+    }
+    if (n_full == n) return;
+    for (size_t r = 0; r < m; ++r) {
+        for (size_t p = 0; p < kc; ++p) {
+            const Acc arp = to_acc<Acc>(a[r * lda + p]);
+            const T* bp = b + p * ldb;
+            for (size_t j = n_full; j < n; ++j) c[r * ldc + j] += arp * to_acc<Acc>(bp[j]);
+        }
+    }
+}
+
+template <typename T, typename Acc>
+using TypedBlockFn = void (*)(size_t m, size_t n, size_t kc,
+                              const T* a, size_t lda,
+                              const T* b, size_t ldb,
+                              Acc* c, size_t ldc);
+
+template <typename T, typename Acc>
+void typed_block_portable(size_t m, size_t n, size_t kc, const T* a, size_t lda, const T* b, size_t ldb,
+                          Acc* c, size_t ldc) {
+    typed_block_body<T, Acc, 16 / sizeof(Acc), 4>(m, n, kc, a, lda, b, ldb, c, ldc);
+}
+
+#if CPU_DISPATCH_X86
+template <typename T, typename Acc>
+__attribute__((target("sse2"))) void typed_block_sse2(size_t m, size_t n, size_t kc, const T* a, size_t lda,
+                                                      const T* b, size_t ldb, Acc* c, size_t ldc) {
+    typed_block_body<T, Acc, 16 / sizeof(Acc), 4>(m, n, kc, a, lda, b, ldb, c, ldc);
+}
+
+template <typename T, typename Acc>
+__attribute__((target("avx2,fma"))) void typed_block_avx2(size_t m, size_t n, size_t kc, const T* a, size_t lda,
+                                                          const T* b, size_t ldb, Acc* c, size_t ldc) {
+    typed_block_body<T, Acc, 32 / sizeof(Acc), 6>(m, n, kc, a, lda, b, ldb, c, ldc);
+}
+
+template <typename T, typename Acc>
+__attribute__((target("avx512f"))) void typed_block_avx512(size_t m, size_t n, size_t kc, const T* a, size_t lda,
+                                                           const T* b, size_t ldb, Acc* c, size_t ldc) {
+    typed_block_body<T, Acc, 64 / sizeof(Acc), 8>(m, n, kc, a, lda, b, ldb, c, ldc);
+}
+#endif
+
+template <typename T, typename Acc>
+TypedBlockFn<T, Acc> typed_block_for(cpu::Isa isa) {
+#if CPU_DISPATCH_X86
+    switch (isa) {
+        case cpu::Isa::Sse2: return typed_block_sse2<T, Acc>;
+        case cpu::Isa::Avx2: return typed_block_avx2<T, Acc>;
+        case cpu::Isa::Avx512: return typed_block_avx512<T, Acc>;
+        case cpu::Isa::Portable: break;
+    }
+#else
+    (void)isa;
+#endif
+    return typed_block_portable<T, Acc>;
+}
+
+// ---------------------------------------------------------------------------
+// Tiled C = A * B (C overwritten), all row-major nn.
+// ---------------------------------------------------------------------------
+
+// opt.kernel selects the ISA variant by name (nullptr: dispatched ISA);
+// opt.bs, opt.order and opt.workers are used as in gemm_tasks, the
+// schedule is always output tiles.
+template <typename T, typename Acc, typename RunTasks>
+void gemm_typed_tasks(RunTasks&& run_tasks_fn,
+                      size_t M, size_t N, size_t K,
+                      const T* a, size_t lda,
+                      const T* b, size_t ldb,
+                      T* c, size_t ldc,
+                      const GemmOptions& opt = {}) {
+    check_gemm_args(Trans::No, Trans::No, M, N, K, lda, ldb, ldc, opt.bs);
+    if (M == 0 || N == 0) return;
+
+    const cpu::Isa isa = opt.kernel != nullptr ? cpu::parse_isa(opt.kernel->name).value_or(cpu::Isa::Portable)
+                                               : cpu::selected_isa();
+    const TypedBlockFn<T, Acc> fn = typed_block_for<T, Acc>(isa);
+    const size_t bs = opt.bs;
+    const size_t tiles_j = (N + bs - 1) / bs;
+    const size_t tiles = ((M + bs - 1) / bs) * tiles_j;
+    const std::vector<uint32_t>& order = cached_tile_order((M + bs - 1) / bs, tiles_j, opt.order, gemm_workers(opt));
+
+    run_tasks_fn(tiles, [&](size_t t) {
+        const size_t tile = ordered_tile(order, t);
+        const size_t i0 = (tile / tiles_j) * bs;
+        const size_t j0 = (tile % tiles_j) * bs;
+        const size_t m = std::min(bs, M - i0);
+        const size_t n = std::min(bs, N - j0);
+
+        thread_local std::vector<Acc> acc;
+        acc.assign(m * n, Acc{});
+        for (size_t k0 = 0; k0 < K; k0 += bs) {
+            const size_t kc = std::min(bs, K - k0);
+            fn(m, n, kc, a + i0 * lda + k0, lda, b + k0 * ldb + j0, ldb, acc.data(), n);
+        }
+        for (size_t i = 0; i < m; ++i) {
+            T* ci = c + (i0 + i) * ldc + j0;
+            for (size_t j = 0; j < n; ++j) ci[j] = from_acc<T>(acc[i * n + j]);
+        }
+    });
+}
+
+// ---------------------------------------------------------------------------
+// Storage
+// ---------------------------------------------------------------------------
+
+// Matrix of T on top of Matrix storage (same alignment, padding rule and
+// page backing); each row uses ceil(cols * sizeof(T) / 8) doubles of it.
+template <typename T>
+class TypedMatrix {
+public:
+    TypedMatrix() = default;
+
+    TypedMatrix(size_t rows, size_t cols, const MatrixOptions& opt = {})
+        : raw_(rows, (cols * sizeof(T) + sizeof(double) - 1) / sizeof(double), opt), cols_(cols) {}
+
+    size_t rows() const { return raw_.rows(); }
+    size_t cols() const { return cols_; }
+    size_t ld() const { return raw_.ld() * sizeof(double) / sizeof(T); }
+
+    T* data() { return reinterpret_cast<T*>(raw_.data()); }
+    const T* data() const { return reinterpret_cast<const T*>(raw_.data()); }
+    T* row(size_t i) { return data() + i * ld(); }
+    const T* row(size_t i) const { return data() + i * ld(); }
+    T& operator()(size_t i, size_t j) { return row(i)[j]; }
+    const T& operator()(size_t i, size_t j) const { return row(i)[j]; }
+
+    Matrix& storage() { return raw_; }
+    const Matrix& storage() const { return raw_; }
+
+private:
+    Matrix raw_;
+    size_t cols_{0};
+};
+
+// Benchmark value for counter i: counter_uniform() in [-1, 1) for floating
+// types, an integer in [-8, 8) for integer types so int32 sums stay exact up
+// to K = 2^25.
+template <typename T>
+inline T counter_value(uint64_t key, uint64_t i) {
+    const double u = counter_uniform(key, i);
+    if constexpr (std::is_integral_v<T>) {
+        return static_cast<T>(std::floor(u * 8.0));
+    } else if constexpr (std::is_same_v<T, bf16>) {
+        return float_to_bf16(static_cast<float>(u));
+    } else {
+        return static_cast<T>(u);
+    }
+}
+
+template <typename RunTasks, typename T>
+void init_random(RunTasks&& run_tasks_fn, TypedMatrix<T>& m, uint64_t seed, size_t rows_per_task) {
+    const size_t step = std::max<size_t>(rows_per_task, 1);
+    const uint64_t key = mix64(seed);
+    run_tasks_fn((m.rows() + step - 1) / step, [&](size_t t) {
+        const size_t r1 = std::min(m.rows(), (t + 1) * step);
+        for (size_t i = t * step; i < r1; ++i) {
+            T* row = m.row(i);
+            const uint64_t base = static_cast<uint64_t>(i) * m.cols();
+            for (size_t j = 0; j < m.cols(); ++j) row[j] = counter_value<T>(key, base + j);
+        }
+    });
+}
+
+}  // namespace matmul
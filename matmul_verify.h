@@ -0,0 +1,165 @@
+#pragma once
+
+// Freivalds check of a computed product C = op(A) * op(B) in O(N^2).
+//
+// For a random vector r, C r must equal op(A) (op(B) r). Both sides are
+// three matrix-vector products, so checking costs about as much as reading
+// A, B and C once, against O(N^3) for a reference multiply. A dropped,
+// misplaced or double-applied tile changes C r by roughly a tile row's worth
+// of C and is caught with probability ~1 for real-valued r.
+//
+// The comparison is per row of C: |(C r)_i - (op(A) op(B) r)_i| must stay
+// below tolerance * (|op(A)| |op(B)| |r|)_i, which covers rounding in the
+// sums, plus 4 * u * ||C_i. * r||_2 for the rounding of C to its storage
+// type (unit roundoff u: 0 for double and integers, 2^-24 for float, 2^-8
+// for bf16). Storage errors have random signs, so they grow with the 2-norm
+// of the row rather than its absolute sum, which keeps a dropped tile
+// detectable for bf16 at large N.
+//
+// Both passes run as row-range tasks on run_tasks_fn (the gemm_tasks
+// contract), so the check is parallel on the same pool as the multiply.
+
+#include "matmul_gemm.h"
+#include "matmul_matrix.h"
+#include "matmul_typed.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace matmul {
+
+struct VerifyOptions {
+    double tolerance{0.0};      // 0: default_verify_tolerance<T>()
+    size_t rows_per_task{64};
+};
+
+struct VerifyResult {
+    bool ok{true};
+    size_t bad_rows{0};
+    double max_error{0.0};  // max over rows of error / allowed error; <= 1 passes
+    double seconds{0.0};
+};
+
+// Relative to |op(A)| |op(B)| |r|: double and integer products (summed in
+// double here) only see double rounding; float and bf16 products may be
+// accumulated in float. Rounding of C itself is the storage_roundoff() term.
+template <typename T>
+constexpr double default_verify_tolerance() {
+    return std::is_same_v<T, double> || std::is_integral_v<T> ? 1e-12 : 1e-6;
+}
+
+template <typename T>
+constexpr double storage_roundoff() {
+    if constexpr (std::is_same_v<T, float>) return 0x1.0p-24;
+    if constexpr (std::is_same_v<T, bf16>) return 0x1.0p-8;
+    return 0.0;
+}
+
+// y[i] = sum_p op(M)[i, p] * x[p] and y_abs[i] = sum_p |op(M)[i, p]| * x_abs[p]
+// for i in [i0, i1); op(M) has `inner` columns. y_abs may be nullptr.
+template <typename T>
+void verify_gemv_rows(Trans trans, const T* m, size_t ld, size_t i0, size_t i1, size_t inner,
+                      const double* x, const double* x_abs, double* y, double* y_abs) {
+    if (trans == Trans::No) {
+        for (size_t i = i0; i < i1; ++i) {
+            const T* row = m + i * ld;
+            double s = 0.0, s_abs = 0.0;
+            for (size_t p = 0; p < inner; ++p) {
+                const double v = to_acc<double>(row[p]);
+                s += v * x[p];
+                s_abs += std::abs(v) * x_abs[p];
+            }
+            y[i] = s;
+            if (y_abs != nullptr) y_abs[i] = s_abs;
+        }
+        return;
+    }
+    // op(M)[i, p] = M[p, i]: walk stored rows so the inner loop is contiguous.
+    std::fill(y + i0, y + i1, 0.0);
+    if (y_abs != nullptr) std::fill(y_abs + i0, y_abs + i1, 0.0);
+    for (size_t p = 0; p < inner; ++p) {
+        const T* row = m + p * ld;
+        for (size_t i = i0; i < i1; ++i) {
+            const double v = to_acc<double>(row[i]);
+            y[i] += v * x[p];
+            if (y_abs != nullptr) y_abs[i] += std::abs(v) * x_abs[p];
+        }
+    }
+}
+
+// Checks C (M x N) against op(A) (M x K) * op(B) (K x N). seed selects r;
+// use a different seed per check for independent trials.
+template <typename T, typename RunTasks>
+VerifyResult freivalds_verify(RunTasks&& run_tasks_fn,
+                              Trans trans_a, Trans trans_b,
+                              size_t M, size_t N, size_t K,
+                              const T* a, size_t lda,
+                              const T* b, size_t ldb,
+                              const T* c, size_t ldc,
+                              uint64_t seed,
+                              const VerifyOptions& opt = {}) {
+    const auto t0 = std::chrono::steady_clock::now();
+    const double tol = opt.tolerance > 0.0 ? opt.tolerance : default_verify_tolerance<T>();
+    const size_t step = std::max<size_t>(opt.rows_per_task, 1);
+    const uint64_t key = mix64(seed);
+
+    std::vector<double> r(N), r_abs(N), y(K), y_abs(K), z(M), z_abs(M);
+    for (size_t j = 0; j < N; ++j) {
+        r[j] = counter_uniform(key, j);
+        r_abs[j] = std::abs(r[j]);
+    }
+
+    // y = op(B) r
+    run_tasks_fn((K + step - 1) / step, [&](size_t t) {
+        const size_t p0 = t * step;
+        verify_gemv_rows(trans_b, b, ldb, p0, std::min(K, p0 + step), N, r.data(), r_abs.data(), y.data(),
+                         y_abs.data());
+    });
+
+    // z = op(A) y against w = C r, row range by row range.
+    VerifyResult res;
+    std::atomic<size_t> bad{0};
+    std::mutex max_mutex;
+    run_tasks_fn((M + step - 1) / step, [&](size_t t) {
+        const size_t i0 = t * step;
+        const size_t i1 = std::min(M, i0 + step);
+        verify_gemv_rows(trans_a, a, lda, i0, i1, K, y.data(), y_abs.data(), z.data(), z_abs.data());
+
+        size_t local_bad = 0;
+        double local_max = 0.0;
+        for (size_t i = i0; i < i1; ++i) {
+            const T* ci = c + i * ldc;
+            double w = 0.0, w_sq = 0.0;
+            for (size_t j = 0; j < N; ++j) {
+                const double v = to_acc<double>(ci[j]) * r[j];
+                w += v;
+                w_sq += v * v;
+            }
+            const double err = std::abs(w - z[i]);
+            const double allowed = tol * z_abs[i] + 4.0 * storage_roundoff<T>() * std::sqrt(w_sq);
+            // A NaN in C makes both err and allowed NaN; it must land on infinity, not 0.
+            const double ratio = allowed > 0.0 ? err / allowed
+                                               : (err == 0.0 ? 0.0 : std::numeric_limits<double>::infinity());
+            if (!(ratio <= 1.0)) ++local_bad;
+            local_max = std::max(local_max, std::isnan(ratio) ? std::numeric_limits<double>::infinity() : ratio);
+        }
+        bad.fetch_add(local_bad, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lk(max_mutex);
+        res.max_error = std::max(res.max_error, local_max);
+    });
+
+    res.bad_rows = bad.load(std::memory_order_relaxed);
+    res.ok = res.bad_rows == 0;
+    res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return res;
+}
+
+}  // namespace matmul
@@ -8,17 +8,60 @@ g++ -O3 -std=c++20 -pthread matrix_mul_bench.cpp \
 ./matrix_mul_bench classic 1024 64 8 1 3
 ./matrix_mul_bench ws      1024 64 8 1 3
 ./matrix_mul_bench elastic 1024 64 8 1 3
+./matrix_mul_bench ws      1024 64 8 1 3 avx2
 
-1st arg: number of the matrix dimension (N)
-2nd arg: block size (BS)
+1st arg: matrix dimension N, or MxNxK for rectangular C (MxN) = op(A) (MxK) * op(B) (KxN);
+  for algo=chain|chain_barrier: P0xP1x...xPn, the factor sizes of M0 (P0xP1) ... Mn-1
+2nd arg: block size (BS), or "auto" (tuning cache, else 64) or "tune" (search + store)
 3rd arg: number of threads
 4th arg: number of warmup runs (not timed)
 5th arg: number of timed runs (best and average reported)
+6th optional arg: micro-kernel (auto|portable|sse2|avx2|avx512, default auto)
+7th optional arg: algorithm (auto|tiled|splitk|packed|recursive|strassen|ooc|chain|chain_barrier,
+  default auto)
+8th optional arg: transposes (nn|nt|tn|tt, default nn)
+9th optional arg: element type (double|float|float_dacc|int32|int64|bf16, default
+  double; the others run the tiled nn path of matmul_typed.h)
+
+Matrix storage (see matmul_matrix.h):
+  MATMUL_PAGES=auto|small|thp|hugetlb   (default auto: thp for large matrices)
+  MATMUL_PAD=0|1                        (default 1: pad power-of-two rows by 64 B)
+
+Verification (see matmul_verify.h):
+  MATMUL_VERIFY=1   Freivalds check of C after every timed rep, O(N^2) on the
+                    pool; its time is reported separately, failures exit 2
+
+Tile order for the tiled/splitk paths (see matmul_order.h):
+  MATMUL_ORDER=row|morton|hilbert|bpanel  (default row)
+
+Matrix files (see matmul_file.h; missing input files are created with the
+same values as the in-memory inputs):
+  MATMUL_A_FILE=a.mat MATMUL_B_FILE=b.mat   mmap A / B instead of generating them
+  algo=ooc: out-of-core C = A * B between files (nn only). A and B default to
+  matmul_a.mat / matmul_b.mat, C is written to MATMUL_C_FILE (default
+  matmul_c.mat), and MATMUL_OOC_MB (default 512) bounds the panel memory.
+
+Matrix chains (see matmul_expr.h):
+  algo=chain evaluates M0 M1 ... Mn-1 (+ D with MATMUL_CHAIN_ADD=1) as one
+  tile DAG in the cheapest parenthesization; chain_barrier runs the same plan
+  as one gemm per product. N alone means three N x N factors.
 */
 
 
+#include "bench_harness.h"
 #include "thread_pool.h"
 #include "coro_runtime.h"
+#include "matmul_expr.h"
+#include "matmul_file.h"
+#include "matmul_gemm.h"
+#include "matmul_kernels.h"
+#include "matmul_matrix.h"
+#include "matmul_recursive.h"
+#include "matmul_tuning.h"
+#include "matmul_typed.h"
+#include "matmul_verify.h"
+
+#include <unistd.h>
 
 #include <algorithm>
 #include <atomic>
@@ -26,10 +69,14 @@ g++ -O3 -std=c++20 -pthread matrix_mul_bench.cpp \
 #include <cmath>
 #include <condition_variable>
 #include <cstdint>
+#include <cstdlib>
 #include <exception>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <mutex>
-#include <random>
+#include <optional>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
@@ -40,172 +87,446 @@ static inline double seconds_since(const Clock::time_point& t0) {
     return std::chrono::duration<double>(Clock::now() - t0).count();
 }
 
-static inline size_t ridx(size_t N, size_t r, size_t c) { return r * N + c; }
-
-static void fill_random(std::vector<double>& M, uint64_t seed) {
-    std::mt19937_64 rng(seed);
-    std::uniform_real_distribution<double> dist(-1.0, 1.0);
-    for (auto& x : M) x = dist(rng);
+// Problem shape: C (M x N) = op(A) (M x K) * op(B) (K x N).
+struct Shape {
+    size_t m, n, k;
+    matmul::Trans trans_a, trans_b;
+
+    bool square() const { return m == n && n == k; }
+    // Stored operand dimensions (op(A) is M x K, so A^T is stored K x M).
+    size_t a_rows() const { return trans_a == matmul::Trans::No ? m : k; }
+    size_t a_cols() const { return trans_a == matmul::Trans::No ? k : m; }
+    size_t b_rows() const { return trans_b == matmul::Trans::No ? k : n; }
+    size_t b_cols() const { return trans_b == matmul::Trans::No ? n : k; }
+};
+
+// "1024" -> 1024^3, "4096x64x4096" -> M=4096 N=64 K=4096.
+static bool parse_shape(const std::string& text, Shape& s) {
+    size_t dims[3] = {0, 0, 0};
+    size_t count = 0, pos = 0;
+    while (count < 3) {
+        size_t used = 0;
+        try {
+            dims[count++] = std::stoul(text.substr(pos), &used);
+        } catch (...) {
+            return false;
+        }
+        pos += used;
+        if (pos == text.size()) break;
+        if (text[pos] != 'x') return false;
+        ++pos;
+    }
+    if (pos != text.size() || (count != 1 && count != 3)) return false;
+    s.m = dims[0];
+    s.n = count == 3 ? dims[1] : dims[0];
+    s.k = count == 3 ? dims[2] : dims[0];
+    return s.m > 0 && s.n > 0 && s.k > 0;
 }
 
-// Compute one C tile: C[i0..i0+BS, j0..j0+BS] += A*B using k-blocking
-static void matmul_tile(size_t N, size_t BS,
-                        const std::vector<double>& A,
-                        const std::vector<double>& B,
-                        std::vector<double>& C,
-                        size_t i0, size_t j0) {
-    const size_t i_max = std::min(i0 + BS, N);
-    const size_t j_max = std::min(j0 + BS, N);
-
-    for (size_t k0 = 0; k0 < N; k0 += BS) {
-        const size_t k_max = std::min(k0 + BS, N);
-
-        for (size_t i = i0; i < i_max; ++i) {
-            for (size_t k = k0; k < k_max; ++k) {
-                const double aik = A[ridx(N, i, k)];
-                const size_t b_row = ridx(N, k, 0);
-                for (size_t j = j0; j < j_max; ++j) {
-                    C[ridx(N, i, j)] += aik * B[b_row + j];
-                }
-            }
+// "1024" -> 1024x1024x1024x1024 (three square factors), "512x64x512" -> 512x64 * 64x512.
+static bool parse_chain_dims(const std::string& text, std::vector<size_t>& dims) {
+    dims.clear();
+    size_t pos = 0;
+    while (true) {
+        size_t used = 0;
+        try {
+            dims.push_back(std::stoul(text.substr(pos), &used));
+        } catch (...) {
+            return false;
         }
+        if (dims.back() == 0) return false;
+        pos += used;
+        if (pos == text.size()) break;
+        if (text[pos] != 'x') return false;
+        ++pos;
     }
+    if (dims.size() == 1) dims.assign(4, dims[0]);
+    return dims.size() >= 3;
 }
 
-template <typename Pool>
-static double matmul_parallel(Pool& pool,
-                              size_t N, size_t BS,
-                              const std::vector<double>& A,
-                              const std::vector<double>& B,
-                              std::vector<double>& C) {
-    std::fill(C.begin(), C.end(), 0.0);
+static bool parse_trans(const std::string& text, Shape& s) {
+    if (text.size() != 2) return false;
+    for (size_t i = 0; i < 2; ++i) {
+        if (text[i] != 'n' && text[i] != 't') return false;
+    }
+    s.trans_a = text[0] == 't' ? matmul::Trans::Yes : matmul::Trans::No;
+    s.trans_b = text[1] == 't' ? matmul::Trans::Yes : matmul::Trans::No;
+    return true;
+}
+
+static double gflops(const Shape& s, double seconds) {
+    const double flops = 2.0 * static_cast<double>(s.m) * static_cast<double>(s.n) * static_cast<double>(s.k);
+    return seconds > 0.0 ? flops / seconds * 1e-9 : 0.0;
+}
 
-    const size_t tiles_i = (N + BS - 1) / BS;
-    const size_t tiles_j = (N + BS - 1) / BS;
-    const size_t total_tiles = tiles_i * tiles_j;
+static size_t strassen_cutoff_from_env() {
+    const char* raw = std::getenv("MATMUL_STRASSEN_CUTOFF");
+    if (raw == nullptr || *raw == '\0') return 1024;
+    try {
+        return std::max<size_t>(std::stoul(raw), 1);
+    } catch (...) {
+        return 1024;
+    }
+}
 
-    std::atomic<size_t> done{0};
-    std::mutex m;
-    std::condition_variable cv;
+// Tiled paths through matmul::gemm_tasks, C = op(A) * op(B) with alpha = 1,
+// beta = 0: one task per BS x BS output tile, or (tile, K slice) tasks plus a
+// parallel reduction under split-K.
+template <typename RunTasks>
+static double matmul_tiled(RunTasks&& run_tasks_fn,
+                           const matmul::GemmOptions& opt,
+                           const Shape& s,
+                           const matmul::Matrix& A,
+                           const matmul::Matrix& B,
+                           matmul::Matrix& C) {
+    const auto t0 = Clock::now();
+    matmul::gemm_tasks(run_tasks_fn, s.trans_a, s.trans_b, s.m, s.n, s.k,
+                       1.0, A.data(), A.ld(), B.data(), B.ld(),
+                       0.0, C.data(), C.ld(), opt);
+    return seconds_since(t0);
+}
 
-    auto t0 = Clock::now();
+// GotoBLAS-style packed GEMM. For every (NC, KC) panel, one parallel phase
+// packs the B panel into NR slivers and A into MC x KC blocks, then a second
+// phase runs (MC block, sliver chunk) tasks over the shared read-only packed
+// buffers. The KC loop accumulates into C, so the phases are separated by the
+// join inside run_tasks.
+template <typename RunTasks>
+static double matmul_packed(RunTasks&& run_tasks_fn,
+                            const matmul::Kernel& kernel,
+                            const matmul::PackedBlocking& pb,
+                            size_t N,
+                            const matmul::Matrix& A,
+                            const matmul::Matrix& B,
+                            matmul::Matrix& C) {
+    for (size_t i = 0; i < N; ++i) {
+        std::fill(C.row(i), C.row(i) + N, 0.0);
+    }
 
-    for (size_t ti = 0; ti < tiles_i; ++ti) {
-        for (size_t tj = 0; tj < tiles_j; ++tj) {
-            const size_t i0 = ti * BS;
-            const size_t j0 = tj * BS;
+    constexpr size_t kPackSliversPerTask = 8;
+    constexpr size_t kComputeSliversPerTask = 16;
 
-            pool.submit([&, i0, j0] {
-                matmul_tile(N, BS, A, B, C, i0, j0);
+    const size_t nr = kernel.nr;
+    const size_t nc_max = std::min(pb.nc, N);
+    const size_t kc_max = std::min(pb.kc, N);
+    matmul::AlignedBuffer ap(N * kc_max);
+    matmul::AlignedBuffer bp(matmul::packed_b_size(kc_max, nc_max, nr));
 
-                const size_t finished = done.fetch_add(1, std::memory_order_acq_rel) + 1;
-                if (finished == total_tiles) {
-                    std::lock_guard<std::mutex> lk(m);
-                    cv.notify_one();
+    const auto t0 = Clock::now();
+
+    for (size_t jc = 0; jc < N; jc += pb.nc) {
+        const size_t nc = std::min(pb.nc, N - jc);
+        const size_t slivers = (nc + nr - 1) / nr;
+
+        for (size_t pc = 0; pc < N; pc += pb.kc) {
+            const size_t kc = std::min(pb.kc, N - pc);
+
+            const size_t b_tasks = (slivers + kPackSliversPerTask - 1) / kPackSliversPerTask;
+            const size_t a_tasks = (N + pb.mc - 1) / pb.mc;
+            run_tasks_fn(b_tasks + a_tasks, [&](size_t t) {
+                if (t < b_tasks) {
+                    const size_t j0 = t * kPackSliversPerTask * nr;
+                    const size_t cols = std::min(kPackSliversPerTask * nr, nc - j0);
+                    matmul::pack_b(kc, cols, B.row(pc) + jc + j0, B.ld(),
+                                   bp.data() + (j0 / nr) * kc * nr, nr);
+                    return;
                 }
+                const size_t i0 = (t - b_tasks) * pb.mc;
+                const size_t rows = std::min(pb.mc, N - i0);
+                matmul::pack_a(rows, kc, A.row(i0) + pc, A.ld(), ap.data() + i0 * kc);
             });
-        }
-    }
 
-    // Join: wait until all tiles finish
-    {
-        std::unique_lock<std::mutex> lk(m);
-        cv.wait(lk, [&] { return done.load(std::memory_order_acquire) == total_tiles; });
+            const size_t chunk_cols = kComputeSliversPerTask * nr;
+            const size_t col_tasks = (nc + chunk_cols - 1) / chunk_cols;
+            run_tasks_fn(a_tasks * col_tasks, [&](size_t t) {
+                const size_t i0 = (t / col_tasks) * pb.mc;
+                const size_t j0 = (t % col_tasks) * chunk_cols;
+                const size_t rows = std::min(pb.mc, N - i0);
+                const size_t cols = std::min(chunk_cols, nc - j0);
+                matmul::packed_macro_kernel(kernel, rows, cols, kc,
+                                            ap.data() + i0 * kc,
+                                            bp.data() + (j0 / nr) * kc * nr,
+                                            C.row(i0) + jc + j0, C.ld());
+            });
+        }
     }
 
     return seconds_since(t0);
 }
 
-static coro::DetachedTask matmul_tile_coro(size_t N,
-                                           size_t BS,
-                                           const std::vector<double>& A,
-                                           const std::vector<double>& B,
-                                           std::vector<double>& C,
-                                           size_t i0,
-                                           size_t j0,
-                                           coro::PoolScheduler sched,
-                                           std::atomic<size_t>& done,
-                                           const size_t total_tiles,
-                                           std::mutex& m,
-                                           std::condition_variable& cv,
-                                           std::exception_ptr& ep,
-                                           std::mutex& ep_m) {
-    co_await sched.schedule();
-    try {
-        matmul_tile(N, BS, A, B, C, i0, j0);
-    } catch (...) {
-        std::lock_guard<std::mutex> lk(ep_m);
-        if (!ep) {
-            ep = std::current_exception();
+static double checksum_sparse(const matmul::Matrix& C) {
+    // prevent “optimize away” & keep O(N) small
+    double s = 0.0;
+    const size_t size = C.rows() * C.cols();
+    const size_t step = std::max<size_t>(1, size / 32);
+    for (size_t i = 0; i < size; i += step) s += C(i / C.cols(), i % C.cols());
+    return s;
+}
+
+// Same sample positions as the in-memory checksum, read back from a C file.
+static double checksum_sparse(const matmul::MatrixFile& C) {
+    double s = 0.0;
+    const size_t size = C.rows() * C.cols();
+    const size_t step = std::max<size_t>(1, size / 32);
+    for (size_t i = 0; i < size; i += step) s += C.at(i / C.cols(), i % C.cols());
+    return s;
+}
+
+// Operands and timed multiply for a non-double dtype. Values come from the
+// same counters as the double inputs, so checksums are comparable in sign
+// and magnitude (integers are scaled to [-8, 8)).
+struct TypedBench {
+    std::function<double()> multiply;
+    std::function<double()> checksum;
+    std::function<matmul::VerifyResult(uint64_t seed)> verify;
+    std::string pages;
+    size_t padding{0};
+};
+
+template <typename T, typename Acc, typename RunTasks>
+static TypedBench typed_bench_for(RunTasks run, const Shape& s, const matmul::MatrixOptions& storage,
+                                  size_t bs, const matmul::GemmOptions& opt) {
+    struct Operands {
+        matmul::TypedMatrix<T> a, b, c;
+    };
+    auto m = std::make_shared<Operands>(Operands{matmul::TypedMatrix<T>(s.m, s.k, storage),
+                                                 matmul::TypedMatrix<T>(s.k, s.n, storage),
+                                                 matmul::TypedMatrix<T>(s.m, s.n, storage)});
+    matmul::init_random(run, m->a, 12345, bs);
+    matmul::init_random(run, m->b, 67890, bs);
+    matmul::init_zero(run, m->c.storage(), bs);
+
+    TypedBench tb;
+    tb.multiply = [m, run, s, opt] {
+        const auto t0 = Clock::now();
+        matmul::gemm_typed_tasks<T, Acc>(run, s.m, s.n, s.k, m->a.data(), m->a.ld(), m->b.data(), m->b.ld(),
+                                         m->c.data(), m->c.ld(), opt);
+        return seconds_since(t0);
+    };
+    tb.verify = [m, run, s](uint64_t seed) {
+        return matmul::freivalds_verify(run, matmul::Trans::No, matmul::Trans::No, s.m, s.n, s.k,
+                                        m->a.data(), m->a.ld(), m->b.data(), m->b.ld(),
+                                        m->c.data(), m->c.ld(), seed);
+    };
+    tb.checksum = [m] {
+        double sum = 0.0;
+        const size_t size = m->c.rows() * m->c.cols();
+        const size_t step = std::max<size_t>(1, size / 32);
+        for (size_t i = 0; i < size; i += step) {
+            sum += (matmul::to_acc<double>(m->c(i / m->c.cols(), i % m->c.cols())));
         }
-    }
+        return sum;
+    };
+    tb.pages = matmul::describe_pages(m->c.storage());
+    tb.padding = m->c.ld() - m->c.cols();
+    return tb;
+}
 
-    const size_t finished = done.fetch_add(1, std::memory_order_acq_rel) + 1;
-    if (finished == total_tiles) {
-        std::lock_guard<std::mutex> lk(m);
-        cv.notify_one();
+template <typename RunTasks>
+static TypedBench make_typed_bench(matmul::DType dtype, RunTasks run, const Shape& s,
+                                   const matmul::MatrixOptions& storage, size_t bs,
+                                   const matmul::GemmOptions& opt) {
+    switch (dtype) {
+        case matmul::DType::Float: return typed_bench_for<float, float>(run, s, storage, bs, opt);
+        case matmul::DType::FloatDoubleAcc: return typed_bench_for<float, double>(run, s, storage, bs, opt);
+        case matmul::DType::Int32: return typed_bench_for<int32_t, int32_t>(run, s, storage, bs, opt);
+        case matmul::DType::Int64: return typed_bench_for<int64_t, int64_t>(run, s, storage, bs, opt);
+        case matmul::DType::Bf16: return typed_bench_for<matmul::bf16, float>(run, s, storage, bs, opt);
+        case matmul::DType::Double: break;
     }
+    throw std::invalid_argument("make_typed_bench: double uses the gemm engine");
 }
 
-static double matmul_coroutine_parallel(ThreadPool& pool,
-                                        size_t N,
-                                        size_t BS,
-                                        const std::vector<double>& A,
-                                        const std::vector<double>& B,
-                                        std::vector<double>& C) {
-    std::fill(C.begin(), C.end(), 0.0);
-
-    const size_t tiles_i = (N + BS - 1) / BS;
-    const size_t tiles_j = (N + BS - 1) / BS;
-    const size_t total_tiles = tiles_i * tiles_j;
-
-    std::atomic<size_t> done{0};
-    std::mutex m;
-    std::condition_variable cv;
-    std::exception_ptr ep;
-    std::mutex ep_m;
-    coro::PoolScheduler sched(pool);
+struct ChainBench {
+    std::vector<size_t> dims;
+    bool add{false};
+    bool barrier{false};
+};
 
-    const auto t0 = Clock::now();
+static std::string describe_dims(const std::vector<size_t>& dims) {
+    std::string out;
+    for (size_t i = 0; i < dims.size(); ++i) {
+        out += (i ? "x" : "") + std::to_string(dims[i]);
+    }
+    return out;
+}
 
-    for (size_t ti = 0; ti < tiles_i; ++ti) {
-        for (size_t tj = 0; tj < tiles_j; ++tj) {
-            const size_t i0 = ti * BS;
-            const size_t j0 = tj * BS;
-            matmul_tile_coro(N, BS, A, B, C, i0, j0, sched, done, total_tiles, m, cv, ep, ep_m);
+// algo=chain|chain_barrier: factors and D are initialized on the pool with
+// seeds 12345 + f and 67890. Returns false if a verify check failed.
+template <typename RunTasks, typename Spawn>
+static bool run_chain_bench(RunTasks&& run, Spawn spawn, const ChainBench& cb, const std::string& pool_kind,
+                            const matmul::Kernel& kernel, const matmul::GemmOptions& opt, size_t threads,
+                            int warmup, int reps, bool verify, bool& write_failed) {
+    const std::vector<size_t>& p = cb.dims;
+    const matmul::MatrixOptions storage = matmul::matrix_options_from_env();
+    const auto setup_t0 = Clock::now();
+    std::vector<matmul::Matrix> factors;
+    std::vector<matmul::ExprOperand> operands;
+    for (size_t f = 0; f + 1 < p.size(); ++f) {
+        factors.emplace_back(p[f], p[f + 1], storage);
+        matmul::init_random(run, factors.back(), 12345 + f, opt.bs);
+        operands.push_back(matmul::expr_operand(factors.back()));
+    }
+    matmul::MatrixExpr expr = matmul::MatrixExpr::product(operands);
+    matmul::Matrix D, C(p.front(), p.back(), storage);
+    if (cb.add) {
+        D = matmul::Matrix(p.front(), p.back(), storage);
+        matmul::init_random(run, D, 67890, opt.bs);
+        expr.plus(matmul::expr_operand(D));
+    }
+    matmul::init_zero(run, C, opt.bs);
+    const double setup_s = seconds_since(setup_t0);
+
+    matmul::ExprDag<Spawn> dag(std::move(spawn), kernel, opt.bs);
+    matmul::ExprBuffers barrier_buffers;
+    const matmul::ChainPlan plan = matmul::plan_chain(p);
+
+    std::cout << "MatMul benchmark (chain)\n"
+              << "pool=" << pool_kind << " dims=" << describe_dims(p)
+              << (cb.add ? " +D" : "")
+              << " plan=" << matmul::describe_chain(plan)
+              << " flops=" << plan.flops
+              << " left_to_right_flops=" << matmul::chain_flops_left_to_right(p)
+              << " BS=" << opt.bs
+              << " threads=" << threads
+              << " warmup=" << warmup
+              << " reps=" << reps
+              << " kernel=" << kernel.name
+              << " " << cpu::describe_dispatch()
+              << " algo=" << (cb.barrier ? "chain_barrier" : "chain")
+              << " pages=" << matmul::describe_pages(C) << "\n";
+    std::cout << "Setup: " << setup_s << " s (parallel init of factors and C)\n";
+
+    auto multiply = [&] {
+        const auto t0 = Clock::now();
+        if (cb.barrier) {
+            matmul::evaluate_expr_barrier(run, expr, C.data(), C.ld(), barrier_buffers, opt);
+        } else {
+            dag.evaluate(expr, C.data(), C.ld());
+        }
+        return seconds_since(t0);
+    };
+    double verify_s = 0.0, verify_max_error = 0.0;
+    size_t verified = 0, verify_failures = 0;
+    const bench::Samples samples = bench::repeat(bench::repeat_options(warmup, reps), [&](int r) {
+        const double t = multiply();
+        if (verify && r >= 0) {
+            const matmul::VerifyResult v =
+                matmul::freivalds_verify_expr(run, expr, C.data(), C.ld(), 0x5eed0000ull + static_cast<uint64_t>(r));
+            ++verified;
+            verify_s += v.seconds;
+            verify_max_error = std::max(verify_max_error, v.max_error);
+            if (!v.ok) {
+                ++verify_failures;
+                std::cerr << "Verify FAILED after run " << r << ": " << v.bad_rows << " of " << C.rows()
+                          << " rows differ (max error " << v.max_error << "x tolerance)\n";
+            }
         }
+        return t;
+    });
+    const bench::Stats st = bench::summarize(samples.runs);
+    const double checksum = checksum_sparse(C);
+    bench::Report report("matrix", pool_kind, threads);
+    report.param("dims", describe_dims(p))
+        .param("add", cb.add)
+        .param("bs", opt.bs)
+        .param("kernel", kernel.name)
+        .param("algo", cb.barrier ? "chain_barrier" : "chain");
+    report.metric("flops", plan.flops)
+        .metric("gflops_best", plan.flops / st.best * 1e-9)
+        .metric("gflops_median", plan.flops / st.median * 1e-9)
+        .metric("checksum", checksum);
+    if (verify) {
+        report.metric("verify_failures", verify_failures);
     }
-
-    {
-        std::unique_lock<std::mutex> lk(m);
-        cv.wait(lk, [&] { return done.load(std::memory_order_acquire) == total_tiles; });
+    const bool written = report.finish(samples);
+    std::cout << "GFLOPS (best): " << plan.flops / st.best * 1e-9 << "\n";
+    std::cout << "GFLOPS (avg) : " << plan.flops / st.mean * 1e-9 << "\n";
+    std::cout << "Checksum: " << checksum << "\n";
+    if (!cb.barrier) {
+        std::cout << "Tiles per evaluation: " << dag.tasks_spawned()
+                  << " started_early=" << dag.tiles_started_early() << "\n";
     }
-
-    if (ep) {
-        std::rethrow_exception(ep);
+    if (verify) {
+        std::cout << "Verify: " << (verify_failures == 0 ? "ok" : "FAILED")
+                  << " checks=" << verified
+                  << " failed=" << verify_failures
+                  << " max_error=" << verify_max_error
+                  << " time_s=" << verify_s
+                  << " avg_s=" << (verified > 0 ? verify_s / verified : 0.0)
+                  << " (not included in run times)\n";
     }
+    write_failed = !written;
+    return verify_failures == 0;
+}
 
-    return seconds_since(t0);
+static std::string env_string(const char* name, const std::string& def) {
+    const char* raw = std::getenv(name);
+    return (raw != nullptr && *raw != '\0') ? raw : def;
 }
 
-static double checksum_sparse(const std::vector<double>& C) {
-    // prevent “optimize away” & keep O(N) small
-    double s = 0.0;
-    const size_t step = std::max<size_t>(1, C.size() / 32);
-    for (size_t i = 0; i < C.size(); i += step) s += C[i];
-    return s;
+static size_t env_size_t(const char* name, size_t def) {
+    try {
+        const size_t v = std::stoul(env_string(name, std::to_string(def)));
+        return v > 0 ? v : def;
+    } catch (...) {
+        return def;
+    }
+}
+
+// Creates a missing input file from the benchmark seed; an existing file
+// must have the expected shape.
+static void ensure_matrix_file(const std::string& path, size_t rows, size_t cols, uint64_t seed) {
+    if (::access(path.c_str(), F_OK) != 0) {
+        matmul::create_random_matrix_file(path, rows, cols, seed);
+        std::cout << "Created " << path << " (" << rows << "x" << cols << ")\n";
+        return;
+    }
+    const matmul::MatrixFile f = matmul::MatrixFile::open(path);
+    if (f.rows() != rows || f.cols() != cols) {
+        throw std::runtime_error(path + " is " + std::to_string(f.rows()) + "x" + std::to_string(f.cols()) +
+                                 ", expected " + std::to_string(rows) + "x" + std::to_string(cols));
+    }
 }
 
 static void usage(const char* prog) {
     std::cerr
         << "Usage:\n  " << prog
-        << " <pool: classic|elastic|ws|advws|coro> <N> <BS> <threads> <warmup> <reps>\n\n"
+        << " <pool: classic|elastic|ws|advws|coro> <N|MxNxK> <BS> <threads> <warmup> <reps> [kernel] [algo] [trans] [dtype]\n\n"
+        << "Shape:   N (square) or MxNxK: C (MxN) = op(A) (MxK) * op(B) (KxN)\n"
+        << "Kernels: auto|portable|sse2|avx2|avx512 (default auto = CPU_DISPATCH_ISA or widest supported)\n"
+        << "Algos:   auto|tiled|splitk|packed (default auto = output tiles, or split-K when there are\n"
+        << "         fewer output tiles than threads; packed = GotoBLAS panels, square nn only, ignores BS)\n"
+        << "         recursive|strassen: nested fork-join tasks, BS = base case (nn only);\n"
+        << "         strassen applies Strassen-Winograd above MATMUL_STRASSEN_CUTOFF (default 1024)\n"
+        << "         ooc: out-of-core between matrix files (MATMUL_A_FILE/B_FILE/C_FILE, MATMUL_OOC_MB; nn only)\n"
+        << "         chain|chain_barrier: product of factors P0xP1x...xPn (shape arg) as one tile DAG or one\n"
+        << "         gemm per product; MATMUL_CHAIN_ADD=1 adds a P0xPn matrix D\n"
+        << "Trans:   nn|nt|tn|tt (default nn; t = operand stored transposed)\n"
+        << "Dtype:   double|float|float_dacc|int32|int64|bf16 (default double; float_dacc = float storage,\n"
+        << "         double accumulate; bf16 accumulates in float; non-double types run tiled nn only)\n"
+        << "Verify:  MATMUL_VERIFY=1 checks C after every timed rep (Freivalds, O(N^2), not timed)\n"
+        << "Order:   MATMUL_ORDER=row|morton|hilbert|bpanel (tile submission order, default row)\n"
+        << "BS:      number | auto (tuning cache, else 64) | tune (search and store in cache; square only)\n\n"
         << "Examples:\n"
         << "  " << prog << " classic 1024 64 8 1 3\n"
         << "  " << prog << " ws      1024 64 8 1 3\n"
         << "  " << prog << " elastic 1024 64 4 1 3   (elastic uses min=threads, max=2*threads)\n"
         << "  " << prog << " advws   1024 64 4 1 3   (advanced elastic stealing)\n"
-        << "  " << prog << " coro    1024 64 8 1 3   (coroutine tiles on fixed pool)\n";
+        << "  " << prog << " coro    1024 64 8 1 3   (coroutine tiles on fixed pool)\n"
+        << "  " << prog << " ws      1024 64 8 1 3 portable\n"
+        << "  " << prog << " ws      1024 64 8 1 3 auto packed\n"
+        << "  " << prog << " ws      1024 tune 8 1 3\n"
+        << "  " << prog << " ws      1024 auto 8 1 3\n"
+        << "  " << prog << " ws      8192x64x1024 64 8 1 3          (tall-skinny)\n"
+        << "  " << prog << " ws      512x512x8192 64 8 1 3 auto tiled tn\n"
+        << "  " << prog << " ws      64x64x65536 64 8 1 3 auto splitk\n"
+        << "  " << prog << " ws      2048 64 8 1 3 auto recursive\n"
+        << "  " << prog << " ws      4096 64 8 1 3 auto strassen\n"
+        << "  " << prog << " ws      16384 64 8 0 1 auto ooc\n"
+        << "  " << prog << " ws      2048 64 8 1 3 auto tiled nn float\n"
+        << "  " << prog << " ws      2048x256x2048x512 64 8 1 3 auto chain\n"
+        << "  MATMUL_ORDER=hilbert " << prog << " ws 4096 64 16 1 3 auto tiled\n";
 }
 
 int main(int argc, char** argv) {
@@ -215,76 +536,401 @@ int main(int argc, char** argv) {
     }
 
     const std::string pool_kind = argv[1];
-    const size_t N = std::stoul(argv[2]);
-    const size_t BS = std::stoul(argv[3]);
+    const std::string bs_arg = argv[3];
     const size_t threads = std::stoul(argv[4]);
     const int warmup = std::stoi(argv[5]);
     const int reps = std::stoi(argv[6]);
+    const std::string kernel_name = (argc >= 8) ? argv[7] : "auto";
+    const std::string algo = (argc >= 9) ? argv[8] : "auto";
+    const std::string trans = (argc >= 10) ? argv[9] : "nn";
+    const std::string dtype_name = (argc >= 11) ? argv[10] : "double";
+
+    const bool chain = algo == "chain" || algo == "chain_barrier";
+    ChainBench chain_bench;
+    chain_bench.barrier = algo == "chain_barrier";
+    Shape shape{};
+    if (chain) {
+        if (!parse_chain_dims(argv[2], chain_bench.dims)) {
+            std::cerr << "Bad chain: " << argv[2] << " (expected N or P0xP1x...xPn with at least two factors)\n";
+            usage(argv[0]);
+            return 1;
+        }
+        // Only used for validation and tuning below: the first product.
+        shape.m = chain_bench.dims[0];
+        shape.k = chain_bench.dims[1];
+        shape.n = chain_bench.dims[2];
+    } else if (!parse_shape(argv[2], shape)) {
+        std::cerr << "Bad shape: " << argv[2] << " (expected N or MxNxK)\n";
+        usage(argv[0]);
+        return 1;
+    }
+    if (!parse_trans(trans, shape)) {
+        std::cerr << "Bad trans: " << trans << " (expected nn|nt|tn|tt)\n";
+        usage(argv[0]);
+        return 1;
+    }
+    const size_t N = shape.n;
 
-    std::cout << "MatMul benchmark (blocked)\n"
-              << "pool=" << pool_kind
-              << " N=" << N << " BS=" << BS
-              << " threads=" << threads
-              << " warmup=" << warmup
-              << " reps=" << reps << "\n";
+    const matmul::Kernel* kernel = matmul::find_kernel(kernel_name);
+    if (kernel == nullptr) {
+        std::cerr << "Unknown or unsupported kernel on this CPU: " << kernel_name << "\n";
+        usage(argv[0]);
+        return 1;
+    }
+    if (algo != "auto" && algo != "tiled" && algo != "splitk" && algo != "packed" &&
+        algo != "recursive" && algo != "strassen" && algo != "ooc" && !chain) {
+        std::cerr << "Unknown algo: " << algo << "\n";
+        usage(argv[0]);
+        return 1;
+    }
+    if (algo == "packed" && (!shape.square() || trans != "nn")) {
+        std::cerr << "algo=packed supports square nn problems only\n";
+        return 1;
+    }
+    const std::optional<matmul::DType> dtype = matmul::parse_dtype(dtype_name);
+    if (!dtype) {
+        std::cerr << "Unknown dtype: " << dtype_name << "\n";
+        usage(argv[0]);
+        return 1;
+    }
+    const bool typed = *dtype != matmul::DType::Double;
+    if (typed && ((algo != "auto" && algo != "tiled") || trans != "nn")) {
+        std::cerr << "dtype=" << dtype_name << " supports algo=auto|tiled with nn only\n";
+        return 1;
+    }
+    const bool fork_join = algo == "recursive" || algo == "strassen";
+    const bool ooc = algo == "ooc";
+    if ((fork_join || ooc || chain) && trans != "nn") {
+        std::cerr << "algo=" << algo << " supports nn problems only\n";
+        return 1;
+    }
 
-    std::vector<double> A(N * N), B(N * N), C(N * N);
-    fill_random(A, 12345);
-    fill_random(B, 67890);
+    // BS is a number, "auto" (tuning cache, else 64) or "tune" (search now and
+    // store the winner). An explicit kernel or CPU_DISPATCH_ISA pins the kernel.
+    // Tuning entries are keyed by N, so only square nn problems use the cache.
+    const bool kernel_pinned = kernel_name != "auto" || cpu::dispatch().forced;
+    const bool tunable = shape.square() && trans == "nn";
+    const matmul::TuningKey tune_key = matmul::make_tuning_key(N, pool_kind, threads);
+    const std::string tune_path = matmul::default_tuning_cache_path();
+    size_t BS = 64;
+    std::string bs_source = "arg";
+    if (bs_arg == "auto") {
+        bs_source = "default";
+        if (const auto tuned = tunable ? matmul::load_tuned(tune_path, tune_key) : std::nullopt) {
+            BS = tuned->bs;
+            bs_source = "cache";
+            const matmul::Kernel* tuned_kernel = matmul::find_kernel(tuned->kernel);
+            if (!kernel_pinned && tuned_kernel != nullptr) {
+                kernel = tuned_kernel;
+            }
+        }
+    } else if (bs_arg == "tune") {
+        if (!tunable) {
+            std::cerr << "BS=tune needs a square nn problem\n";
+            return 1;
+        }
+        bs_source = "tuned";
+    } else {
+        BS = std::stoul(bs_arg);
+    }
+    if (BS == 0) {
+        std::cerr << "BS must be > 0\n";
+        return 1;
+    }
 
-    double best = 1e100, sum = 0.0;
+    if (typed && bs_arg == "tune") {
+        std::cerr << "BS=tune is only supported for dtype=double\n";
+        return 1;
+    }
+    if (ooc && bs_arg == "tune") {
+        std::cerr << "BS=tune is not supported with algo=ooc\n";
+        return 1;
+    }
+    if (chain && (typed || bs_arg == "tune")) {
+        std::cerr << "algo=" << algo << " supports dtype=double and a fixed or cached BS only\n";
+        return 1;
+    }
+    chain_bench.add = chain && env_string("MATMUL_CHAIN_ADD", "0") != "0";
+
+    const bool verify = env_string("MATMUL_VERIFY", "0") != "0";
+    bool verify_failed = false;
+    const std::string order_name = env_string("MATMUL_ORDER", "row");
+    const std::optional<matmul::TileOrder> tile_order = matmul::parse_tile_order(order_name);
+    if (!tile_order) {
+        std::cerr << "Unknown MATMUL_ORDER: " << order_name << " (row|morton|hilbert|bpanel)\n";
+        return 1;
+    }
 
-    auto run_pool = [&](auto& pool) {
-        for (int i = 0; i < warmup; ++i) {
-            (void)matmul_parallel(pool, N, BS, A, B, C);
+    // In-memory matrices are allocated here and initialized on the pool inside
+    // run_pool; file inputs are mmap'd, and ooc keeps everything on disk.
+    const matmul::MatrixOptions storage = matmul::matrix_options_from_env();
+    matmul::Matrix A, B, C;
+    std::optional<matmul::MatrixFile> a_file, b_file, c_file;
+    const size_t ooc_mb = env_size_t("MATMUL_OOC_MB", 512);
+    try {
+        const std::string a_path = env_string("MATMUL_A_FILE", ooc ? "matmul_a.mat" : "");
+        const std::string b_path = env_string("MATMUL_B_FILE", ooc ? "matmul_b.mat" : "");
+        if (typed && (!a_path.empty() || !b_path.empty())) {
+            throw std::runtime_error("matrix files hold doubles; dtype=" + dtype_name + " cannot map them");
         }
-        for (int r = 0; r < reps; ++r) {
-            const double t = matmul_parallel(pool, N, BS, A, B, C);
-            best = std::min(best, t);
-            sum += t;
-            std::cout << "Run " << r << ": " << t << " s\n";
+        if (chain && (!a_path.empty() || !b_path.empty())) {
+            throw std::runtime_error("algo=" + algo + " generates its factors in memory");
         }
-        std::cout << "Best: " << best << " s\n";
-        std::cout << "Avg : " << (sum / reps) << " s\n";
-        std::cout << "Checksum: " << checksum_sparse(C) << "\n";
+        if (!a_path.empty()) ensure_matrix_file(a_path, shape.a_rows(), shape.a_cols(), 12345);
+        if (!b_path.empty()) ensure_matrix_file(b_path, shape.b_rows(), shape.b_cols(), 67890);
+        if (ooc) {
+            a_file.emplace(matmul::MatrixFile::open(a_path));
+            b_file.emplace(matmul::MatrixFile::open(b_path));
+            c_file.emplace(matmul::MatrixFile::create(env_string("MATMUL_C_FILE", "matmul_c.mat"), shape.m, shape.n));
+        } else if (!typed && !chain) {
+            A = a_path.empty() ? matmul::Matrix(shape.a_rows(), shape.a_cols(), storage) : matmul::map_matrix_file(a_path);
+            B = b_path.empty() ? matmul::Matrix(shape.b_rows(), shape.b_cols(), storage) : matmul::map_matrix_file(b_path);
+            C = matmul::Matrix(shape.m, shape.n, storage);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Matrix setup failed: " << e.what() << "\n";
+        return 1;
+    }
+
+    bool write_failed = false;
+
+    auto spawn = [](auto& pool, size_t count, const auto& fn) { matmul::run_tasks(pool, count, fn); };
+    auto spawn_coro = [](ThreadPool& pool, size_t count, const auto& fn) { bench::run_tasks_coro(pool, count, fn); };
+    auto fork_pool = [](auto& pool) {
+        return [&pool](std::function<void()> fn) { pool.submit(std::move(fn)); };
+    };
+    auto fork_coro = [](ThreadPool& pool) {
+        return [sched = coro::PoolScheduler(pool)](std::function<void()> fn) { bench::spawn_coro_task(sched, std::move(fn)); };
+    };
+    const size_t strassen_cutoff = algo == "strassen" ? strassen_cutoff_from_env() : 0;
+
+    auto tune = [&](auto&& tiled_fn) {
+        const std::vector<const matmul::Kernel*> kernels =
+            kernel_pinned ? std::vector<const matmul::Kernel*>{kernel} : matmul::supported_kernels();
+        const matmul::TunedParams tuned = matmul::autotune(
+            N, kernels,
+            [&](const matmul::Kernel& k, size_t bs) {
+                (void)tiled_fn(k, bs);
+                double t_best = 1e100;
+                for (int r = 0; r < std::max(reps, 1); ++r) {
+                    t_best = std::min(t_best, tiled_fn(k, bs));
+                }
+                return t_best;
+            },
+            &std::cout);
+        BS = tuned.bs;
+        kernel = matmul::find_kernel(tuned.kernel);
+        const bool saved = matmul::store_tuned(tune_path, tune_key, tuned);
+        std::cout << "Tuned: BS=" << tuned.bs << " kernel=" << tuned.kernel
+                  << " GFLOPS=" << tuned.gflops
+                  << (saved ? " saved to " : " NOT saved to ") << tune_path << "\n";
     };
 
-    if (pool_kind == "classic") {
-        ThreadPool pool(threads);
-        run_pool(pool);
-    } else if (pool_kind == "ws") {
-        ThreadPool pool(threads, ThreadPool::PoolKind::WorkStealing);
-        run_pool(pool);
-    } else if (pool_kind == "elastic") {
-        // Simple policy: min=threads, max=2*threads
-        ThreadPool pool(threads, std::max<size_t>(threads * 2, size_t{1}));
-        run_pool(pool);
-    } else if (pool_kind == "advws") {
-        ThreadPool pool(
-            threads,
-            std::max<size_t>(threads * 2, size_t{1}),
-            ThreadPool::PoolKind::AdvancedElasticStealing,
-            std::chrono::milliseconds(200));
-        run_pool(pool);
-    } else if (pool_kind == "coro") {
-        ThreadPool pool(threads);
-        for (int i = 0; i < warmup; ++i) {
-            (void)matmul_coroutine_parallel(pool, N, BS, A, B, C);
+    auto run_pool = [&](auto& pool, auto&& spawn_fn, auto&& make_fork) {
+        auto run = [&](size_t count, const auto& fn) { spawn_fn(pool, count, fn); };
+        if (chain) {
+            matmul::GemmOptions opt{kernel, BS};
+            opt.workers = threads;
+            opt.order = *tile_order;
+            verify_failed = !run_chain_bench(run, make_fork(pool), chain_bench, pool_kind, *kernel, opt, threads,
+                                             warmup, reps, verify, write_failed);
+            return;
         }
-        for (int r = 0; r < reps; ++r) {
-            const double t = matmul_coroutine_parallel(pool, N, BS, A, B, C);
-            best = std::min(best, t);
-            sum += t;
-            std::cout << "Run " << r << ": " << t << " s\n";
+
+        // Parallel first touch: one task per BS-row panel, in the order the
+        // tiled schedule walks them, with counter-based values so A and B do
+        // not depend on the thread count.
+        auto gemm_opts = [&](const matmul::Kernel& k, size_t bs) {
+            matmul::GemmOptions opt{&k, bs};
+            opt.workers = threads;
+            opt.order = *tile_order;
+            opt.schedule = algo == "tiled"  ? matmul::GemmSchedule::OutputTiles
+                         : algo == "splitk" ? matmul::GemmSchedule::SplitK
+                                            : matmul::GemmSchedule::Auto;
+            return opt;
+        };
+        const auto setup_t0 = Clock::now();
+        TypedBench typed_bench;
+        if (typed) {
+            typed_bench = make_typed_bench(*dtype, run, shape, storage, BS, gemm_opts(*kernel, BS));
+        } else {
+            if (A.backing() != matmul::PageMode::File) matmul::init_random(run, A, 12345, BS);
+            if (B.backing() != matmul::PageMode::File) matmul::init_random(run, B, 67890, BS);
+            matmul::init_zero(run, C, BS);
         }
-        std::cout << "Best: " << best << " s\n";
-        std::cout << "Avg : " << (sum / reps) << " s\n";
-        std::cout << "Checksum: " << checksum_sparse(C) << "\n";
-    } else {
+        const double setup_s = seconds_since(setup_t0);
+        // The tuner searches plain output tiling.
+        auto tiled = [&](const matmul::Kernel& k, size_t bs) {
+            matmul::GemmOptions opt = gemm_opts(k, bs);
+            opt.schedule = matmul::GemmSchedule::OutputTiles;
+            return matmul_tiled(run, opt, shape, A, B, C);
+        };
+
+        if (bs_arg == "tune") {
+            tune(tiled);
+        }
+        const matmul::PackedBlocking pb = matmul::packed_blocking_for(*kernel, matmul::detect_caches());
+        matmul::ForkJoinMatmul fj(make_fork(pool), *kernel, BS, strassen_cutoff);
+
+        std::cout << "MatMul benchmark (blocked)\n"
+                  << "pool=" << pool_kind;
+        if (shape.square()) {
+            std::cout << " N=" << N;
+        } else {
+            std::cout << " M=" << shape.m << " N=" << shape.n << " K=" << shape.k;
+        }
+        if (trans != "nn") {
+            std::cout << " trans=" << trans;
+        }
+        std::cout << " BS=" << BS << " (" << bs_source << ")"
+                  << " threads=" << threads
+                  << " warmup=" << warmup
+                  << " reps=" << reps
+                  << " kernel=" << kernel->name
+                  << " (" << kernel->mr << "x" << kernel->nr << ")"
+                  << " " << cpu::describe_dispatch()
+                  << " algo=" << algo
+                  << " dtype=" << dtype_name;
+        if (ooc) {
+            std::cout << " panel=" << matmul::ooc_panel(ooc_mb << 20, BS) << " budget=" << ooc_mb << "MiB";
+        } else if (typed) {
+            std::cout << " pages=" << typed_bench.pages << " pad=" << typed_bench.padding;
+        } else {
+            std::cout << " pages=" << matmul::describe_pages(C) << " pad=" << C.padding();
+        }
+        if (algo == "packed") {
+            std::cout << " MC=" << pb.mc << " KC=" << pb.kc << " NC=" << pb.nc;
+        } else if (fork_join) {
+            std::cout << " base=" << BS;
+            if (algo == "strassen") {
+                std::cout << " strassen_cutoff=" << strassen_cutoff
+                          << " levels=" << (shape.square() ? fj.strassen_levels(N) : 0);
+            }
+        } else if (!ooc) {
+            matmul::GemmOptions plan_opts = gemm_opts(*kernel, BS);
+            if (typed) plan_opts.schedule = matmul::GemmSchedule::OutputTiles;
+            const matmul::GemmPlan plan = matmul::plan_gemm(shape.m, shape.n, shape.k, plan_opts);
+            std::cout << " tiles=" << plan.tiles << " order=" << matmul::tile_order_name(*tile_order);
+            if (plan.splits > 1) {
+                std::cout << " splitk=" << plan.splits;
+            }
+        }
+        std::cout << "\n";
+        std::cout << "Setup: " << setup_s << " s (parallel init of A, B, C)\n";
+
+        matmul::OocStats ooc_stats;
+        auto multiply = [&] {
+            if (typed) {
+                return typed_bench.multiply();
+            }
+            if (ooc) {
+                matmul::OocOptions o;
+                o.gemm = gemm_opts(*kernel, BS);
+                o.memory_bytes = ooc_mb << 20;
+                const auto t0 = Clock::now();
+                ooc_stats = matmul::ooc_gemm(run, *a_file, *b_file, *c_file, o);
+                return seconds_since(t0);
+            }
+            if (algo == "packed") {
+                return matmul_packed(run, *kernel, pb, N, A, B, C);
+            }
+            if (fork_join) {
+                const auto t0 = Clock::now();
+                fj.multiply(shape.m, shape.n, shape.k, A.data(), A.ld(), B.data(), B.ld(), C.data(), C.ld());
+                return seconds_since(t0);
+            }
+            return matmul_tiled(run, gemm_opts(*kernel, BS), shape, A, B, C);
+        };
+
+        // Out-of-core C lives in a file, so only in-memory products are checked.
+        auto verify_product = [&](uint64_t seed) {
+            if (typed) {
+                return typed_bench.verify(seed);
+            }
+            return matmul::freivalds_verify(run, shape.trans_a, shape.trans_b, shape.m, shape.n, shape.k,
+                                            A.data(), A.ld(), B.data(), B.ld(), C.data(), C.ld(), seed);
+        };
+        size_t verified = 0, verify_failures = 0;
+        double verify_s = 0.0, verify_max_error = 0.0;
+
+        const bench::Samples samples = bench::repeat(bench::repeat_options(warmup, reps), [&](int r) {
+            const double t = multiply();
+            if (verify && !ooc && r >= 0) {
+                const matmul::VerifyResult v = verify_product(0x5eed0000ull + static_cast<uint64_t>(r));
+                ++verified;
+                verify_s += v.seconds;
+                verify_max_error = std::max(verify_max_error, v.max_error);
+                if (!v.ok) {
+                    ++verify_failures;
+                    std::cerr << "Verify FAILED after run " << r << ": " << v.bad_rows << " of " << shape.m
+                              << " rows differ (max error " << v.max_error << "x tolerance)\n";
+                }
+            }
+            return t;
+        });
+        const bench::Stats st = bench::summarize(samples.runs);
+        const double checksum = ooc ? checksum_sparse(*c_file) : typed ? typed_bench.checksum() : checksum_sparse(C);
+        bench::Report report("matrix", pool_kind, threads);
+        report.param("m", shape.m)
+            .param("n", shape.n)
+            .param("k", shape.k)
+            .param("trans", trans)
+            .param("bs", BS)
+            .param("kernel", kernel->name)
+            .param("algo", algo)
+            .param("dtype", dtype_name);
+        report.metric("gflops_best", gflops(shape, st.best))
+            .metric("gflops_median", gflops(shape, st.median))
+            .metric("checksum", checksum);
+        if (fork_join) {
+            report.metric("tasks_per_multiply", fj.tasks_spawned());
+        }
+        if (verify && !ooc) {
+            report.metric("verify_failures", verify_failures);
+        }
+        write_failed = !report.finish(samples);
+        std::cout << "GFLOPS (best): " << gflops(shape, st.best) << "\n";
+        std::cout << "GFLOPS (avg) : " << gflops(shape, st.mean) << "\n";
+        if (ooc) {
+            std::cout << "Checksum: " << checksum << "\n";
+            std::cout << "Out-of-core: panel=" << ooc_stats.panel
+                      << " steps=" << ooc_stats.steps
+                      << " read_MiB=" << (ooc_stats.bytes_read >> 20)
+                      << " written_MiB=" << (ooc_stats.bytes_written >> 20)
+                      << " io_wait_s=" << ooc_stats.io_wait_s
+                      << " compute_s=" << ooc_stats.compute_s << "\n";
+        } else {
+            std::cout << "Checksum: " << checksum << "\n";
+        }
+        if (fork_join) {
+            std::cout << "Tasks per multiply: " << fj.tasks_spawned() << "\n";
+        }
+        if (verify && ooc) {
+            std::cout << "Verify: skipped (algo=ooc keeps C on disk)\n";
+        } else if (verify) {
+            std::cout << "Verify: " << (verify_failures == 0 ? "ok" : "FAILED")
+                      << " checks=" << verified
+                      << " failed=" << verify_failures
+                      << " max_error=" << verify_max_error
+                      << " time_s=" << verify_s
+                      << " avg_s=" << (verified > 0 ? verify_s / verified : 0.0)
+                      << " (not included in run times)\n";
+            verify_failed = verify_failures > 0;
+        }
+    };
+
+    const bool known = bench::with_pool(pool_kind, threads, [&](ThreadPool& pool) {
+        if (pool_kind == "coro") {
+            run_pool(pool, spawn_coro, fork_coro);
+        } else {
+            run_pool(pool, spawn, fork_pool);
+        }
+    });
+    if (!known) {
         std::cerr << "Unknown pool kind: " << pool_kind << "\n";
         usage(argv[0]);
         return 1;
     }
 
-    return 0;
+    return verify_failed ? 2 : write_failed ? 1 : 0;
 }
@@ -1,8 +1,9 @@
 /*
 Mini HTTP server backed by your ThreadPool.
 
-Endpoint:
+Endpoints:
   GET /work?cpu1=200&io=5000&cpu2=200
+  GET /metrics   (request counters and the dispatched ISA variant)
 
 Meaning (microseconds):
   cpu1: CPU busy work before I/O
@@ -23,6 +24,9 @@ Where:
   elastic:      elastic <port> <min_threads> <max_threads>
   advws:        advws  <port> <min_threads> <max_threads> <idle_ms>
 
+Optional environment variables:
+  CPU_DISPATCH_ISA=portable|sse2|avx2|avx512   (force the busy-work hash variant)
+
 Notes:
   - This server intentionally uses a *blocking* sleep for the I/O phase so you can
     observe thread blocking, context switches, and oversubscription effects.
@@ -32,6 +36,7 @@ Notes:
 
 #include "thread_pool.h"
 #include "coro_runtime.h"
+#include "cpu_dispatch.h"
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
@@ -59,17 +64,101 @@ static inline uint64_t now_ns() {
         .count();
 }
 
+// Busy-work hash loop. Eight independent xorshift-multiply lanes give the
+// vector variants something to widen; the clock is checked once per batch of
+// rounds instead of every round.
+constexpr size_t kBurnLanes = 8;
+constexpr int kBurnRoundsPerCheck = 32;
+
+struct BurnState {
+    uint64_t lane[kBurnLanes];
+};
+
+__attribute__((always_inline)) static inline void burn_rounds_body(BurnState& s, int rounds) {
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < kBurnLanes; ++i) {
+            uint64_t x = s.lane[i];
+            x ^= (x << 13);
+            x ^= (x >> 7);
+            x ^= (x << 17);
+            x *= 1099511628211ull;
+            s.lane[i] = x;
+        }
+    }
+}
+
+using BurnRoundsFn = void (*)(BurnState&, int);
+
+static void burn_rounds_portable(BurnState& s, int rounds) { burn_rounds_body(s, rounds); }
+
+#if CPU_DISPATCH_X86
+__attribute__((target("sse2"))) static void burn_rounds_sse2(BurnState& s, int rounds) {
+    burn_rounds_body(s, rounds);
+}
+
+__attribute__((target("avx2"))) static void burn_rounds_avx2(BurnState& s, int rounds) {
+    burn_rounds_body(s, rounds);
+}
+
+__attribute__((target("avx512f"))) static void burn_rounds_avx512(BurnState& s, int rounds) {
+    burn_rounds_body(s, rounds);
+}
+#endif
+
+static BurnRoundsFn burn_rounds_for(cpu::Isa isa) {
+#if CPU_DISPATCH_X86
+    switch (isa) {
+        case cpu::Isa::Sse2: return burn_rounds_sse2;
+        case cpu::Isa::Avx2: return burn_rounds_avx2;
+        case cpu::Isa::Avx512: return burn_rounds_avx512;
+        case cpu::Isa::Portable: break;
+    }
+#else
+    (void)isa;
+#endif
+    return burn_rounds_portable;
+}
+
+static const BurnRoundsFn burn_rounds = burn_rounds_for(cpu::selected_isa());
+static thread_local uint64_t burn_sink = 0;
+
 static void burn_cpu_us(int us) {
     if (us <= 0) return;
     const uint64_t start = now_ns();
     const uint64_t end = start + static_cast<uint64_t>(us) * 1000ull;
-    volatile uint64_t x = 1469598103934665603ull;
+    BurnState s;
+    for (size_t i = 0; i < kBurnLanes; ++i) {
+        s.lane[i] = 1469598103934665603ull + i;
+    }
     while (now_ns() < end) {
-        x ^= (x << 13);
-        x ^= (x >> 7);
-        x ^= (x << 17);
-        x *= 1099511628211ull;
+        burn_rounds(s, kBurnRoundsPerCheck);
     }
+    burn_sink ^= s.lane[0];
+}
+
+struct ServerMetrics {
+    std::atomic<uint64_t> requests_total{0};
+    std::atomic<uint64_t> work_requests_total{0};
+};
+
+static ServerMetrics& server_metrics() {
+    static ServerMetrics m;
+    return m;
+}
+
+static std::string build_metrics_body() {
+    const ServerMetrics& m = server_metrics();
+    const cpu::Dispatch& d = cpu::dispatch();
+    std::ostringstream body;
+    body << "{";
+    body << "\"endpoint\":\"/metrics\",";
+    body << "\"isa\":\"" << cpu::isa_name(d.isa) << "\",";
+    body << "\"isa_best\":\"" << cpu::isa_name(d.best) << "\",";
+    body << "\"isa_forced\":" << (d.forced ? "true" : "false") << ',';
+    body << "\"requests_total\":" << m.requests_total.load(std::memory_order_relaxed) << ',';
+    body << "\"work_requests_total\":" << m.work_requests_total.load(std::memory_order_relaxed);
+    body << "}\n";
+    return body.str();
 }
 
 static std::optional<int> parse_int(std::string_view s) {
@@ -199,6 +288,14 @@ static void handle_connection(int client_fd) {
         return;
     }
 
+    server_metrics().requests_total.fetch_add(1, std::memory_order_relaxed);
+    if (target == "/metrics") {
+        auto resp = make_http_response(200, "application/json", build_metrics_body());
+        (void)send_all(client_fd, resp.data(), resp.size());
+        ::close(client_fd);
+        return;
+    }
+
     const bool is_work = (target.rfind("/work", 0) == 0);
     if (!is_work) {
         auto resp = make_http_response(404, "text/plain",
@@ -208,6 +305,8 @@ static void handle_connection(int client_fd) {
         return;
     }
 
+    server_metrics().work_requests_total.fetch_add(1, std::memory_order_relaxed);
+
     // Mixed workload params (us)
     int cpu1_us = get_q_int(target, "cpu1", 200);
     int io_us = get_q_int(target, "io", 5000);
@@ -263,6 +362,14 @@ static coro::DetachedTask handle_connection_coro(int client_fd, coro::PoolSchedu
             co_return;
         }
 
+        server_metrics().requests_total.fetch_add(1, std::memory_order_relaxed);
+        if (target == "/metrics") {
+            auto resp = make_http_response(200, "application/json", build_metrics_body());
+            (void)send_all(client_fd, resp.data(), resp.size());
+            ::close(client_fd);
+            co_return;
+        }
+
         const bool is_work = (target.rfind("/work", 0) == 0);
         if (!is_work) {
             auto resp = make_http_response(404, "text/plain",
@@ -272,6 +379,8 @@ static coro::DetachedTask handle_connection_coro(int client_fd, coro::PoolSchedu
             co_return;
         }
 
+        server_metrics().work_requests_total.fetch_add(1, std::memory_order_relaxed);
+
         int cpu1_us = get_q_int(target, "cpu1", 200);
         int io_us = get_q_int(target, "io", 5000);
         int cpu2_us = get_q_int(target, "cpu2", 200);
@@ -396,7 +505,8 @@ int main(int argc, char** argv) {
 
         int listen_fd = make_listen_socket(port);
         std::cout << "Listening on 0.0.0.0:" << port
-                  << " | endpoint: /work?cpu1=200&io=5000&cpu2=200 (us)\n";
+                  << " | endpoint: /work?cpu1=200&io=5000&cpu2=200 (us)"
+                  << " | " << cpu::describe_dispatch() << "\n";
 
         while (true) {
             sockaddr_in client{};
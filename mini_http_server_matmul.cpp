@@ -2,8 +2,9 @@
 Mini HTTP server variant for mixed workloads where the CPU phases are
 matrix-multiplication tasks instead of busy waits.
 
-Endpoint:
+Endpoints:
   GET /work?cpu1=2&io=5000&cpu2=2
+  GET /metrics   (request counters, dispatched ISA and matmul kernel)
 
 Meaning:
   cpu1: number of matrix-multiplication iterations before I/O
@@ -12,7 +13,19 @@ Meaning:
 
 Optional environment variables:
   MIXED_MATMUL_N=64
-  MIXED_MATMUL_BS=32
+  MIXED_MATMUL_BS=32         (or auto: tuning cache, else 32; tune: search at startup)
+  MIXED_MATMUL_KERNEL=auto   (auto|portable|sse2|avx2|avx512)
+  MIXED_MATMUL_FIXED=1       (0: skip the compile-time N/BS specializations)
+  CPU_DISPATCH_ISA=avx2      (pick the ISA behind "auto"; see cpu_dispatch.h)
+  MATMUL_TUNING_CACHE=path   (tuning cache file; see matmul_tuning.h)
+  MATMUL_PAGES=auto          (auto|small|thp|hugetlb; see matmul_matrix.h)
+  MIXED_MATMUL_BATCH_US=200  (batch iterations across requests; see matmul_batch.h)
+  MIXED_MATMUL_BATCH_MAX=32  (max iterations per batch)
+  MIXED_MATMUL_BATCH_MAX_N=32 (larger N ignores MIXED_MATMUL_BATCH_US)
+  MIXED_MATMUL_VERIFY_EVERY=0 (Freivalds-check every Nth product; see matmul_verify.h)
+  MIXED_MATMUL_SCRATCH=1     (0: allocate and zero-fill a result matrix per request)
+  MIXED_MATMUL_PAR_MAX=threads (max workers one product may use; 1: always serial)
+  MIXED_MATMUL_PAR_MIN_N=128 (smaller products always run serially)
 
 Build:
   g++ -O2 -std=c++20 -pthread mini_http_server_matmul.cpp thread_pool.cpp -o mini_http_server_matmul
@@ -27,19 +40,29 @@ Run:
 
 #include "thread_pool.h"
 #include "coro_runtime.h"
+#include "matmul_batch.h"
+#include "matmul_fixed.h"
+#include "matmul_kernels.h"
+#include "matmul_matrix.h"
+#include "matmul_tuning.h"
+#include "matmul_verify.h"
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <random>
 #include <sstream>
@@ -57,13 +80,15 @@ static inline uint64_t now_ns() {
         .count();
 }
 
-static inline size_t ridx(size_t n, size_t r, size_t c) { return r * n + c; }
-
 struct MatmulConfig {
     size_t n;
     size_t bs;
-    std::vector<double> a;
-    std::vector<double> b;
+    const char* bs_source;  // "env", "cache", "tuned" or "default"
+    const matmul::Kernel* kernel;
+    matmul::FixedKernelFn fixed;  // specialization for (n, bs, kernel ISA), or nullptr
+    bool scratch;                 // per-worker result buffer and overwrite kernels
+    matmul::Matrix a;
+    matmul::Matrix b;
 };
 
 static size_t parse_env_size_t(const char* name, size_t def) {
@@ -77,19 +102,136 @@ static size_t parse_env_size_t(const char* name, size_t def) {
     }
 }
 
+// Request-sized matrices stay cache resident, so rows are not padded: the
+// fixed-size kernels need ld == N. MATMUL_PAGES still selects the backing.
+static matmul::Matrix make_matrix(size_t n) {
+    matmul::MatrixOptions opt = matmul::matrix_options_from_env();
+    opt.pad = false;
+    return matmul::Matrix(n, n, opt);
+}
+
+// Rows [i0, i0 + bs) of C. With overwrite set, the first k-block of every
+// tile stores A * B directly (beta = 0 micro-kernels), so C is never
+// zero-filled or read before use. Panels write disjoint rows, so they can run
+// on different workers.
+static void matmul_panel(const matmul::Kernel& kernel,
+                         size_t n,
+                         size_t bs,
+                         const matmul::Matrix& a,
+                         const matmul::Matrix& b,
+                         matmul::Matrix& c,
+                         bool overwrite,
+                         size_t i0) {
+    const size_t i_max = std::min(i0 + bs, n);
+    if (!overwrite) {
+        for (size_t i = i0; i < i_max; ++i) {
+            std::fill(c.row(i), c.row(i) + n, 0.0);
+        }
+    }
+    for (size_t j0 = 0; j0 < n; j0 += bs) {
+        const size_t j_max = std::min(j0 + bs, n);
+        for (size_t k0 = 0; k0 < n; k0 += bs) {
+            const size_t k_max = std::min(k0 + bs, n);
+            matmul::multiply_block(kernel,
+                                   i_max - i0, j_max - j0, k_max - k0,
+                                   a.row(i0) + k0, a.ld(),
+                                   b.row(k0) + j0, b.ld(),
+                                   c.row(i0) + j0, c.ld(),
+                                   overwrite && k0 == 0);
+        }
+    }
+}
+
+static void matmul_blocked(const matmul::Kernel& kernel,
+                           size_t n,
+                           size_t bs,
+                           const matmul::Matrix& a,
+                           const matmul::Matrix& b,
+                           matmul::Matrix& c,
+                           bool overwrite) {
+    for (size_t i0 = 0; i0 < n; i0 += bs) {
+        matmul_panel(kernel, n, bs, a, b, c, overwrite, i0);
+    }
+}
+
+// Each request multiplies on a single worker, so tuning entries are keyed as
+// pool=serial threads=1 regardless of the server's pool.
+static void resolve_block_size(MatmulConfig& cfg, bool kernel_pinned) {
+    const char* raw = std::getenv("MIXED_MATMUL_BS");
+    const std::string mode = (raw != nullptr && *raw != '\0') ? raw : "auto";
+    const matmul::TuningKey key = matmul::make_tuning_key(cfg.n, "serial", 1);
+    const std::string path = matmul::default_tuning_cache_path();
+
+    if (mode == "tune") {
+        const std::vector<const matmul::Kernel*> kernels =
+            kernel_pinned ? std::vector<const matmul::Kernel*>{cfg.kernel} : matmul::supported_kernels();
+        matmul::Matrix c = make_matrix(cfg.n);
+        const matmul::TunedParams tuned = matmul::autotune(
+            cfg.n, kernels,
+            [&](const matmul::Kernel& k, size_t bs) {
+                double best = 1e100;
+                for (int r = 0; r < 5; ++r) {
+                    const auto t0 = Clock::now();
+                    matmul_blocked(k, cfg.n, bs, cfg.a, cfg.b, c, cfg.scratch);
+                    best = std::min(best, std::chrono::duration<double>(Clock::now() - t0).count());
+                }
+                return best;
+            },
+            nullptr);
+        cfg.bs = tuned.bs;
+        cfg.kernel = matmul::find_kernel(tuned.kernel);
+        cfg.bs_source = "tuned";
+        (void)matmul::store_tuned(path, key, tuned);
+        return;
+    }
+    if (mode == "auto") {
+        cfg.bs = 32;
+        cfg.bs_source = "default";
+        if (const auto tuned = matmul::load_tuned(path, key)) {
+            cfg.bs = tuned->bs;
+            cfg.bs_source = "cache";
+            const matmul::Kernel* k = matmul::find_kernel(tuned->kernel);
+            if (!kernel_pinned && k != nullptr) cfg.kernel = k;
+        }
+        return;
+    }
+    cfg.bs = parse_env_size_t("MIXED_MATMUL_BS", 32);
+    cfg.bs_source = "env";
+}
+
 static MatmulConfig make_matmul_config() {
     MatmulConfig cfg;
     cfg.n = parse_env_size_t("MIXED_MATMUL_N", 64);
-    cfg.bs = parse_env_size_t("MIXED_MATMUL_BS", 32);
-    if (cfg.bs == 0) cfg.bs = 32;
+    const char* scratch_raw = std::getenv("MIXED_MATMUL_SCRATCH");
+    cfg.scratch = scratch_raw == nullptr || std::string(scratch_raw) != "0";
+
+    const char* kernel_name = std::getenv("MIXED_MATMUL_KERNEL");
+    cfg.kernel = matmul::find_kernel(kernel_name != nullptr ? kernel_name : "auto");
+    if (cfg.kernel == nullptr) cfg.kernel = &matmul::dispatched_kernel();
+    const bool kernel_pinned =
+        (kernel_name != nullptr && std::string(kernel_name) != "auto") || cpu::dispatch().forced;
 
-    cfg.a.resize(cfg.n * cfg.n);
-    cfg.b.resize(cfg.n * cfg.n);
+    cfg.a = make_matrix(cfg.n);
+    cfg.b = make_matrix(cfg.n);
 
     std::mt19937_64 rng(123456789ull);
     std::uniform_real_distribution<double> dist(-1.0, 1.0);
-    for (double& x : cfg.a) x = dist(rng);
-    for (double& x : cfg.b) x = dist(rng);
+    for (matmul::Matrix* m : {&cfg.a, &cfg.b}) {
+        for (size_t i = 0; i < cfg.n; ++i) {
+            for (size_t j = 0; j < cfg.n; ++j) (*m)(i, j) = dist(rng);
+        }
+    }
+
+    resolve_block_size(cfg, kernel_pinned);
+
+    // Kernel names double as ISA names, so the specialization uses the same
+    // instruction set as the kernel it replaces.
+    cfg.fixed = nullptr;
+    const char* fixed_raw = std::getenv("MIXED_MATMUL_FIXED");
+    const bool fixed_enabled = fixed_raw == nullptr || std::string(fixed_raw) != "0";
+    if (const auto isa = cpu::parse_isa(cfg.kernel->name); fixed_enabled && isa && cfg.a.ld() == cfg.n) {
+        cfg.fixed = matmul::find_fixed_kernel(cfg.n, cfg.bs, *isa);
+    }
     return cfg;
 }
 
@@ -98,52 +240,365 @@ static const MatmulConfig& matmul_config() {
     return cfg;
 }
 
-static void matmul_once(const MatmulConfig& cfg, std::vector<double>& c) {
-    std::fill(c.begin(), c.end(), 0.0);
+// Intra-request parallelism. A product of at least MIXED_MATMUL_PAR_MIN_N
+// splits into bs-row panels that run on the pool as nested tasks
+// (run_tasks_nested: the requesting worker takes panels too). The number of
+// lanes is re-chosen for every product from current load: while accepted
+// connections are still waiting for a worker the product stays serial;
+// otherwise each request currently multiplying gets an equal share of the
+// pool's workers, so a lone request fans out wide.
+struct ParState {
+    ThreadPool* pool{nullptr};
+    size_t workers{1};    // pool threads (max_threads for elastic pools)
+    size_t max_lanes{1};  // MIXED_MATMUL_PAR_MAX
+    size_t min_n{128};    // MIXED_MATMUL_PAR_MIN_N
+    std::atomic<size_t> queued{0};  // accepted connections not yet picked up by a worker
+    std::atomic<size_t> active{0};  // requests inside run_matmul_iters_inline
+    std::atomic<uint64_t> parallel_products{0};
+    std::atomic<uint64_t> lanes_total{0};  // sum of lanes over parallel products
+    std::atomic<uint64_t> helped_panels{0};
+};
 
-    const size_t n = cfg.n;
-    const size_t bs = cfg.bs;
-    for (size_t i0 = 0; i0 < n; i0 += bs) {
-        const size_t i_max = std::min(i0 + bs, n);
-        for (size_t j0 = 0; j0 < n; j0 += bs) {
-            const size_t j_max = std::min(j0 + bs, n);
-            for (size_t k0 = 0; k0 < n; k0 += bs) {
-                const size_t k_max = std::min(k0 + bs, n);
-                for (size_t i = i0; i < i_max; ++i) {
-                    for (size_t k = k0; k < k_max; ++k) {
-                        const double aik = cfg.a[ridx(n, i, k)];
-                        const size_t b_row = ridx(n, k, 0);
-                        for (size_t j = j0; j < j_max; ++j) {
-                            c[ridx(n, i, j)] += aik * cfg.b[b_row + j];
-                        }
-                    }
-                }
-            }
-        }
+static ParState& par_state() {
+    static ParState s;
+    return s;
+}
+
+static void init_intra_request_par(ThreadPool& pool, size_t workers) {
+    ParState& ps = par_state();
+    ps.pool = &pool;
+    ps.workers = std::max<size_t>(workers, 1);
+    ps.max_lanes = parse_env_size_t("MIXED_MATMUL_PAR_MAX", ps.workers);
+    ps.min_n = parse_env_size_t("MIXED_MATMUL_PAR_MIN_N", 128);
+}
+
+static size_t choose_lanes(const MatmulConfig& cfg) {
+    const ParState& ps = par_state();
+    if (ps.pool == nullptr || ps.max_lanes <= 1 || cfg.n < ps.min_n) return 1;
+    if (ps.queued.load(std::memory_order_relaxed) != 0) return 1;
+    const size_t active = std::max<size_t>(ps.active.load(std::memory_order_relaxed), 1);
+    const size_t panels = (cfg.n + cfg.bs - 1) / cfg.bs;
+    return std::clamp<size_t>(ps.workers / active, 1, std::min(ps.max_lanes, panels));
+}
+
+static void matmul_once(const MatmulConfig& cfg, matmul::Matrix& c) {
+    if (const size_t lanes = choose_lanes(cfg); lanes > 1) {
+        ParState& ps = par_state();
+        const size_t helped = matmul::run_tasks_nested(
+            *ps.pool, (cfg.n + cfg.bs - 1) / cfg.bs, lanes, [&](size_t p) {
+                matmul_panel(*cfg.kernel, cfg.n, cfg.bs, cfg.a, cfg.b, c, cfg.scratch, p * cfg.bs);
+            });
+        ps.parallel_products.fetch_add(1, std::memory_order_relaxed);
+        ps.lanes_total.fetch_add(lanes, std::memory_order_relaxed);
+        ps.helped_panels.fetch_add(helped, std::memory_order_relaxed);
+        return;
     }
+    if (cfg.fixed != nullptr) {
+        cfg.fixed(cfg.a.data(), cfg.b.data(), c.data());
+        return;
+    }
+    matmul_blocked(*cfg.kernel, cfg.n, cfg.bs, cfg.a, cfg.b, c, cfg.scratch);
 }
 
-static double checksum_sparse(const std::vector<double>& c) {
+static double checksum_sparse(const matmul::Matrix& c) {
     double s = 0.0;
-    const size_t step = std::max<size_t>(1, c.size() / 32);
-    for (size_t i = 0; i < c.size(); i += step) {
-        s += c[i];
+    const size_t size = c.rows() * c.cols();
+    const size_t step = std::max<size_t>(1, size / 32);
+    for (size_t i = 0; i < size; i += step) {
+        s += c(i / c.cols(), i % c.cols());
     }
     return s;
 }
 
-static double run_matmul_iters(int iters) {
+// Sampled verification is off unless MIXED_MATMUL_VERIFY_EVERY is set. Every
+// Nth product, counted across requests, is checked with Freivalds' test on
+// the worker that computed it; the O(N^2) check runs serially there and its
+// cost is reported in /metrics.
+struct VerifyStats {
+    std::atomic<uint64_t> products{0};
+    std::atomic<uint64_t> checked{0};
+    std::atomic<uint64_t> failed{0};
+    std::atomic<uint64_t> ns{0};
+};
+
+static VerifyStats& verify_stats() {
+    static VerifyStats s;
+    return s;
+}
+
+static size_t verify_every() {
+    static const size_t every = parse_env_size_t("MIXED_MATMUL_VERIFY_EVERY", 0);
+    return every;
+}
+
+static void verify_sampled(const double* c, size_t ldc) {
+    const size_t every = verify_every();
+    if (every == 0) return;
+    VerifyStats& st = verify_stats();
+    const uint64_t seq = st.products.fetch_add(1, std::memory_order_relaxed);
+    if (seq % every != 0) return;
+
+    const MatmulConfig& cfg = matmul_config();
+    const auto serial = [](size_t count, const auto& fn) {
+        for (size_t t = 0; t < count; ++t) fn(t);
+    };
+    const matmul::VerifyResult res = matmul::freivalds_verify(
+        serial, matmul::Trans::No, matmul::Trans::No, cfg.n, cfg.n, cfg.n,
+        cfg.a.data(), cfg.a.ld(), cfg.b.data(), cfg.b.ld(), c, ldc, seq);
+    st.checked.fetch_add(1, std::memory_order_relaxed);
+    st.ns.fetch_add((uint64_t)(res.seconds * 1e9), std::memory_order_relaxed);
+    if (!res.ok) {
+        st.failed.fetch_add(1, std::memory_order_relaxed);
+        std::cerr << "verify: product " << seq << " failed: " << res.bad_rows << " of " << cfg.n
+                  << " rows differ (max error " << res.max_error << "x tolerance)\n";
+    }
+}
+
+// Batch products are lane-interleaved, so a sampled one is copied out first.
+static void verify_sampled(const matmul::BatchView& v) {
+    if (verify_every() == 0) return;
+    thread_local std::vector<double> c;
+    c.resize(v.n * v.n);
+    for (size_t i = 0; i < v.n; ++i) {
+        for (size_t j = 0; j < v.n; ++j) c[i * v.n + j] = v.at(i, j);
+    }
+    verify_sampled(c.data(), v.n);
+}
+
+// Inline-path counters for /metrics. result_allocs counts result matrices
+// allocated: one per request with MIXED_MATMUL_SCRATCH=0, one per worker
+// thread otherwise.
+struct InlineStats {
+    std::atomic<uint64_t> result_allocs{0};
+    std::atomic<uint64_t> iters{0};
+    std::atomic<uint64_t> ns{0};
+};
+
+static InlineStats& inline_stats() {
+    static InlineStats s;
+    return s;
+}
+
+// The result buffer lives as long as the worker thread, so back-to-back
+// requests on a worker write into lines that are still in its L1/L2.
+static matmul::Matrix& result_scratch(size_t n) {
+    thread_local matmul::Matrix c;
+    if (c.rows() != n) {
+        c = make_matrix(n);
+        inline_stats().result_allocs.fetch_add(1, std::memory_order_relaxed);
+    }
+    return c;
+}
+
+static double run_matmul_iters_inline(int iters) {
     if (iters <= 0) return 0.0;
     const MatmulConfig& cfg = matmul_config();
-    std::vector<double> c(cfg.n * cfg.n);
+    InlineStats& st = inline_stats();
+    const auto t0 = Clock::now();
+    matmul::Matrix fresh;
+    if (!cfg.scratch) {
+        fresh = make_matrix(cfg.n);
+        st.result_allocs.fetch_add(1, std::memory_order_relaxed);
+    }
+    matmul::Matrix& c = cfg.scratch ? result_scratch(cfg.n) : fresh;
+    std::atomic<size_t>& active = par_state().active;
+    active.fetch_add(1, std::memory_order_relaxed);
     double checksum = 0.0;
     for (int i = 0; i < iters; ++i) {
         matmul_once(cfg, c);
+        verify_sampled(c.data(), c.ld());
         checksum += checksum_sparse(c);
     }
+    active.fetch_sub(1, std::memory_order_relaxed);
+    st.iters.fetch_add((uint64_t)iters, std::memory_order_relaxed);
+    st.ns.fetch_add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count(),
+                    std::memory_order_relaxed);
     return checksum;
 }
 
+// Same sample positions as checksum_sparse, read from one product of a batch.
+static double checksum_sparse(const matmul::BatchView& v) {
+    double s = 0.0;
+    const size_t size = v.n * v.n;
+    const size_t step = std::max<size_t>(1, size / 32);
+    for (size_t i = 0; i < size; i += step) {
+        s += v.at(i / v.n, i % v.n);
+    }
+    return s;
+}
+
+// Cross-request batching is off unless MIXED_MATMUL_BATCH_US is set, and it
+// stays off for N above MIXED_MATMUL_BATCH_MAX_N (default 32): from there on
+// the per-request kernels are faster than the lane-interleaved one. Every
+// request multiplies the same operands, so a batch is simply the iterations
+// that arrive within the window, whichever requests they belong to. Lane
+// groups run as tasks on the server's pool.
+static std::unique_ptr<matmul::BatchedMatmul>& batch_engine_slot() {
+    static std::unique_ptr<matmul::BatchedMatmul> engine;
+    return engine;
+}
+
+static matmul::BatchedMatmul* batch_engine() {
+    return batch_engine_slot().get();
+}
+
+static void init_batch_engine(ThreadPool& pool) {
+    const char* raw = std::getenv("MIXED_MATMUL_BATCH_US");
+    if (raw == nullptr || *raw == '\0') return;
+    const MatmulConfig& cfg = matmul_config();
+    if (cfg.n > parse_env_size_t("MIXED_MATMUL_BATCH_MAX_N", 32)) return;
+    const size_t window_us = parse_env_size_t("MIXED_MATMUL_BATCH_US", 200);
+    const size_t max_batch = parse_env_size_t("MIXED_MATMUL_BATCH_MAX", 32);
+    batch_engine_slot() = std::make_unique<matmul::BatchedMatmul>(
+        cfg.n, std::chrono::microseconds(window_us), max_batch, cfg.a.ld(),
+        [&pool](std::function<void()> fn) { pool.submit(std::move(fn)); });
+}
+
+// Completion state for one request's iterations inside the batch engine.
+struct BatchWait {
+    std::mutex m;
+    size_t remaining;
+    double checksum{0.0};
+
+    explicit BatchWait(size_t count) : remaining(count) {}
+
+    // Returns true for the last iteration. The state is not touched after
+    // the lock is released, so a waiter that sees remaining == 0 may destroy it.
+    bool complete(const matmul::BatchView& v) {
+        const double s = checksum_sparse(v);
+        verify_sampled(v);
+        std::lock_guard<std::mutex> lk(m);
+        checksum += s;
+        return --remaining == 0;
+    }
+
+    bool finished() {
+        std::lock_guard<std::mutex> lk(m);
+        return remaining == 0;
+    }
+};
+
+static double run_matmul_iters_batched(matmul::BatchedMatmul& engine, int iters) {
+    const MatmulConfig& cfg = matmul_config();
+    BatchWait wait((size_t)iters);
+    engine.submit(cfg.a.data(), cfg.b.data(), (size_t)iters,
+                  [&wait](const matmul::BatchView& v) { (void)wait.complete(v); });
+    // The worker computes queued lane groups while it waits instead of
+    // sleeping, so batches finish even when every worker is in here.
+    engine.help_until([&] { return wait.finished(); });
+    return wait.checksum;
+}
+
+// co_await form of run_matmul_iters: the coroutine is suspended while its
+// iterations wait for a batch and resumed on the pool by the last one.
+struct MatmulItersAwaiter {
+    int iters;
+    coro::PoolScheduler sched;
+    std::unique_ptr<BatchWait> wait;
+    double checksum{0.0};
+
+    bool await_ready() {
+        matmul::BatchedMatmul* engine = batch_engine();
+        if (iters <= 0 || engine == nullptr) {
+            checksum = iters > 0 ? run_matmul_iters_inline(iters) : 0.0;
+            return true;
+        }
+        wait = std::make_unique<BatchWait>((size_t)iters);
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> h) {
+        const MatmulConfig& cfg = matmul_config();
+        BatchWait* w = wait.get();
+        // The awaiter may be gone as soon as the coroutine is posted, so
+        // nothing below touches it after submit().
+        batch_engine()->submit(cfg.a.data(), cfg.b.data(), (size_t)iters,
+                               [w, sched = sched, h](const matmul::BatchView& v) {
+                                   if (w->complete(v)) sched.post(h);
+                               });
+    }
+
+    double await_resume() { return wait ? wait->checksum : checksum; }
+};
+
+static double run_matmul_iters(int iters) {
+    if (iters <= 0) return 0.0;
+    if (matmul::BatchedMatmul* engine = batch_engine()) {
+        return run_matmul_iters_batched(*engine, iters);
+    }
+    return run_matmul_iters_inline(iters);
+}
+
+static MatmulItersAwaiter matmul_iters_async(int iters, coro::PoolScheduler sched) {
+    return MatmulItersAwaiter{iters, sched, nullptr};
+}
+
+struct ServerMetrics {
+    std::atomic<uint64_t> requests_total{0};
+    std::atomic<uint64_t> work_requests_total{0};
+};
+
+static ServerMetrics& server_metrics() {
+    static ServerMetrics m;
+    return m;
+}
+
+static std::string build_metrics_body() {
+    const ServerMetrics& m = server_metrics();
+    const cpu::Dispatch& d = cpu::dispatch();
+    const MatmulConfig& cfg = matmul_config();
+    std::ostringstream body;
+    body << "{";
+    body << "\"endpoint\":\"/metrics\",";
+    body << "\"isa\":\"" << cpu::isa_name(d.isa) << "\",";
+    body << "\"isa_best\":\"" << cpu::isa_name(d.best) << "\",";
+    body << "\"isa_forced\":" << (d.forced ? "true" : "false") << ',';
+    body << "\"kernel\":\"" << cfg.kernel->name << "\",";
+    body << "\"matrix_n\":" << cfg.n << ',';
+    body << "\"block_size\":" << cfg.bs << ',';
+    body << "\"block_size_source\":\"" << cfg.bs_source << "\",";
+    body << "\"pages\":\"" << matmul::describe_pages(cfg.a) << "\",";
+    body << "\"specialized\":" << (cfg.fixed != nullptr ? "true" : "false") << ',';
+    if (const matmul::BatchedMatmul* engine = batch_engine()) {
+        const matmul::BatchedMatmul::Stats st = engine->stats();
+        body << "\"batch_window_us\":" << engine->window().count() << ',';
+        body << "\"batch_max\":" << engine->max_batch() << ',';
+        body << "\"batches_total\":" << st.batches << ',';
+        body << "\"batched_iters_total\":" << st.items << ',';
+    }
+    if (const size_t every = verify_every(); every != 0) {
+        const VerifyStats& vs = verify_stats();
+        body << "\"verify_every\":" << every << ',';
+        body << "\"verified_total\":" << vs.checked.load(std::memory_order_relaxed) << ',';
+        body << "\"verify_failures_total\":" << vs.failed.load(std::memory_order_relaxed) << ',';
+        body << "\"verify_seconds_total\":" << vs.ns.load(std::memory_order_relaxed) * 1e-9 << ',';
+    }
+    {
+        const InlineStats& is = inline_stats();
+        const uint64_t iters = is.iters.load(std::memory_order_relaxed);
+        const double seconds = is.ns.load(std::memory_order_relaxed) * 1e-9;
+        body << "\"scratch\":" << (cfg.scratch ? "true" : "false") << ',';
+        body << "\"result_allocs_total\":" << is.result_allocs.load(std::memory_order_relaxed) << ',';
+        body << "\"matmul_iters_total\":" << iters << ',';
+        body << "\"matmul_seconds_total\":" << seconds << ',';
+        body << "\"matmul_iters_per_second\":" << (seconds > 0.0 ? iters / seconds : 0.0) << ',';
+    }
+    {
+        const ParState& ps = par_state();
+        const uint64_t products = ps.parallel_products.load(std::memory_order_relaxed);
+        const uint64_t lanes = ps.lanes_total.load(std::memory_order_relaxed);
+        body << "\"par_max\":" << ps.max_lanes << ',';
+        body << "\"par_min_n\":" << ps.min_n << ',';
+        body << "\"parallel_products_total\":" << products << ',';
+        body << "\"parallel_mean_lanes\":" << (products > 0 ? (double)lanes / products : 0.0) << ',';
+        body << "\"helped_panels_total\":" << ps.helped_panels.load(std::memory_order_relaxed) << ',';
+    }
+    body << "\"requests_total\":" << m.requests_total.load(std::memory_order_relaxed) << ',';
+    body << "\"work_requests_total\":" << m.work_requests_total.load(std::memory_order_relaxed);
+    body << "}\n";
+    return body.str();
+}
+
 static std::optional<int> parse_int(std::string_view s) {
     if (s.empty()) return std::nullopt;
     int sign = 1;
@@ -263,6 +718,7 @@ static std::string build_work_body(int cpu1_iters, int io_us, int cpu2_iters) {
     body << "\"cpu2_iters\":" << cpu2_iters << ',';
     body << "\"matrix_n\":" << cfg.n << ',';
     body << "\"block_size\":" << cfg.bs << ',';
+    body << "\"kernel\":\"" << cfg.kernel->name << "\",";
     body << "\"checksum\":" << (checksum1 + checksum2) << ',';
     body << "\"total_us\":" << total_us;
     body << "}\n";
@@ -270,6 +726,7 @@ static std::string build_work_body(int cpu1_iters, int io_us, int cpu2_iters) {
 }
 
 static void handle_connection(int client_fd) {
+    par_state().queued.fetch_sub(1, std::memory_order_relaxed);
     std::string req;
     if (!read_until_headers_end(client_fd, req)) {
         ::close(client_fd);
@@ -291,6 +748,14 @@ static void handle_connection(int client_fd) {
         return;
     }
 
+    server_metrics().requests_total.fetch_add(1, std::memory_order_relaxed);
+    if (target == "/metrics") {
+        auto resp = make_http_response(200, "application/json", build_metrics_body());
+        (void)send_all(client_fd, resp.data(), resp.size());
+        ::close(client_fd);
+        return;
+    }
+
     const bool is_work = (target.rfind("/work", 0) == 0);
     if (!is_work) {
         auto resp = make_http_response(
@@ -302,6 +767,8 @@ static void handle_connection(int client_fd) {
         return;
     }
 
+    server_metrics().work_requests_total.fetch_add(1, std::memory_order_relaxed);
+
     int cpu1_iters = get_q_int(target, "cpu1", 2);
     int io_us = get_q_int(target, "io", 5000);
     int cpu2_iters = get_q_int(target, "cpu2", 2);
@@ -314,6 +781,7 @@ static void handle_connection(int client_fd) {
 
 static coro::DetachedTask handle_connection_coro(int client_fd, coro::PoolScheduler sched) {
     co_await sched.schedule();
+    par_state().queued.fetch_sub(1, std::memory_order_relaxed);
     try {
         std::string req;
         if (!read_until_headers_end(client_fd, req)) {
@@ -336,6 +804,14 @@ static coro::DetachedTask handle_connection_coro(int client_fd, coro::PoolSchedu
             co_return;
         }
 
+        server_metrics().requests_total.fetch_add(1, std::memory_order_relaxed);
+        if (target == "/metrics") {
+            auto resp = make_http_response(200, "application/json", build_metrics_body());
+            (void)send_all(client_fd, resp.data(), resp.size());
+            ::close(client_fd);
+            co_return;
+        }
+
         const bool is_work = (target.rfind("/work", 0) == 0);
         if (!is_work) {
             auto resp = make_http_response(
@@ -347,16 +823,18 @@ static coro::DetachedTask handle_connection_coro(int client_fd, coro::PoolSchedu
             co_return;
         }
 
+        server_metrics().work_requests_total.fetch_add(1, std::memory_order_relaxed);
+
         int cpu1_iters = get_q_int(target, "cpu1", 2);
         int io_us = get_q_int(target, "io", 5000);
         int cpu2_iters = get_q_int(target, "cpu2", 2);
 
         const uint64_t t0 = now_ns();
-        const double checksum1 = run_matmul_iters(cpu1_iters);
+        const double checksum1 = co_await matmul_iters_async(cpu1_iters, sched);
         if (io_us > 0) {
             co_await coro::sleep_for(std::chrono::microseconds(io_us), sched);
         }
-        const double checksum2 = run_matmul_iters(cpu2_iters);
+        const double checksum2 = co_await matmul_iters_async(cpu2_iters, sched);
         const uint64_t total_us = (now_ns() - t0) / 1000ull;
 
         const MatmulConfig& cfg = matmul_config();
@@ -368,6 +846,7 @@ static coro::DetachedTask handle_connection_coro(int client_fd, coro::PoolSchedu
         body << "\"cpu2_iters\":" << cpu2_iters << ',';
         body << "\"matrix_n\":" << cfg.n << ',';
         body << "\"block_size\":" << cfg.bs << ',';
+        body << "\"kernel\":\"" << cfg.kernel->name << "\",";
         body << "\"checksum\":" << (checksum1 + checksum2) << ',';
         body << "\"total_us\":" << total_us;
         body << "}\n";
@@ -461,13 +940,28 @@ int main(int argc, char** argv) {
         const uint16_t port = (uint16_t)std::stoi(argv[2]);
         ThreadPool pool = make_pool_from_args(argc, argv);
         coro::PoolScheduler sched(pool);
+        init_intra_request_par(pool, (size_t)std::stoul(argv[kind == "elastic" || kind == "advws" ? 4 : 3]));
+        init_batch_engine(pool);
 
         int listen_fd = make_listen_socket(port);
         const MatmulConfig& cfg = matmul_config();
         std::cout << "Listening on 0.0.0.0:" << port
                   << " | endpoint: /work?cpu1=2&io=5000&cpu2=2"
                   << " | matrix N=" << cfg.n
-                  << " BS=" << cfg.bs << "\n";
+                  << " BS=" << cfg.bs << " (" << cfg.bs_source << ")"
+                  << " kernel=" << cfg.kernel->name
+                  << (cfg.fixed != nullptr ? " (specialized)" : " (generic)")
+                  << " pages=" << matmul::describe_pages(cfg.a)
+                  << " scratch=" << (cfg.scratch ? "worker" : "per-request");
+        if (const matmul::BatchedMatmul* engine = batch_engine()) {
+            std::cout << " batch_window_us=" << engine->window().count()
+                      << " batch_max=" << engine->max_batch();
+        }
+        if (verify_every() != 0) std::cout << " verify_every=" << verify_every();
+        if (par_state().max_lanes > 1) {
+            std::cout << " par_max=" << par_state().max_lanes << " par_min_n=" << par_state().min_n;
+        }
+        std::cout << " | " << cpu::describe_dispatch() << "\n";
 
         while (true) {
             sockaddr_in client{};
@@ -477,6 +971,7 @@ int main(int argc, char** argv) {
                 continue;
             }
 
+            par_state().queued.fetch_add(1, std::memory_order_relaxed);
             if (kind == "coro") {
                 handle_connection_coro(cfd, sched);
             } else {
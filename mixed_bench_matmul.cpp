@@ -8,7 +8,13 @@ Run:
   ./mixed_bench_matmul 127.0.0.1 8080 2 5000 2 64 10
 
 Args:
-  host port cpu1_iters io_us cpu2_iters concurrency duration_s
+  host port cpu1_iters io_us cpu2_iters concurrency duration_s [rate] [poisson|uniform]
+
+  With a rate (req/s) the client runs open loop (see open_loop_client.h):
+  requests are sent at that arrival rate (Poisson by default) over at most
+  `concurrency` connections, and latency is measured from each request's
+  intended send time, so queueing in the server is not hidden.
+    ./mixed_bench_matmul 127.0.0.1 8080 2 5000 2 64 10 2000 poisson
 
 Notes:
   - cpu1/cpu2 are matrix-multiplication iteration counts on the server side.
@@ -16,6 +22,8 @@ Notes:
     MIXED_MATMUL_BS.
 */
 
+#include "open_loop_client.h"
+
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <netinet/in.h>
@@ -95,9 +103,13 @@ static double pct(std::vector<double> v, double q) {
     return v[i] * (1.0 - frac) + v[j] * frac;
 }
 
+static const char* const kUsage =
+    "Usage: ./mixed_bench_matmul host port cpu1_iters io_us cpu2_iters concurrency duration_s"
+    " [rate] [poisson|uniform]\n";
+
 int main(int argc, char** argv) {
     if (argc < 8) {
-        std::cerr << "Usage: ./mixed_bench_matmul host port cpu1_iters io_us cpu2_iters concurrency duration_s\n";
+        std::cerr << kUsage;
         return 2;
     }
 
@@ -119,6 +131,11 @@ int main(int argc, char** argv) {
         "Connection: close\r\n" +
         "\r\n";
 
+    if (argc >= 9) {
+        return loadgen::open_loop_main(argc, argv, host, port, path, req, static_cast<size_t>(conc), duration_s,
+                                       kUsage);
+    }
+
     std::atomic<bool> stop{false};
     std::atomic<uint64_t> ok{0};
     std::atomic<uint64_t> fail{0};
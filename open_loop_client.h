@@ -0,0 +1,396 @@
+#pragma once
+
+// Open-loop HTTP load generator shared by mixed_bench and mixed_bench_matmul.
+//
+// Requests are scheduled at a fixed arrival rate (Poisson or uniform gaps)
+// regardless of how fast responses come back, and latency is measured from
+// each request's intended send time. A closed-loop client (and wrk) only
+// sends when a previous response arrived, so a slow server also slows the
+// load and the queueing delay never shows up in the percentiles
+// ("coordinated omission"). Here a request that could not be sent on time
+// waits in a backlog and its wait counts toward its latency.
+//
+// One thread drives up to max_connections non-blocking connections with
+// epoll; a timerfd armed at the next intended send time wakes the loop, so
+// sends are not quantized to epoll's millisecond timeout. The servers close
+// the connection after each response, so a connection carries one request.
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace loadgen {
+
+using Clock = std::chrono::steady_clock;
+
+enum class Arrivals { Poisson, Uniform };
+
+struct OpenLoopConfig {
+    std::string host;
+    uint16_t port{8080};
+    std::string request;          // full HTTP request bytes
+    double rate{1000.0};          // requests per second
+    Arrivals arrivals{Arrivals::Poisson};
+    size_t max_connections{64};   // requests in flight at most
+    double duration_s{10.0};      // scheduling window
+    double drain_s{10.0};         // extra time for backlog and in-flight requests
+    uint64_t seed{42};
+};
+
+struct OpenLoopResult {
+    uint64_t scheduled{0};
+    uint64_t ok{0};
+    uint64_t fail{0};
+    uint64_t timeout{0};              // still queued or in flight at the drain deadline
+    std::vector<double> corrected_ms; // intended send -> response; timeouts: -> deadline
+    std::vector<double> service_ms;   // actual connect -> response
+    double elapsed_s{0.0};            // scheduling window plus drain
+    double window_s{0.0};             // scheduling window actually used
+    double last_ok_s{0.0};            // start -> last successful response
+    size_t max_backlog{0};
+    double max_send_lag_ms{0.0};      // worst intended -> actual send delay
+};
+
+inline std::optional<Arrivals> parse_arrivals(const std::string& s) {
+    if (s == "poisson") return Arrivals::Poisson;
+    if (s == "uniform") return Arrivals::Uniform;
+    return std::nullopt;
+}
+
+inline const char* arrivals_name(Arrivals a) {
+    return a == Arrivals::Poisson ? "poisson" : "uniform";
+}
+
+// Gap to the next arrival in seconds: exponential for Poisson arrivals.
+inline double next_gap(Arrivals a, double rate, std::mt19937_64& rng) {
+    if (a == Arrivals::Uniform) return 1.0 / rate;
+    std::exponential_distribution<double> exp(rate);
+    return exp(rng);
+}
+
+namespace detail {
+
+struct Conn {
+    int fd{-1};
+    Clock::time_point intended;
+    Clock::time_point started;
+    size_t sent{0};
+    bool connected{false};
+    std::string in;
+};
+
+inline double ms_between(Clock::time_point a, Clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+inline void arm_timer(int tfd, Clock::time_point when) {
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(when.time_since_epoch()).count();
+    itimerspec its{};
+    its.it_value.tv_sec = static_cast<time_t>(std::max<int64_t>(ns, 1) / 1000000000);
+    its.it_value.tv_nsec = static_cast<long>(std::max<int64_t>(ns, 1) % 1000000000);
+    ::timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, nullptr);
+}
+
+}  // namespace detail
+
+// Returns false in `ok_out` only if the host does not resolve or epoll and
+// timerfd cannot be created; connection errors count as failed requests.
+inline OpenLoopResult run_open_loop(const OpenLoopConfig& cfg, bool& ok_out) {
+    using detail::Conn;
+    OpenLoopResult r;
+    ok_out = false;
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (::getaddrinfo(cfg.host.c_str(), std::to_string(cfg.port).c_str(), &hints, &res) != 0 || res == nullptr) {
+        return r;
+    }
+    sockaddr_storage addr{};
+    std::memcpy(&addr, res->ai_addr, res->ai_addrlen);
+    const socklen_t addr_len = res->ai_addrlen;
+    const int family = res->ai_family;
+    ::freeaddrinfo(res);
+
+    const int ep = ::epoll_create1(EPOLL_CLOEXEC);
+    const int tfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (ep < 0 || tfd < 0) {
+        if (ep >= 0) ::close(ep);
+        if (tfd >= 0) ::close(tfd);
+        return r;
+    }
+    ok_out = true;
+    constexpr uint64_t kTimerTag = ~uint64_t{0};
+    epoll_event tev{};
+    tev.events = EPOLLIN;
+    tev.data.u64 = kTimerTag;
+    ::epoll_ctl(ep, EPOLL_CTL_ADD, tfd, &tev);
+
+    const size_t slots = std::max<size_t>(cfg.max_connections, 1);
+    std::vector<Conn> conns(slots);
+    std::vector<size_t> free_slots;
+    for (size_t i = slots; i-- > 0;) free_slots.push_back(i);
+    std::deque<Clock::time_point> backlog;
+
+    std::mt19937_64 rng(cfg.seed);
+    const auto t_start = Clock::now();
+    const auto t_end = t_start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(cfg.duration_s));
+    const auto t_deadline = t_end + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(cfg.drain_s));
+    auto next = t_start;
+    auto gap = [&] {
+        return std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(next_gap(cfg.arrivals, cfg.rate, rng)));
+    };
+
+    auto finish = [&](size_t slot, bool success) {
+        Conn& c = conns[slot];
+        const auto now = Clock::now();
+        ::epoll_ctl(ep, EPOLL_CTL_DEL, c.fd, nullptr);
+        ::close(c.fd);
+        c.fd = -1;
+        if (success) {
+            ++r.ok;
+            r.last_ok_s = std::chrono::duration<double>(now - t_start).count();
+            r.corrected_ms.push_back(detail::ms_between(c.intended, now));
+            r.service_ms.push_back(detail::ms_between(c.started, now));
+        } else {
+            ++r.fail;
+        }
+        free_slots.push_back(slot);
+    };
+
+    auto start = [&](Clock::time_point intended) {
+        const size_t slot = free_slots.back();
+        Conn& c = conns[slot];
+        c = Conn{};
+        c.intended = intended;
+        c.started = Clock::now();
+        r.max_send_lag_ms = std::max(r.max_send_lag_ms, detail::ms_between(intended, c.started));
+        c.fd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (c.fd < 0) {
+            ++r.fail;
+            return;
+        }
+        free_slots.pop_back();
+        if (::connect(c.fd, reinterpret_cast<const sockaddr*>(&addr), addr_len) != 0 && errno != EINPROGRESS) {
+            ::close(c.fd);
+            c.fd = -1;
+            ++r.fail;
+            free_slots.push_back(slot);
+            return;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLOUT;
+        ev.data.u64 = slot;
+        ::epoll_ctl(ep, EPOLL_CTL_ADD, c.fd, &ev);
+    };
+
+    auto on_writable = [&](size_t slot) {
+        Conn& c = conns[slot];
+        if (!c.connected) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (::getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+                finish(slot, false);
+                return;
+            }
+            c.connected = true;
+        }
+        while (c.sent < cfg.request.size()) {
+            const ssize_t n = ::send(c.fd, cfg.request.data() + c.sent, cfg.request.size() - c.sent, MSG_NOSIGNAL);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            if (n <= 0) {
+                finish(slot, false);
+                return;
+            }
+            c.sent += static_cast<size_t>(n);
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = slot;
+        ::epoll_ctl(ep, EPOLL_CTL_MOD, c.fd, &ev);
+    };
+
+    // Success once the response headers are in; the server closes anyway.
+    auto on_readable = [&](size_t slot) {
+        Conn& c = conns[slot];
+        char buf[4096];
+        while (true) {
+            const ssize_t n = ::recv(c.fd, buf, sizeof(buf), 0);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            if (n <= 0) {
+                finish(slot, false);
+                return;
+            }
+            c.in.append(buf, buf + n);
+            if (c.in.find("\r\n\r\n") != std::string::npos) {
+                finish(slot, true);
+                return;
+            }
+            if (c.in.size() > 2 * 1024 * 1024) {
+                finish(slot, false);
+                return;
+            }
+        }
+    };
+
+    std::vector<epoll_event> events(slots + 1);
+    while (true) {
+        const auto now = Clock::now();
+        while (next <= now && next < t_end) {
+            backlog.push_back(next);
+            ++r.scheduled;
+            next += gap();
+        }
+        r.max_backlog = std::max(r.max_backlog, backlog.size());
+        while (!backlog.empty() && !free_slots.empty()) {
+            const auto intended = backlog.front();
+            backlog.pop_front();
+            start(intended);
+        }
+        const bool idle = free_slots.size() == slots && backlog.empty();
+        if ((next >= t_end && idle) || now >= t_deadline) {
+            break;
+        }
+        detail::arm_timer(tfd, next < t_end ? next : t_deadline);
+
+        const int n = ::epoll_wait(ep, events.data(), static_cast<int>(events.size()), -1);
+        if (n < 0 && errno != EINTR) break;
+        for (int i = 0; i < n; ++i) {
+            const uint64_t tag = events[i].data.u64;
+            if (tag == kTimerTag) {
+                uint64_t expirations = 0;
+                (void)!::read(tfd, &expirations, sizeof(expirations));
+                continue;
+            }
+            const size_t slot = static_cast<size_t>(tag);
+            if (conns[slot].fd < 0) continue;
+            if (events[i].events & EPOLLOUT) {
+                on_writable(slot);
+            } else if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                on_readable(slot);
+            }
+        }
+    }
+
+    // Requests still pending at the deadline are the slowest ones; leaving
+    // them out would bring back the omission this client exists to avoid.
+    // They count with their age at the deadline, a lower bound.
+    const auto t_stop = Clock::now();
+    for (const Clock::time_point intended : backlog) {
+        r.corrected_ms.push_back(detail::ms_between(intended, t_stop));
+        ++r.timeout;
+    }
+    for (size_t s = 0; s < slots; ++s) {
+        if (conns[s].fd >= 0) {
+            ::close(conns[s].fd);
+            r.corrected_ms.push_back(detail::ms_between(conns[s].intended, t_stop));
+            ++r.timeout;
+        }
+    }
+    r.elapsed_s = std::chrono::duration<double>(t_stop - t_start).count();
+    r.window_s = std::min(r.elapsed_s, cfg.duration_s);
+    ::close(tfd);
+    ::close(ep);
+    return r;
+}
+
+inline double percentile(std::vector<double> v, double q) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    const double idx = q * static_cast<double>(v.size() - 1);
+    const size_t i = static_cast<size_t>(idx);
+    const size_t j = std::min(i + 1, v.size() - 1);
+    const double frac = idx - static_cast<double>(i);
+    return v[i] * (1.0 - frac) + v[j] * frac;
+}
+
+inline void print_latency(std::ostream& out, const char* label, const std::vector<double>& ms) {
+    if (ms.empty()) return;
+    const double avg = std::accumulate(ms.begin(), ms.end(), 0.0) / static_cast<double>(ms.size());
+    out << label << ": avg=" << avg
+        << " p50=" << percentile(ms, 0.50)
+        << " p90=" << percentile(ms, 0.90)
+        << " p99=" << percentile(ms, 0.99)
+        << " p99.9=" << percentile(ms, 0.999)
+        << " max=" << *std::max_element(ms.begin(), ms.end())
+        << " (n=" << ms.size() << ")\n";
+}
+
+// "Latency ms:" is the corrected distribution, so scripts that read the
+// closed-loop line get the honest numbers in open-loop mode.
+inline void print_report(std::ostream& out, const OpenLoopConfig& cfg, const OpenLoopResult& r) {
+    // Over the time to the last response, not the whole drain: the tail of
+    // an overloaded run is mostly waiting for requests that time out.
+    const double achieved = r.last_ok_s > 0.0 ? static_cast<double>(r.ok) / r.last_ok_s : 0.0;
+    out << "Open loop: rate(req/s)=" << cfg.rate << " arrivals=" << arrivals_name(cfg.arrivals)
+        << " | Connections: " << cfg.max_connections << " | Window(s): " << r.window_s
+        << " | Drain(s): " << r.elapsed_s - r.window_s << "\n";
+    out << "Scheduled: " << r.scheduled << " | OK: " << r.ok << " | Fail: " << r.fail
+        << " | Timeout: " << r.timeout << " | Throughput(req/s): " << achieved << "\n";
+    out << "Max backlog: " << r.max_backlog << " | Max send lag ms: " << r.max_send_lag_ms << "\n";
+    print_latency(out, "Latency ms", r.corrected_ms);
+    if (r.timeout != 0) {
+        out << "  (includes " << r.timeout << " timed out, counted at their age at the deadline)\n";
+    }
+    print_latency(out, "Service ms (uncorrected)", r.service_ms);
+}
+
+// Open-loop mode shared by mixed_bench and mixed_bench_matmul: argv[8] is the
+// rate, argv[9] the optional arrival process. Returns the exit code; bad
+// arguments print usage and return 2.
+inline int open_loop_main(int argc, char** argv, const std::string& host, uint16_t port,
+                          const std::string& path, const std::string& request,
+                          size_t concurrency, double duration_s, const char* usage) {
+    OpenLoopConfig cfg;
+    cfg.host = host;
+    cfg.port = port;
+    cfg.request = request;
+    cfg.max_connections = concurrency;
+    cfg.duration_s = duration_s;
+    const std::string rate_arg = argc >= 9 ? argv[8] : "";
+    bool rate_ok = false;
+    try {
+        size_t used = 0;
+        cfg.rate = std::stod(rate_arg, &used);
+        rate_ok = used == rate_arg.size() && cfg.rate > 0.0 && std::isfinite(cfg.rate);
+    } catch (...) {
+        rate_ok = false;
+    }
+    const std::optional<Arrivals> arrivals = parse_arrivals(argc >= 10 ? argv[9] : "poisson");
+    if (!rate_ok || !arrivals) {
+        std::cerr << "rate must be a number > 0 and arrivals poisson|uniform\n" << usage;
+        return 2;
+    }
+    cfg.arrivals = *arrivals;
+
+    bool started = false;
+    const OpenLoopResult r = run_open_loop(cfg, started);
+    if (!started) {
+        std::cerr << "Cannot resolve " << host << " or set up epoll\n";
+        return 1;
+    }
+    std::cout << "Benchmark: " << host << ":" << port << path << "\n";
+    print_report(std::cout, cfg, r);
+    return 0;
+}
+
+}  // namespace loadgen
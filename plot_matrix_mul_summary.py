@@ -295,6 +295,7 @@ def load_rows(csv_path: Path) -> List[Dict[str, object]]:
                     "exit_code": to_int(r.get("exit_code", "1")),
                     "best_s": to_float(r.get("best_s", "")),
                     "avg_s": to_float(r.get("avg_s", "")),
+                    "order": r.get("order", "") or "row",
                 }
             )
     return rows
@@ -862,6 +863,11 @@ def main() -> None:
         default=4.0,
         help="Rasterization scale factor used for PNG output.",
     )
+    parser.add_argument(
+        "--order",
+        default="row",
+        help="Tile order to plot when the sweep compared several (ORDERS=...).",
+    )
     args = parser.parse_args()
 
     global OUTPUT_MODE, PNG_SCALE, PNG_BACKEND
@@ -872,7 +878,7 @@ def main() -> None:
     outdir = args.outdir if args.outdir is not None else (csv_path.parent / "plots")
     outdir.mkdir(parents=True, exist_ok=True)
 
-    rows_all = load_rows(csv_path)
+    rows_all = [r for r in load_rows(csv_path) if r["order"] == args.order]
     rows = valid_rows(rows_all)
     if not rows:
         raise SystemExit("No valid rows with exit_code=0 and best_s > 0.")
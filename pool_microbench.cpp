@@ -0,0 +1,434 @@
+/*
+Microbenchmarks for the scheduler primitives of every pool kind.
+
+Build:
+g++ -O3 -std=c++20 -pthread pool_microbench.cpp thread_pool.cpp -o pool_microbench
+
+Run:
+./pool_microbench all 4 1 5
+./pool_microbench ws  4 1 5 submit1,steal
+./pool_microbench classic 8 1 10 all 1000000
+
+Args:
+1st: pool kind (classic|elastic|ws|advws|coro|all)
+2nd: threads
+3rd: warmup reps per test
+4th: timed reps per test
+5th optional: comma-separated tests, or "all" (default)
+6th optional: ops per rep for the throughput tests (default 200000)
+
+Tests (all report ns per operation):
+  submit1    empty tasks submitted by one external thread, until all have run
+  submitN    the same from max(2, threads) external producer threads
+  latency    submit-to-start of one task, back to back (worker just went idle)
+  wake       submit-to-start after the pool sat idle for POOL_MICRO_IDLE_US
+             (default 2000 us)
+  steal      a running task submits a child and spins until another worker
+             starts it (work-stealing kinds steal it from the parent's deque;
+             skipped with fewer than 2 threads)
+  handoff    ping-pong between two tasks, each submitting the other
+  resume     one coroutine repeatedly co_await-ing the pool scheduler
+  construct  pool constructor, up to the point it returns
+  teardown   pool destructor after one task has run
+
+In coro mode every submission goes through a coroutine scheduled on a
+classic pool, so it shows the coroutine cost on top of classic. resume runs
+on every kind, since coro::PoolScheduler sits on any ThreadPool.
+
+Throughput tests take one value per rep; latency-style tests (latency, wake,
+steal, construct, teardown) take many samples per rep and report percentiles
+over all of them. BENCH_CSV / BENCH_JSON get one record per mode and test
+(see bench_harness.h).
+*/
+
+#include "bench_harness.h"
+#include "thread_pool.h"
+#include "coro_runtime.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static inline double ns_between(Clock::time_point a, Clock::time_point b) {
+    return std::chrono::duration<double, std::nano>(b - a).count();
+}
+
+// Submission path under test: plain pool.submit, or a coroutine hop onto
+// the pool in coro mode.
+struct Submitter {
+    ThreadPool& pool;
+    bool coro;
+
+    void operator()(std::function<void()> fn) const {
+        if (coro) {
+            bench::spawn_coro_task(coro::PoolScheduler(pool), std::move(fn));
+        } else {
+            pool.submit(std::move(fn));
+        }
+    }
+};
+
+struct MicroConfig {
+    size_t threads{4};
+    int warmup{1};
+    int reps{5};
+    size_t ops{200000};
+    std::chrono::microseconds idle{2000};
+};
+
+// One rep of a latency-style test appends its samples (ns) to `all` and
+// returns their median, which is what the rep-level statistics see.
+static double rep_median(std::vector<double> rep, std::vector<double>& all) {
+    all.insert(all.end(), rep.begin(), rep.end());
+    std::sort(rep.begin(), rep.end());
+    return bench::quantile_sorted(rep, 0.5);
+}
+
+static double submit_one_producer(const Submitter& submit, size_t ops) {
+    coro::DetachedLatch done(ops);
+    const auto t0 = Clock::now();
+    for (size_t i = 0; i < ops; ++i) {
+        submit([&done] { done.count_down(); });
+    }
+    done.wait();
+    return ns_between(t0, Clock::now()) / static_cast<double>(ops);
+}
+
+static double submit_many_producers(const Submitter& submit, size_t ops, size_t producers) {
+    const size_t per = std::max<size_t>(ops / producers, 1);
+    coro::DetachedLatch done(per * producers);
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&] {
+            ready.fetch_add(1, std::memory_order_acq_rel);
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < per; ++i) {
+                submit([&done] { done.count_down(); });
+            }
+        });
+    }
+    while (ready.load(std::memory_order_acquire) != producers) {
+        std::this_thread::yield();
+    }
+    const auto t0 = Clock::now();
+    go.store(true, std::memory_order_release);
+    done.wait();
+    const double ns = ns_between(t0, Clock::now());
+    for (auto& t : threads) {
+        t.join();
+    }
+    return ns / static_cast<double>(per * producers);
+}
+
+// Submit-to-start of single tasks; `gap` idles the pool before each one.
+static std::vector<double> start_latencies(const Submitter& submit, size_t samples, std::chrono::microseconds gap) {
+    std::vector<double> out(samples);
+    for (size_t i = 0; i < samples; ++i) {
+        if (gap.count() > 0) {
+            std::this_thread::sleep_for(gap);
+        }
+        coro::DetachedLatch started(1);
+        Clock::time_point start;
+        const auto t0 = Clock::now();
+        submit([&] {
+            start = Clock::now();
+            started.count_down();
+        });
+        started.wait();
+        out[i] = ns_between(t0, start);
+    }
+    return out;
+}
+
+// The parent keeps its worker busy, so the child has to be picked up by
+// another one. The spin yields so this also completes on a single CPU.
+static std::vector<double> steal_latencies(const Submitter& submit, size_t samples) {
+    std::vector<double> out(samples);
+    for (size_t i = 0; i < samples; ++i) {
+        coro::DetachedLatch done(1);
+        submit([&, i] {
+            std::atomic<bool> started{false};
+            Clock::time_point start;
+            const auto t0 = Clock::now();
+            submit([&] {
+                start = Clock::now();
+                started.store(true, std::memory_order_release);
+            });
+            while (!started.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            out[i] = ns_between(t0, start);
+            done.count_down();
+        });
+        done.wait();
+    }
+    return out;
+}
+
+struct Handoff {
+    Submitter submit;
+    size_t remaining;
+    coro::DetachedLatch done{1};
+
+    void hop(int side) {
+        if (--remaining == 0) {
+            done.count_down();
+            return;
+        }
+        submit([this, side] { hop(1 - side); });
+    }
+};
+
+static double handoff(const Submitter& submit, size_t ops) {
+    Handoff h{submit, ops};
+    const auto t0 = Clock::now();
+    submit([&h] { h.hop(0); });
+    h.done.wait();
+    return ns_between(t0, Clock::now()) / static_cast<double>(ops);
+}
+
+static coro::DetachedTask resume_loop(coro::PoolScheduler sched, size_t ops, coro::DetachedLatch& done) {
+    for (size_t i = 0; i < ops; ++i) {
+        co_await sched.schedule();
+    }
+    done.count_down();
+}
+
+static double coroutine_resume(ThreadPool& pool, size_t ops) {
+    coro::DetachedLatch done(1);
+    const auto t0 = Clock::now();
+    resume_loop(coro::PoolScheduler(pool), ops, done);
+    done.wait();
+    return ns_between(t0, Clock::now()) / static_cast<double>(ops);
+}
+
+struct Lifecycle {
+    double construct_ns;
+    double teardown_ns;
+};
+
+static Lifecycle pool_lifecycle(const std::string& mode, size_t threads) {
+    Clock::time_point t1, t2;
+    const auto t0 = Clock::now();
+    bench::with_pool(mode, threads, [&](ThreadPool& pool) {
+        t1 = Clock::now();
+        coro::DetachedLatch ran(1);
+        pool.submit([&ran] { ran.count_down(); });
+        ran.wait();
+        t2 = Clock::now();
+    });
+    return {ns_between(t0, t1), ns_between(t2, Clock::now())};
+}
+
+static const std::vector<std::string>& all_tests() {
+    static const std::vector<std::string> tests = {"submit1", "submitN", "latency", "wake", "steal",
+                                                   "handoff", "resume", "construct", "teardown"};
+    return tests;
+}
+
+static void print_header() {
+    std::cout << std::left << std::setw(8) << "mode" << std::setw(10) << "test" << std::right
+              << std::setw(12) << "median" << std::setw(12) << "p5" << std::setw(12) << "p95"
+              << std::setw(12) << "p99" << std::setw(12) << "mad" << std::setw(9) << "n"
+              << "   (ns/op; n = reps, or samples for latency-style tests)\n";
+}
+
+// Prints one row from per-op values (ns) and records the per-rep values.
+static bool report_row(const std::string& mode, const std::string& test, const MicroConfig& cfg,
+                       const std::vector<double>& values, bench::Samples reps_ns) {
+    std::vector<double> sorted = values;
+    std::sort(sorted.begin(), sorted.end());
+    const bench::Stats st = bench::summarize(values);
+    const double p99 = bench::quantile_sorted(sorted, 0.99);
+    std::cout << std::left << std::setw(8) << mode << std::setw(10) << test << std::right << std::fixed
+              << std::setprecision(1) << std::setw(12) << st.median << std::setw(12) << st.p5 << std::setw(12)
+              << st.p95 << std::setw(12) << p99 << std::setw(12) << st.mad << std::setw(9) << st.n << "\n"
+              << std::defaultfloat;
+
+    // Records carry seconds per op like every other harness record.
+    for (double& r : reps_ns.runs) r *= 1e-9;
+    bench::Report report("pool_micro", mode, cfg.threads);
+    report.param("test", test).param("ops", cfg.ops);
+    report.metric("median_ns", st.median)
+        .metric("p5_ns", st.p5)
+        .metric("p95_ns", st.p95)
+        .metric("p99_ns", p99)
+        .metric("max_ns", st.worst)
+        .metric("samples", st.n);
+    return report.write(reps_ns);
+}
+
+static bool run_mode(const std::string& mode, const MicroConfig& cfg, const std::vector<std::string>& tests) {
+    const bench::RepeatOptions opt = bench::repeat_options(cfg.warmup, cfg.reps);
+    std::ostringstream quiet;  // the per-rep "Run i:" lines
+    bool ok = true;
+    auto wants = [&](const std::string& t) { return std::find(tests.begin(), tests.end(), t) != tests.end(); };
+
+    bench::with_pool(mode, cfg.threads, [&](ThreadPool& pool) {
+        const Submitter submit{pool, mode == "coro"};
+        auto throughput = [&](const std::string& test, auto&& once) {
+            const bench::Samples s = bench::repeat(opt, once, quiet);
+            ok = report_row(mode, test, cfg, s.runs, s) && ok;
+        };
+        auto latency = [&](const std::string& test, auto&& samples_fn) {
+            std::vector<double> all;
+            const bench::Samples s = bench::repeat(opt, [&](int rep) {
+                std::vector<double> v = samples_fn();
+                if (rep < 0) return 0.0;
+                return rep_median(std::move(v), all);
+            }, quiet);
+            ok = report_row(mode, test, cfg, all, s) && ok;
+        };
+
+        if (wants("submit1")) {
+            throughput("submit1", [&] { return submit_one_producer(submit, cfg.ops); });
+        }
+        if (wants("submitN")) {
+            const size_t producers = std::max<size_t>(cfg.threads, 2);
+            throughput("submitN", [&] { return submit_many_producers(submit, cfg.ops, producers); });
+        }
+        if (wants("latency")) {
+            latency("latency", [&] { return start_latencies(submit, std::max<size_t>(cfg.ops / 100, 10), {}); });
+        }
+        if (wants("wake")) {
+            latency("wake", [&] { return start_latencies(submit, std::max<size_t>(cfg.ops / 1000, 10), cfg.idle); });
+        }
+        if (wants("steal")) {
+            if (cfg.threads < 2) {
+                std::cout << std::left << std::setw(8) << mode << std::setw(10) << "steal"
+                          << "  skipped (needs threads >= 2)\n";
+            } else {
+                latency("steal", [&] { return steal_latencies(submit, std::max<size_t>(cfg.ops / 100, 10)); });
+            }
+        }
+        if (wants("handoff")) {
+            throughput("handoff", [&] { return handoff(submit, cfg.ops); });
+        }
+        if (wants("resume")) {
+            throughput("resume", [&] { return coroutine_resume(pool, cfg.ops); });
+        }
+    });
+
+    if (wants("construct") || wants("teardown")) {
+        std::vector<double> construct_all, teardown_all;
+        const size_t cycles = std::max<size_t>(cfg.ops / 4000, 5);
+        bench::Samples teardown_reps;
+        const bench::Samples construct_reps = bench::repeat(opt, [&](int rep) {
+            std::vector<double> c, t;
+            for (size_t i = 0; i < cycles; ++i) {
+                const Lifecycle l = pool_lifecycle(mode, cfg.threads);
+                c.push_back(l.construct_ns);
+                t.push_back(l.teardown_ns);
+            }
+            if (rep < 0) return 0.0;
+            teardown_reps.runs.push_back(rep_median(std::move(t), teardown_all));
+            return rep_median(std::move(c), construct_all);
+        }, quiet);
+        teardown_reps.warmup = construct_reps.warmup;
+        teardown_reps.stop = construct_reps.stop;
+        if (wants("construct")) ok = report_row(mode, "construct", cfg, construct_all, construct_reps) && ok;
+        if (wants("teardown")) ok = report_row(mode, "teardown", cfg, teardown_all, teardown_reps) && ok;
+    }
+    return ok;
+}
+
+static std::vector<std::string> split_tests(const std::string& arg) {
+    if (arg == "all") {
+        return all_tests();
+    }
+    std::vector<std::string> out;
+    std::stringstream ss(arg);
+    std::string t;
+    while (std::getline(ss, t, ',')) {
+        if (!t.empty()) out.push_back(t);
+    }
+    return out;
+}
+
+static void usage(const char* prog) {
+    std::cerr
+        << "Usage:\n  " << prog
+        << " <pool: classic|elastic|ws|advws|coro|all> <threads> <warmup> <reps> [tests|all] [ops]\n\n"
+        << "Tests: submit1 submitN latency wake steal handoff resume construct teardown\n"
+        << "Env:   POOL_MICRO_IDLE_US (idle gap before each wake sample, default 2000),\n"
+        << "       BENCH_CI / BENCH_MAX_REPS / BENCH_CSV / BENCH_JSON (see bench_harness.h)\n\n"
+        << "Examples:\n"
+        << "  " << prog << " all     4 1 5\n"
+        << "  " << prog << " ws      4 1 5 submit1,steal\n"
+        << "  " << prog << " classic 8 1 10 all 1000000\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 5) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        const std::string mode_arg = argv[1];
+        MicroConfig cfg;
+        cfg.threads = std::stoul(argv[2]);
+        cfg.warmup = std::stoi(argv[3]);
+        cfg.reps = std::stoi(argv[4]);
+        const std::vector<std::string> tests = split_tests((argc >= 6) ? argv[5] : "all");
+        if (argc >= 7) {
+            cfg.ops = std::stoul(argv[6]);
+        }
+        cfg.idle = std::chrono::microseconds(
+            static_cast<int64_t>(bench::env_double("POOL_MICRO_IDLE_US", 2000.0)));
+
+        if (cfg.threads == 0 || cfg.ops == 0 || cfg.reps <= 0 || cfg.warmup < 0) {
+            std::cerr << "Invalid args: threads/ops must be > 0, reps > 0, warmup >= 0\n";
+            return 1;
+        }
+        for (const auto& t : tests) {
+            if (std::find(all_tests().begin(), all_tests().end(), t) == all_tests().end()) {
+                std::cerr << "Unknown test: " << t << "\n";
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        const std::vector<std::string> modes =
+            mode_arg == "all" ? std::vector<std::string>{"classic", "ws", "elastic", "advws", "coro"}
+                              : std::vector<std::string>{mode_arg};
+        if (mode_arg != "all" && !bench::is_mode(mode_arg)) {
+            std::cerr << "Unknown pool kind: " << mode_arg << "\n";
+            usage(argv[0]);
+            return 1;
+        }
+
+        std::cout << "Pool microbenchmarks\n"
+                  << "threads=" << cfg.threads
+                  << " warmup=" << cfg.warmup
+                  << " reps=" << cfg.reps
+                  << " ops=" << cfg.ops
+                  << " idle_us=" << cfg.idle.count() << "\n";
+        print_header();
+        bool ok = true;
+        for (const auto& mode : modes) {
+            ok = run_mode(mode, cfg, tests) && ok;
+        }
+        return ok ? 0 : 1;
+    } catch (const std::exception& ex) {
+        std::cerr << "Argument parse error: " << ex.what() << "\n";
+        usage(argv[0]);
+        return 1;
+    }
+}
@@ -310,9 +310,14 @@ void write_csv_row(std::ofstream& out, const std::vector<std::string>& fields) {
 
 struct BenchParsed {
     std::string run_times = "NA";
+    std::string reps = "NA";
+    std::string stop = "NA";
+    std::string p5 = "NA";
     std::string p50 = "NA";
     std::string p95 = "NA";
     std::string p99 = "NA";
+    std::string mad = "NA";
+    std::string ci95 = "NA";
     std::string best = "NA";
     std::string avg = "NA";
     std::string checksum = "NA";
@@ -322,68 +327,91 @@ struct BenchParsed {
     std::vector<double> runs;
 };
 
-BenchParsed parse_bench_output(const fs::path& p) {
-    BenchParsed b;
-    const std::regex re_run(R"(^Run [0-9]+:\s+([^\s]+))");
-    const std::regex re_best(R"(^Best:\s+([^\s]+))");
-    const std::regex re_avg(R"(^Avg :\s+([^\s]+))");
-    const std::regex re_checksum(R"(^Checksum:\s+([^\s]+))");
-    const std::regex re_expected(R"(^Expected checksum:\s+([^\s]+))");
-    const std::regex re_fib(R"(^Fib\([0-9]+\):\s+([^\s]+))");
-    const std::regex re_spawned(R"(^Spawned internal nodes:\s+([^\s]+))");
-
-    std::smatch m;
-    std::vector<std::string> run_s;
-
-    for (const auto& line : read_lines(p)) {
-        if (std::regex_search(line, m, re_run)) {
-            const std::string v = m[1];
-            run_s.push_back(v);
-            if (auto d = parse_double(v)) {
-                b.runs.push_back(*d);
+std::vector<std::string> parse_csv_line(const std::string& line) {
+    std::vector<std::string> fields;
+    std::string cur;
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        const char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                cur.push_back('"');
+                ++i;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                cur.push_back(c);
             }
-            continue;
-        }
-        if (std::regex_search(line, m, re_best)) {
-            b.best = m[1];
-            continue;
-        }
-        if (std::regex_search(line, m, re_avg)) {
-            b.avg = m[1];
-            continue;
-        }
-        if (std::regex_search(line, m, re_checksum)) {
-            b.checksum = m[1];
-            continue;
-        }
-        if (std::regex_search(line, m, re_expected)) {
-            b.expected_checksum = m[1];
-            continue;
-        }
-        if (std::regex_search(line, m, re_fib)) {
-            b.fib_value = m[1];
-            continue;
-        }
-        if (std::regex_search(line, m, re_spawned)) {
-            b.spawned_internal_nodes = m[1];
-            continue;
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.push_back(cur);
+            cur.clear();
+        } else {
+            cur.push_back(c);
         }
     }
+    fields.push_back(cur);
+    return fields;
+}
 
-    if (!run_s.empty()) {
-        std::ostringstream oss;
-        for (size_t i = 0; i < run_s.size(); ++i) {
-            if (i) {
-                oss << ';';
-            }
-            oss << run_s[i];
+// "k=v;k=v" as written by bench::Report into the params/metrics columns.
+std::map<std::string, std::string> parse_packed_kv(const std::string& s) {
+    std::map<std::string, std::string> kv;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ';')) {
+        const auto pos = item.find('=');
+        if (pos != std::string::npos) {
+            kv[item.substr(0, pos)] = item.substr(pos + 1);
         }
-        b.run_times = oss.str();
-        b.p50 = quantile_linear(b.runs, 0.50);
-        b.p95 = quantile_linear(b.runs, 0.95);
-        b.p99 = quantile_linear(b.runs, 0.99);
     }
+    return kv;
+}
 
+// Reads the record the benchmark appended to BENCH_CSV (see bench_harness.h).
+BenchParsed parse_bench_record(const fs::path& p) {
+    BenchParsed b;
+    const auto lines = read_lines(p);
+    if (lines.size() < 2) {
+        return b;
+    }
+    const auto header = parse_csv_line(lines.front());
+    const auto values = parse_csv_line(lines.back());
+    std::map<std::string, std::string> rec;
+    for (size_t i = 0; i < header.size() && i < values.size(); ++i) {
+        rec[header[i]] = values[i];
+    }
+    auto get = [&](const std::map<std::string, std::string>& m, const std::string& k) {
+        auto it = m.find(k);
+        return it == m.end() ? std::string("NA") : or_na(it->second);
+    };
+
+    b.run_times = get(rec, "run_times_s");
+    b.reps = get(rec, "reps");
+    b.stop = get(rec, "stop");
+    b.p5 = get(rec, "p5_s");
+    b.p50 = get(rec, "median_s");
+    b.p95 = get(rec, "p95_s");
+    b.mad = get(rec, "mad_s");
+    b.ci95 = get(rec, "ci95_s");
+    b.best = get(rec, "best_s");
+    b.avg = get(rec, "mean_s");
+
+    const auto metrics = parse_packed_kv(get(rec, "metrics"));
+    b.checksum = get(metrics, "checksum");
+    b.expected_checksum = get(metrics, "expected_checksum");
+    b.fib_value = get(metrics, "fib_value");
+    b.spawned_internal_nodes = get(metrics, "spawned_internal_nodes");
+
+    std::stringstream ss(b.run_times);
+    std::string tok;
+    while (std::getline(ss, tok, ';')) {
+        if (auto d = parse_double(tok)) {
+            b.runs.push_back(*d);
+        }
+    }
+    b.p99 = quantile_linear(b.runs, 0.99);
     return b;
 }
 
@@ -514,6 +542,7 @@ void append_run_row(std::ofstream& csv, const Config& cfg, bool perf_enabled, co
     const std::string base = tmp_base_name();
     const fs::path bench_out = base + ".bench.out";
     const fs::path bench_err = base + ".bench.err";
+    const fs::path bench_csv = base + ".bench.csv";
     const fs::path time_out = base + ".time.out";
     const fs::path perf_out = base + ".perf.out";
 
@@ -527,9 +556,11 @@ void append_run_row(std::ofstream& csv, const Config& cfg, bool perf_enabled, co
         "voluntary_cs=%w\\n"
         "involuntary_cs=%c";
 
-    std::string command;
+    // The benchmark appends its statistics record here; BENCH_CI and friends
+    // are inherited from this process's environment.
+    std::string command = "BENCH_JSON= BENCH_CSV=" + shell_quote(bench_csv.string()) + " ";
     if (perf_enabled) {
-        command =
+        command +=
             "/usr/bin/time -f " + shell_quote(time_fmt) +
             " -o " + shell_quote(time_out.string()) +
             " perf stat -x, -e " + shell_quote("task-clock,context-switches,cpu-migrations,cycles,instructions,cache-misses") +
@@ -538,7 +569,7 @@ void append_run_row(std::ofstream& csv, const Config& cfg, bool perf_enabled, co
             " >" + shell_quote(bench_out.string()) +
             " 2>" + shell_quote(bench_err.string());
     } else {
-        command =
+        command +=
             "/usr/bin/time -f " + shell_quote(time_fmt) +
             " -o " + shell_quote(time_out.string()) +
             " " + cmd_shell +
@@ -549,7 +580,7 @@ void append_run_row(std::ofstream& csv, const Config& cfg, bool perf_enabled, co
     const int ec = run_system(command);
     std::string status = ec == 0 ? "ok" : ("exit_" + std::to_string(ec));
 
-    const BenchParsed bp = parse_bench_output(bench_out);
+    const BenchParsed bp = parse_bench_record(bench_csv);
     const auto tkv = parse_kv_file(time_out);
 
     auto get_t = [&](const std::string& k) {
@@ -642,6 +673,7 @@ void append_run_row(std::ofstream& csv, const Config& cfg, bool perf_enabled, co
         std::to_string(cfg.threads), std::to_string(cfg.warmup), std::to_string(cfg.reps),
         matrix_n, matrix_bs, fib_n, fib_tasks, fib_split_threshold, fib_single_n, fib_single_split_threshold, fib_fast_n, fib_fast_tasks,
         or_na(bp.run_times), or_na(bp.p50), or_na(bp.p95), or_na(bp.p99), or_na(bp.best), or_na(bp.avg),
+        or_na(bp.reps), or_na(bp.stop), or_na(bp.p5), or_na(bp.mad), or_na(bp.ci95),
         or_na(throughput), or_na(gflops),
         or_na(bp.checksum), or_na(bp.expected_checksum), or_na(bp.fib_value), or_na(bp.spawned_internal_nodes),
         or_na(elapsed_s), or_na(user_s), or_na(sys_s), or_na(cpu_pct), or_na(max_rss_kb), or_na(avg_rss_kb), or_na(vol_cs), or_na(invol_cs),
@@ -652,6 +684,7 @@ void append_run_row(std::ofstream& csv, const Config& cfg, bool perf_enabled, co
     std::error_code ignored;
     fs::remove(bench_out, ignored);
     fs::remove(bench_err, ignored);
+    fs::remove(bench_csv, ignored);
     fs::remove(time_out, ignored);
     fs::remove(perf_out, ignored);
 }
@@ -692,6 +725,7 @@ int main(int argc, char** argv) {
         "threads", "warmup", "reps",
         "matrix_n", "matrix_bs", "fib_n", "fib_tasks", "fib_split_threshold", "fib_single_n", "fib_single_split_threshold", "fib_fast_n", "fib_fast_tasks",
         "run_times_s", "latency_p50_s", "latency_p95_s", "latency_p99_s", "app_best_s", "app_avg_s",
+        "reps_done", "reps_stop", "latency_p5_s", "latency_mad_s", "median_ci95_s",
         "throughput_tasks_per_s", "gflops",
         "checksum", "expected_checksum", "fib_value", "spawned_internal_nodes",
         "elapsed_s", "user_s", "sys_s", "cpu_pct", "max_rss_kb", "avg_rss_kb", "voluntary_cs", "involuntary_cs",
@@ -699,13 +733,13 @@ int main(int argc, char** argv) {
         "stderr"
     });
 
-    const std::vector<std::string> pools = {"classic", "ws", "elastic", "advws"};
+    const std::vector<std::string> pools = {"classic", "ws", "elastic", "advws", "coro"};
     const std::vector<std::string> workloads = {"matrix", "fib", "fib_single", "fib_fast"};
 
     std::cout << "Perf enabled: " << (perf_enabled ? 1 : 0) << "\n";
     std::cout << "Writing metrics to: " << cfg.output_csv << "\n";
     std::cout << "Workloads: matrix fib fib_single fib_fast\n";
-    std::cout << "Pools: classic ws elastic advws\n";
+    std::cout << "Pools: classic ws elastic advws coro\n";
     std::cout << "Trials per workload+pool: " << cfg.trials << "\n";
 
     for (const auto& workload : workloads) {
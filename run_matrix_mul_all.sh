@@ -13,42 +13,77 @@ mkdir -p "$OUT"
 MODES=(classic coro ws elastic advws)
 THREADS=(1 2 4 8 16)
 NS=(1024 2048 4096)   # light, mid, heavy
-BS=64
+# Optional rectangular sweep, e.g. SHAPES="8192x64x1024 64x64x65536"; replaces NS when set
+read -r -a SHAPES <<< "${SHAPES:-}"
+if [[ ${#SHAPES[@]} -gt 0 ]]; then NS=("${SHAPES[@]}"); fi
+BS="${BS:-auto}"         # number|auto (tuning cache, else 64)|tune (search once per config, store in cache)
+KERNEL="${KERNEL:-auto}"   # auto|portable|sse2|avx2|avx512
+ALGO="${ALGO:-auto}"       # auto|tiled|splitk|packed|recursive|strassen
+TRANS="${TRANS:-nn}"       # nn|nt|tn|tt (tiled only)
+DTYPE="${DTYPE:-double}"   # double|float|float_dacc|int32|int64|bf16 (non-double: ALGO auto|tiled, TRANS nn)
+read -r -a ORDERS <<< "${ORDERS:-row}"   # tile orders to compare, e.g. ORDERS="row morton hilbert bpanel"
+# LLC counters per run when perf is available (L3 misses for the tile-order comparison)
+PERF_EVENTS="${PERF_EVENTS:-cycles,instructions,LLC-loads,LLC-load-misses}"
+if command -v perf >/dev/null 2>&1; then HAS_PERF=1; else HAS_PERF=0; echo "[warn] perf not found; LLC columns will be blank." >&2; fi
 WARMUP=1
 REPS=3
 
-TOTAL=$(( ${#MODES[@]} * ${#THREADS[@]} * ${#NS[@]} ))
+TOTAL=$(( ${#MODES[@]} * ${#THREADS[@]} * ${#NS[@]} * ${#ORDERS[@]} ))
 RUN=0
 
-echo "preset,mode,n,block_size,threads,warmup,reps,exit_code,duration_s,best_s,avg_s,checksum,log" > "$OUT/summary.csv"
+echo "preset,mode,n,block_size,threads,warmup,reps,kernel,algo,trans,dtype,order,pages,pad,exit_code,duration_s,setup_s,best_s,avg_s,gflops_best,checksum,perf_llc_loads,perf_llc_load_misses,log" > "$OUT/summary.csv"
+
+perf_value() {
+  awk -F',' -v e="$2" '$3 == e {gsub(/^[[:space:]]+|[[:space:]]+$/, "", $1); print $1; exit}' "$1"
+}
 
 for N in "${NS[@]}"; do
   case "$N" in
     1024) preset="light" ;;
     2048) preset="mid" ;;
     4096) preset="heavy" ;;
+    *)    preset="rect_$N" ;;
   esac
 
   for mode in "${MODES[@]}"; do
     for t in "${THREADS[@]}"; do
+     for order in "${ORDERS[@]}"; do
       RUN=$((RUN+1))
       PCT=$((RUN * 100 / TOTAL))
-      log="$OUT/matrix_mul_${preset}_${mode}_t${t}.log"
+      log="$OUT/matrix_mul_${preset}_${mode}_${ALGO}_${TRANS}_${DTYPE}_${order}_t${t}.log"
+      perf_log="$OUT/perf_${preset}_${mode}_${ALGO}_${TRANS}_${DTYPE}_${order}_t${t}.csv"
 
-      echo "[run $RUN/$TOTAL | ${PCT}%] preset=$preset mode=$mode N=$N BS=$BS threads=$t warmup=$WARMUP reps=$REPS"
+      echo "[run $RUN/$TOTAL | ${PCT}%] preset=$preset mode=$mode N=$N BS=$BS threads=$t warmup=$WARMUP reps=$REPS kernel=$KERNEL algo=$ALGO trans=$TRANS dtype=$DTYPE order=$order"
       start=$(date +%s)
 
       set +e
-      ./matrix_mul_bench "$mode" "$N" "$BS" "$t" "$WARMUP" "$REPS" > "$log" 2>&1
+      if [[ "$HAS_PERF" == "1" ]]; then
+        MATMUL_ORDER="$order" perf stat --no-big-num -x, -e "$PERF_EVENTS" -o "$perf_log" -- \
+          ./matrix_mul_bench "$mode" "$N" "$BS" "$t" "$WARMUP" "$REPS" "$KERNEL" "$ALGO" "$TRANS" "$DTYPE" > "$log" 2>&1
+      else
+        MATMUL_ORDER="$order" ./matrix_mul_bench "$mode" "$N" "$BS" "$t" "$WARMUP" "$REPS" "$KERNEL" "$ALGO" "$TRANS" "$DTYPE" > "$log" 2>&1
+      fi
       rc=$?
       set -e
 
       end=$(date +%s)
       dur=$((end - start))
 
+      setup=$(awk '/^Setup:/ {print $2; exit}' "$log")
       best=$(awk '/^Best:/ {print $2; exit}' "$log")
       avg=$(awk '/^Avg :/ {print $3; exit}' "$log")
+      gflops=$(awk '/^GFLOPS \(best\):/ {print $3; exit}' "$log")
+      kernel=$(awk '/^pool=/ && match($0, /kernel=[a-z0-9]+/) {print substr($0, RSTART + 7, RLENGTH - 7); exit}' "$log")
+      bs_used=$(awk '/^pool=/ && match($0, / BS=[0-9]+/) {print substr($0, RSTART + 4, RLENGTH - 4); exit}' "$log")
+      pages=$(awk '/^pool=/ && match($0, /pages=[a-z]+\([0-9]+[KM]\)/) {print substr($0, RSTART + 6, RLENGTH - 6); exit}' "$log")
+      pad=$(awk '/^pool=/ && match($0, / pad=[0-9]+/) {print substr($0, RSTART + 5, RLENGTH - 5); exit}' "$log")
       checksum=$(awk '/^Checksum:/ {print $2; exit}' "$log")
+      llc_loads=""
+      llc_misses=""
+      if [[ "$HAS_PERF" == "1" && -f "$perf_log" ]]; then
+        llc_loads=$(perf_value "$perf_log" "LLC-loads")
+        llc_misses=$(perf_value "$perf_log" "LLC-load-misses")
+      fi
 
       if [[ "$rc" -eq 0 ]]; then
         echo "[done $RUN/$TOTAL] OK  ${dur}s  log=$log"
@@ -56,7 +91,8 @@ for N in "${NS[@]}"; do
         echo "[done $RUN/$TOTAL] FAIL(rc=$rc) ${dur}s  log=$log"
       fi
 
-      echo "$preset,$mode,$N,$BS,$t,$WARMUP,$REPS,$rc,$dur,${best:-},${avg:-},${checksum:-},$log" >> "$OUT/summary.csv"
+      echo "$preset,$mode,$N,${bs_used:-$BS},$t,$WARMUP,$REPS,${kernel:-$KERNEL},$ALGO,$TRANS,$DTYPE,$order,${pages:-},${pad:-},$rc,$dur,${setup:-},${best:-},${avg:-},${gflops:-},${checksum:-},${llc_loads:-},${llc_misses:-},$log" >> "$OUT/summary.csv"
+     done
     done
   done
 done
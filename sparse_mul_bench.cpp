@@ -0,0 +1,258 @@
+/*
+To compile and run this benchmark:
+
+g++ -O3 -std=c++20 -pthread sparse_mul_bench.cpp \
+  thread_pool.cpp \
+  -o sparse_mul_bench
+
+./sparse_mul_bench classic powerlaw:1000000 8 1 5
+./sparse_mul_bench ws      powerlaw:1000000 8 1 5
+./sparse_mul_bench ws      powerlaw:1000000 8 1 5 spmv rows
+./sparse_mul_bench coro    banded:2000000:16 8 1 5 spmm nnz 32
+./sparse_mul_bench ws      web-Google.mtx 8 1 5
+
+1st arg: matrix
+  powerlaw:ROWS[:AVG_NNZ]  square, Pareto-distributed row lengths (default avg 16)
+  banded:ROWS[:HALF_BW]    square, nonzeros at |i - j| <= HALF_BW (default 8)
+  path                     Matrix Market coordinate file
+2nd arg: number of threads
+3rd arg: number of warmup runs (not timed)
+4th arg: number of timed runs (best and average reported)
+5th optional arg: operation (spmv|spmm, default spmv)
+6th optional arg: partition (nnz|rows, default nnz; see matmul_sparse.h)
+7th optional arg: dense columns for spmm (default 16)
+
+Environment:
+  SPARSE_ALPHA=1.8           power-law tail exponent (> 1; smaller = more skewed rows)
+  SPARSE_SORTED=0            1: power-law rows sorted heaviest first instead of shuffled
+  SPARSE_TASKS_PER_THREAD=4  partition ranges per thread
+*/
+
+#include "bench_harness.h"
+#include "thread_pool.h"
+#include "matmul_gemm.h"
+#include "matmul_matrix.h"
+#include "matmul_sparse.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static inline double seconds_since(const Clock::time_point& t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+static std::string env_string(const char* name, const std::string& def) {
+    const char* raw = std::getenv(name);
+    return (raw != nullptr && *raw != '\0') ? raw : def;
+}
+
+// "kind:rows[:param]" for the generators; anything else is a file path.
+struct MatrixSpec {
+    std::string kind;  // powerlaw | banded | file
+    size_t rows{0};
+    double param{0.0};
+    std::string path;
+};
+
+static bool parse_matrix_spec(const std::string& text, MatrixSpec& spec) {
+    const size_t colon = text.find(':');
+    const std::string kind = text.substr(0, colon);
+    if (colon == std::string::npos || (kind != "powerlaw" && kind != "banded")) {
+        spec.kind = "file";
+        spec.path = text;
+        return true;
+    }
+    spec.kind = kind;
+    spec.param = kind == "powerlaw" ? 16.0 : 8.0;
+    try {
+        const std::string rest = text.substr(colon + 1);
+        const size_t colon2 = rest.find(':');
+        spec.rows = std::stoul(rest.substr(0, colon2));
+        if (colon2 != std::string::npos) spec.param = std::stod(rest.substr(colon2 + 1));
+    } catch (...) {
+        return false;
+    }
+    return spec.rows > 0 && spec.param >= 0.0;
+}
+
+static void usage(const char* prog) {
+    std::cerr
+        << "Usage:\n  " << prog
+        << " <pool: classic|elastic|ws|advws|coro> <matrix> <threads> <warmup> <reps> [op] [partition] [cols]\n\n"
+        << "Matrix:    powerlaw:ROWS[:AVG_NNZ] | banded:ROWS[:HALF_BW] | path to a Matrix Market file\n"
+        << "Op:        spmv|spmm (default spmv; spmm multiplies by a dense (A cols) x cols matrix)\n"
+        << "Partition: nnz|rows (default nnz = ranges of equal nonzeros, rows = equal row counts)\n"
+        << "Cols:      dense columns for spmm (default 16)\n"
+        << "Env:       SPARSE_ALPHA=1.8 (power-law exponent), SPARSE_SORTED=1 (heaviest rows first),\n"
+        << "           SPARSE_TASKS_PER_THREAD=4\n\n"
+        << "Examples:\n"
+        << "  " << prog << " ws    powerlaw:1000000 8 1 5\n"
+        << "  " << prog << " ws    powerlaw:1000000 8 1 5 spmv rows\n"
+        << "  " << prog << " coro  banded:2000000:16 8 1 5 spmm nnz 32\n"
+        << "  " << prog << " advws web-Google.mtx 4 1 5\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 6) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const std::string pool_kind = argv[1];
+    const size_t threads = std::stoul(argv[3]);
+    const int warmup = std::stoi(argv[4]);
+    const int reps = std::stoi(argv[5]);
+    const std::string op = (argc >= 7) ? argv[6] : "spmv";
+    const std::string partition_name = (argc >= 8) ? argv[7] : "nnz";
+    const size_t dense_cols = (argc >= 9) ? std::stoul(argv[8]) : 16;
+
+    MatrixSpec spec;
+    if (!parse_matrix_spec(argv[2], spec)) {
+        std::cerr << "Bad matrix: " << argv[2] << " (expected powerlaw:ROWS[:AVG], banded:ROWS[:BW] or a path)\n";
+        usage(argv[0]);
+        return 1;
+    }
+    if (op != "spmv" && op != "spmm") {
+        std::cerr << "Unknown op: " << op << "\n";
+        usage(argv[0]);
+        return 1;
+    }
+    const std::optional<matmul::SparsePartition> partition = matmul::parse_sparse_partition(partition_name);
+    if (!partition) {
+        std::cerr << "Unknown partition: " << partition_name << " (nnz|rows)\n";
+        usage(argv[0]);
+        return 1;
+    }
+    if (threads == 0 || reps <= 0 || dense_cols == 0) {
+        std::cerr << "threads, reps and cols must be > 0\n";
+        return 1;
+    }
+    const bool spmm = op == "spmm";
+    const size_t n_cols = spmm ? dense_cols : 1;
+    const double alpha = std::stod(env_string("SPARSE_ALPHA", "1.8"));
+    const bool sorted_rows = env_string("SPARSE_SORTED", "0") != "0";
+    const size_t tasks_per_thread = std::max<size_t>(std::stoul(env_string("SPARSE_TASKS_PER_THREAD", "4")), 1);
+
+    auto spawn = [](auto& pool, size_t count, const auto& fn) { matmul::run_tasks(pool, count, fn); };
+    auto spawn_coro = [](ThreadPool& pool, size_t count, const auto& fn) { bench::run_tasks_coro(pool, count, fn); };
+
+    bool write_failed = false;
+    auto run_pool = [&](auto& pool, auto&& spawn_fn) {
+        auto run = [&](size_t count, const auto& fn) { spawn_fn(pool, count, fn); };
+
+        const auto setup_t0 = Clock::now();
+        matmul::CsrMatrix a;
+        try {
+            if (spec.kind == "powerlaw") {
+                a = matmul::make_powerlaw_csr(run, spec.rows, spec.rows, spec.param, alpha, 12345, sorted_rows);
+            } else if (spec.kind == "banded") {
+                a = matmul::make_banded_csr(run, spec.rows, static_cast<size_t>(spec.param), 12345);
+            } else {
+                a = matmul::load_matrix_market(spec.path);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Matrix setup failed: " << e.what() << "\n";
+            return false;
+        }
+
+        // spmv: x and y are single contiguous rows. spmm: the dense operand is
+        // cols x n_cols and the result rows x n_cols, both with padded rows.
+        const matmul::MatrixOptions storage = matmul::matrix_options_from_env();
+        matmul::Matrix x = spmm ? matmul::Matrix(a.cols, n_cols, storage) : matmul::Matrix(1, a.cols, storage);
+        matmul::Matrix y = spmm ? matmul::Matrix(a.rows, n_cols, storage) : matmul::Matrix(1, a.rows, storage);
+        matmul::init_random(run, x, 67890, 4096);
+        matmul::init_zero(run, y, 4096);
+        const std::vector<size_t> bounds = matmul::partition_csr(a, *partition, threads * tasks_per_thread);
+        const double setup_s = seconds_since(setup_t0);
+
+        size_t max_row = 0;
+        for (size_t i = 0; i < a.rows; ++i) max_row = std::max(max_row, a.row_nnz(i));
+
+        std::cout << "Sparse benchmark (CSR)\n"
+                  << "pool=" << pool_kind
+                  << " matrix=" << argv[2]
+                  << " rows=" << a.rows
+                  << " cols=" << a.cols
+                  << " nnz=" << a.nnz()
+                  << " max_row_nnz=" << max_row
+                  << " threads=" << threads
+                  << " warmup=" << warmup
+                  << " reps=" << reps
+                  << " op=" << op;
+        if (spmm) {
+            std::cout << " dense_cols=" << dense_cols;
+        }
+        if (spec.kind == "powerlaw") {
+            std::cout << " alpha=" << alpha << (sorted_rows ? " sorted" : "");
+        }
+        std::cout << " partition=" << matmul::sparse_partition_name(*partition)
+                  << " tasks=" << (bounds.size() - 1)
+                  << " imbalance=" << matmul::partition_imbalance(a, bounds)
+                  << "\n";
+        std::cout << "Setup: " << setup_s << " s (generate/load A, partition, init x)\n";
+
+        auto multiply = [&] {
+            const auto t0 = Clock::now();
+            if (spmm) {
+                matmul::spmm_tasks(run, a, bounds, x.data(), x.ld(), n_cols, y.data(), y.ld());
+            } else {
+                matmul::spmv_tasks(run, a, bounds, x.data(), y.data());
+            }
+            return seconds_since(t0);
+        };
+
+        const bench::Samples samples = bench::repeat(bench::repeat_options(warmup, reps), multiply);
+        const bench::Stats st = bench::summarize(samples.runs);
+
+        // Each nonzero is one multiply-add per dense column; the matrix
+        // stream is 12 bytes per nonzero plus the row pointers.
+        const double flops = 2.0 * static_cast<double>(a.nnz()) * static_cast<double>(n_cols);
+        const double bytes = 12.0 * static_cast<double>(a.nnz()) + 8.0 * static_cast<double>(a.rows + 1);
+        double checksum = 0.0;
+        for (size_t i = 0; i < y.rows(); ++i) {
+            for (size_t j = 0; j < y.cols(); ++j) checksum += y(i, j);
+        }
+        bench::Report report("sparse", pool_kind, threads);
+        report.param("matrix", argv[2])
+            .param("rows", a.rows)
+            .param("cols", a.cols)
+            .param("nnz", a.nnz())
+            .param("op", op)
+            .param("dense_cols", n_cols)
+            .param("partition", matmul::sparse_partition_name(*partition))
+            .param("tasks", bounds.size() - 1);
+        report.metric("gflops_best", flops / st.best * 1e-9)
+            .metric("gflops_median", flops / st.median * 1e-9)
+            .metric("matrix_gbps_best", bytes / st.best * 1e-9)
+            .metric("setup_s", setup_s)
+            .metric("checksum", checksum);
+        write_failed = !report.finish(samples);
+        std::cout << "GFLOPS (best): " << flops / st.best * 1e-9 << "\n";
+        std::cout << "GFLOPS (avg) : " << flops / st.mean * 1e-9 << "\n";
+        std::cout << "Matrix GB/s (best): " << bytes / st.best * 1e-9 << "\n";
+        std::cout << "Checksum: " << checksum << "\n";
+        return true;
+    };
+
+    bool ok = false;
+    const bool known = bench::with_pool(pool_kind, threads, [&](ThreadPool& pool) {
+        ok = pool_kind == "coro" ? run_pool(pool, spawn_coro) : run_pool(pool, spawn);
+    });
+    if (!known) {
+        std::cerr << "Unknown pool kind: " << pool_kind << "\n";
+        usage(argv[0]);
+        return 1;
+    }
+
+    return ok && !write_failed ? 0 : 1;
+}
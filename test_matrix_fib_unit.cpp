@@ -1,19 +1,40 @@
+#include "bench_harness.h"
 #include "thread_pool.h"
+#include "fib_bigint.h"
+#include "matmul_batch.h"
+#include "matmul_expr.h"
+#include "matmul_file.h"
+#include "matmul_fixed.h"
+#include "matmul_gemm.h"
+#include "matmul_kernels.h"
+#include "matmul_matrix.h"
+#include "matmul_recursive.h"
+#include "matmul_sparse.h"
+#include "matmul_tuning.h"
+#include "matmul_typed.h"
+#include "matmul_verify.h"
 
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cmath>
 #include <condition_variable>
 #include <cstdint>
 #include <exception>
+#include <filesystem>
+#include <fstream>
 #include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <mutex>
 #include <numeric>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
+#include <unistd.h>
 
 class TestSuite {
 public:
@@ -68,6 +89,13 @@ void expect_eq_i64(int64_t got, int64_t expected, const std::string& msg) {
     }
 }
 
+void expect_near(double got, double expected, double tol, const std::string& msg) {
+    if (std::fabs(got - expected) > tol) {
+        throw std::runtime_error(msg + " (got=" + std::to_string(got) +
+                                 ", expected=" + std::to_string(expected) + ")");
+    }
+}
+
 size_t ridx(size_t n, size_t r, size_t c) {
     return r * n + c;
 }
@@ -201,16 +229,58 @@ void expect_matrix_eq(const std::vector<int64_t>& got,
     }
 }
 
+// Reference C = alpha * op(A) * op(B) + beta * C with row-major leading dimensions.
+void gemm_ref(matmul::Trans ta, matmul::Trans tb,
+              size_t m, size_t n, size_t k,
+              double alpha, const std::vector<double>& a, size_t lda,
+              const std::vector<double>& b, size_t ldb,
+              double beta, std::vector<double>& c, size_t ldc) {
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            double acc = 0.0;
+            for (size_t p = 0; p < k; ++p) {
+                const double aip = ta == matmul::Trans::No ? a[ridx(lda, i, p)] : a[ridx(lda, p, i)];
+                const double bpj = tb == matmul::Trans::No ? b[ridx(ldb, p, j)] : b[ridx(ldb, j, p)];
+                acc += aip * bpj;
+            }
+            double& cij = c[ridx(ldc, i, j)];
+            cij = alpha * acc + (beta == 0.0 ? 0.0 : beta * cij);
+        }
+    }
+}
+
 class MatrixFibTests {
 public:
     static void register_all(TestSuite& suite) {
         suite.add("matrix seq 2x2 known result", matrix_seq_2x2_known_result);
         suite.add("matrix parallel classic matches seq", matrix_parallel_classic_matches_seq);
         suite.add("matrix parallel work stealing matches seq", matrix_parallel_ws_matches_seq);
+        suite.add("matrix micro-kernels match reference on ragged blocks, accumulate and overwrite",
+                  matrix_kernels_match_reference);
+        suite.add("matrix packed panels match reference", matrix_packed_matches_reference);
+        suite.add("matrix gemm matches reference on rectangular shapes", matrix_gemm_rectangular_matches_reference);
+        suite.add("matrix split-K gemm matches reference and is auto-selected", matrix_gemm_split_k);
+        suite.add("matrix tile orders visit every tile once and match reference", matrix_tile_orders);
+        suite.add("matrix recursive and strassen fork-join match reference", matrix_fork_join_matches_reference);
+        suite.add("matrix storage aligns, pads and falls back on page modes", matrix_storage_layout);
+        suite.add("matrix parallel init is deterministic across thread counts", matrix_parallel_init_deterministic);
+        suite.add("matrix gemm on padded storage matches reference", matrix_gemm_padded_storage);
+        suite.add("matrix files round-trip and out-of-core gemm matches reference", matrix_file_ooc_gemm);
+        suite.add("matrix typed gemm matches reference for every dtype", matrix_typed_gemm);
+        suite.add("matrix freivalds check accepts products and catches broken tiles", matrix_freivalds_verify);
+        suite.add("sparse CSR generators, loader and kernels match dense reference", sparse_csr_matches_dense);
+        suite.add("matrix chain plans by cost and the tile DAG matches reference", matrix_chain_dag);
+        suite.add("matrix fixed-size specializations match reference", matrix_fixed_matches_reference);
+        suite.add("matrix nested tasks complete from a saturated fixed pool", matrix_nested_tasks_from_saturated_pool);
+        suite.add("matrix batched small gemm matches reference across submitters", matrix_batched_matches_reference);
+        suite.add("cpu dispatch honors only supported overrides", cpu_dispatch_overrides);
+        suite.add("matmul tuning cache round-trips per key", matmul_tuning_cache_round_trip);
         suite.add("fibonacci iterative known values", fibonacci_iterative_known_values);
         suite.add("fibonacci recursive-threshold matches iterative", fibonacci_threshold_matches_iterative);
         suite.add("fibonacci fast doubling matches iterative", fibonacci_fast_matches_iterative);
+        suite.add("fibonacci big-integer fast doubling and parallel karatsuba", fibonacci_bigint_matches_reference);
         suite.add("fibonacci batch checksum in thread pool", fibonacci_pool_batch_checksum);
+        suite.add("bench harness statistics, adaptive reps and records", bench_harness_stats_and_records);
     }
 
 private:
@@ -268,6 +338,953 @@ private:
         expect_matrix_eq(got, expected, "work stealing pool matrix product mismatch");
     }
 
+    static void matrix_kernels_match_reference() {
+        // Odd sizes exercise row remainders and the scalar column tail of every kernel.
+        const size_t m = 19;
+        const size_t n = 37;
+        const size_t kc = 13;
+        const size_t ld = 41;
+        std::vector<double> a(m * ld);
+        std::vector<double> b(kc * ld);
+        std::vector<double> c0(m * ld);
+        for (size_t i = 0; i < a.size(); ++i) a[i] = static_cast<double>((i * 7) % 11) - 5.0;
+        for (size_t i = 0; i < b.size(); ++i) b[i] = static_cast<double>((i * 5) % 13) - 6.0;
+        for (size_t i = 0; i < c0.size(); ++i) c0[i] = static_cast<double>(i % 3);
+
+        std::vector<double> expected = c0;
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t p = 0; p < kc; ++p) {
+                for (size_t j = 0; j < n; ++j) {
+                    expected[ridx(ld, i, j)] += a[ridx(ld, i, p)] * b[ridx(ld, p, j)];
+                }
+            }
+        }
+
+        for (const matmul::Kernel* k : matmul::supported_kernels()) {
+            std::vector<double> c = c0;
+            matmul::multiply_block(*k, m, n, kc, a.data(), ld, b.data(), ld, c.data(), ld);
+            for (size_t i = 0; i < c.size(); ++i) {
+                expect_near(c[i], expected[i], 1e-9,
+                            std::string("kernel ") + k->name + " mismatch at index " + std::to_string(i));
+            }
+
+            // Overwrite variants must never read C: NaN inside the block is replaced,
+            // and the padding columns past n are left alone.
+            std::vector<double> o(m * ld, std::numeric_limits<double>::quiet_NaN());
+            matmul::multiply_block(*k, m, n, kc, a.data(), ld, b.data(), ld, o.data(), ld, true);
+            for (size_t i = 0; i < m; ++i) {
+                for (size_t j = 0; j < ld; ++j) {
+                    const std::string where =
+                        std::string("kernel ") + k->name + " overwrite at " + std::to_string(i) + "," + std::to_string(j);
+                    if (j < n) {
+                        expect_near(o[ridx(ld, i, j)], expected[ridx(ld, i, j)] - c0[ridx(ld, i, j)], 1e-9, where);
+                    } else {
+                        expect_true(std::isnan(o[ridx(ld, i, j)]), where + " touched padding");
+                    }
+                }
+            }
+        }
+
+        // gemm with beta = 0 overwrites tiles through the same kernels.
+        const auto serial = [](size_t count, const auto& fn) {
+            for (size_t t = 0; t < count; ++t) fn(t);
+        };
+        std::vector<double> g(m * ld, std::numeric_limits<double>::quiet_NaN());
+        matmul::gemm_tasks(serial, matmul::Trans::No, matmul::Trans::No, m, n, kc, 1.0, a.data(), ld, b.data(), ld, 0.0,
+                           g.data(), ld, matmul::GemmOptions{nullptr, 8});
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                expect_near(g[ridx(ld, i, j)], expected[ridx(ld, i, j)] - c0[ridx(ld, i, j)], 1e-9,
+                            "gemm beta=0 over NaN at " + std::to_string(i) + "," + std::to_string(j));
+            }
+        }
+    }
+
+    static void matrix_packed_matches_reference() {
+        const size_t n = 45;
+        std::vector<double> a(n * n);
+        std::vector<double> b(n * n);
+        for (size_t i = 0; i < a.size(); ++i) a[i] = static_cast<double>((i * 3) % 17) - 8.0;
+        for (size_t i = 0; i < b.size(); ++i) b[i] = static_cast<double>((i * 11) % 7) - 3.0;
+
+        std::vector<double> expected(n * n, 0.0);
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t p = 0; p < n; ++p) {
+                for (size_t j = 0; j < n; ++j) {
+                    expected[ridx(n, i, j)] += a[ridx(n, i, p)] * b[ridx(n, p, j)];
+                }
+            }
+        }
+
+        for (const matmul::Kernel* k : matmul::supported_kernels()) {
+            // Tiny blocking so every loop level has a ragged tail.
+            const matmul::PackedBlocking pb{2 * k->mr + 1, 16, 3 * k->nr};
+            matmul::AlignedBuffer ap(pb.mc * pb.kc);
+            matmul::AlignedBuffer bp(matmul::packed_b_size(pb.kc, pb.nc, k->nr));
+            std::vector<double> c(n * n, 0.0);
+            for (size_t jc = 0; jc < n; jc += pb.nc) {
+                const size_t nc = std::min(pb.nc, n - jc);
+                for (size_t pc = 0; pc < n; pc += pb.kc) {
+                    const size_t kc = std::min(pb.kc, n - pc);
+                    matmul::pack_b(kc, nc, &b[ridx(n, pc, jc)], n, bp.data(), k->nr);
+                    for (size_t ic = 0; ic < n; ic += pb.mc) {
+                        const size_t mc = std::min(pb.mc, n - ic);
+                        matmul::pack_a(mc, kc, &a[ridx(n, ic, pc)], n, ap.data());
+                        matmul::packed_macro_kernel(*k, mc, nc, kc, ap.data(), bp.data(),
+                                                    &c[ridx(n, ic, jc)], n);
+                    }
+                }
+            }
+            for (size_t i = 0; i < c.size(); ++i) {
+                expect_near(c[i], expected[i], 1e-9,
+                            std::string("packed ") + k->name + " mismatch at index " + std::to_string(i));
+            }
+        }
+    }
+
+    static void matrix_gemm_rectangular_matches_reference() {
+        struct Case { size_t m, n, k; };
+        const std::vector<Case> shapes = {{37, 19, 53}, {5, 70, 3}, {64, 1, 129}, {1, 33, 17}};
+        const std::vector<std::pair<double, double>> scalars = {{1.0, 0.0}, {-0.5, 2.0}};
+        const matmul::Trans both[] = {matmul::Trans::No, matmul::Trans::Yes};
+
+        ThreadPool classic(3);
+        ThreadPool ws(3, ThreadPool::PoolKind::WorkStealing);
+
+        for (const Case& sh : shapes) {
+            for (matmul::Trans ta : both) {
+                for (matmul::Trans tb : both) {
+                    // Leading dimensions padded past the row length to catch lda/ldb/ldc mixups.
+                    const size_t a_rows = ta == matmul::Trans::No ? sh.m : sh.k;
+                    const size_t lda = (ta == matmul::Trans::No ? sh.k : sh.m) + 3;
+                    const size_t b_rows = tb == matmul::Trans::No ? sh.k : sh.n;
+                    const size_t ldb = (tb == matmul::Trans::No ? sh.n : sh.k) + 2;
+                    const size_t ldc = sh.n + 5;
+
+                    std::vector<double> a(a_rows * lda), b(b_rows * ldb), c0(sh.m * ldc);
+                    for (size_t i = 0; i < a.size(); ++i) a[i] = static_cast<double>((i * 7) % 13) - 6.0;
+                    for (size_t i = 0; i < b.size(); ++i) b[i] = static_cast<double>((i * 5) % 11) - 5.0;
+                    for (size_t i = 0; i < c0.size(); ++i) c0[i] = static_cast<double>(i % 4);
+
+                    for (const auto& [alpha, beta] : scalars) {
+                        std::vector<double> expected = c0;
+                        gemm_ref(ta, tb, sh.m, sh.n, sh.k, alpha, a, lda, b, ldb, beta, expected, ldc);
+
+                        for (ThreadPool* pool : {&classic, &ws}) {
+                            std::vector<double> c = c0;
+                            if (beta == 0.0) {
+                                // beta == 0 must not read C.
+                                for (size_t i = 0; i < sh.m; ++i) c[ridx(ldc, i, 0)] = std::nan("");
+                            }
+                            matmul::gemm(*pool, ta, tb, sh.m, sh.n, sh.k, alpha, a.data(), lda,
+                                         b.data(), ldb, beta, c.data(), ldc, matmul::GemmOptions{nullptr, 16});
+                            for (size_t i = 0; i < c.size(); ++i) {
+                                expect_near(c[i], expected[i], 1e-9,
+                                            "gemm " + std::to_string(sh.m) + "x" + std::to_string(sh.n) +
+                                                "x" + std::to_string(sh.k) +
+                                                (ta == matmul::Trans::Yes ? " tA" : "") +
+                                                (tb == matmul::Trans::Yes ? " tB" : "") +
+                                                " mismatch at index " + std::to_string(i));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        bool threw = false;
+        try {
+            std::vector<double> x(4);
+            matmul::gemm(classic, matmul::Trans::No, matmul::Trans::No, 2, 2, 2, 1.0,
+                         x.data(), 1, x.data(), 2, 0.0, x.data(), 2);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        expect_true(threw, "gemm should reject lda smaller than the row length");
+    }
+
+    static void matrix_gemm_split_k() {
+        matmul::GemmOptions opt{nullptr, 16};
+        opt.workers = 8;
+        expect_true(matmul::plan_gemm(16, 16, 4096, opt).splits > 1, "small output with long K should split");
+        expect_true(matmul::plan_gemm(256, 256, 4096, opt).splits == 1, "enough output tiles should not split");
+        expect_true(matmul::plan_gemm(16, 16, 64, opt).splits == 1, "short K should not split");
+
+        const size_t m = 21, n = 18, k = 700;
+        const size_t ldc = n + 3;
+        std::vector<double> a(k * m), b(k * n), c0(m * ldc);
+        for (size_t i = 0; i < a.size(); ++i) a[i] = static_cast<double>((i * 7) % 13) - 6.0;
+        for (size_t i = 0; i < b.size(); ++i) b[i] = static_cast<double>((i * 5) % 11) - 5.0;
+        for (size_t i = 0; i < c0.size(); ++i) c0[i] = static_cast<double>(i % 4);
+
+        // A stored transposed (K x M) so the K slices also cover the strided case.
+        std::vector<double> expected = c0;
+        gemm_ref(matmul::Trans::Yes, matmul::Trans::No, m, n, k, 0.5, a, m, b, n, -1.0, expected, ldc);
+
+        ThreadPool ws(4, ThreadPool::PoolKind::WorkStealing);
+        opt.schedule = matmul::GemmSchedule::SplitK;
+        // 0 derives the count; 7 does not divide the 44 K blocks; 1000 clamps to one block per slice.
+        for (size_t splits : {size_t{0}, size_t{3}, size_t{7}, size_t{1000}}) {
+            opt.splits = splits;
+            std::vector<double> c = c0;
+            matmul::gemm(ws, matmul::Trans::Yes, matmul::Trans::No, m, n, k, 0.5, a.data(), m,
+                         b.data(), n, -1.0, c.data(), ldc, opt);
+            for (size_t i = 0; i < c.size(); ++i) {
+                expect_near(c[i], expected[i], 1e-9,
+                            "split-K (splits=" + std::to_string(splits) + ") mismatch at index " +
+                                std::to_string(i));
+            }
+        }
+    }
+
+    static void matrix_tile_orders() {
+        const matmul::TileOrder orders[] = {matmul::TileOrder::RowMajor, matmul::TileOrder::Morton,
+                                            matmul::TileOrder::Hilbert, matmul::TileOrder::BPanel};
+        for (const matmul::TileOrder order : orders) {
+            const std::string name = matmul::tile_order_name(order);
+            expect_true(matmul::parse_tile_order(name) == order, name + " should round-trip by name");
+            for (const auto& grid : {std::pair<size_t, size_t>{8, 8}, {5, 3}, {1, 9}, {7, 1}}) {
+                const std::vector<uint32_t> seq = matmul::make_tile_order(grid.first, grid.second, order, 3);
+                std::vector<uint32_t> sorted = seq;
+                std::sort(sorted.begin(), sorted.end());
+                std::vector<uint32_t> all(grid.first * grid.second);
+                std::iota(all.begin(), all.end(), 0U);
+                expect_true(sorted == all, name + " should visit each tile of " + std::to_string(grid.first) + "x" +
+                                               std::to_string(grid.second) + " once");
+            }
+        }
+
+        // Consecutive Hilbert tiles are neighbours on a power-of-two grid.
+        const std::vector<uint32_t> h = matmul::make_tile_order(8, 8, matmul::TileOrder::Hilbert, 1);
+        bool adjacent = true;
+        for (size_t t = 1; t < h.size(); ++t) {
+            const long di = static_cast<long>(h[t] / 8) - static_cast<long>(h[t - 1] / 8);
+            const long dj = static_cast<long>(h[t] % 8) - static_cast<long>(h[t - 1] % 8);
+            adjacent = adjacent && std::abs(di) + std::abs(dj) == 1;
+        }
+        expect_true(adjacent, "hilbert steps should move to a neighbouring tile");
+
+        // bpanel with G = 2: tiles (0,0) (1,0) (0,1) (1,1) ... then rows 2..3.
+        const std::vector<uint32_t> g = matmul::make_tile_order(4, 3, matmul::TileOrder::BPanel, 2);
+        expect_true(g[0] == 0 && g[1] == 3 && g[2] == 1 && g[3] == 4 && g[6] == 6,
+                    "bpanel should walk B panels inside each row group");
+
+        const size_t m = 75, n = 50, k = 40;
+        std::vector<double> a(m * k), b(k * n), expected(m * n, 0.0);
+        for (size_t i = 0; i < a.size(); ++i) a[i] = static_cast<double>((i * 7) % 13) - 6.0;
+        for (size_t i = 0; i < b.size(); ++i) b[i] = static_cast<double>((i * 5) % 11) - 5.0;
+        gemm_ref(matmul::Trans::No, matmul::Trans::No, m, n, k, 1.0, a, k, b, n, 0.0, expected, n);
+
+        ThreadPool ws(4, ThreadPool::PoolKind::WorkStealing);
+        for (const matmul::TileOrder order : orders) {
+            for (const matmul::GemmSchedule schedule : {matmul::GemmSchedule::OutputTiles, matmul::GemmSchedule::SplitK}) {
+                matmul::GemmOptions opt{nullptr, 16};
+                opt.workers = 4;
+                opt.order = order;
+                opt.schedule = schedule;
+                std::vector<double> c(m * n, 3.0);
+                matmul::gemm(ws, matmul::Trans::No, matmul::Trans::No, m, n, k, 1.0, a.data(), k, b.data(), n,
+                             0.0, c.data(), n, opt);
+                for (size_t i = 0; i < c.size(); ++i) {
+                    expect_near(c[i], expected[i], 1e-9,
+                                std::string(matmul::tile_order_name(order)) + " gemm mismatch at index " +
+                                    std::to_string(i));
+                }
+            }
+        }
+    }
+
+    static void matrix_fork_join_matches_reference() {
+        ThreadPool ws(4, ThreadPool::PoolKind::WorkStealing);
+        auto spawn = [&ws](std::function<void()> fn) { ws.submit(std::move(fn)); };
+
+        struct Case { size_t m, n, k, cutoff; };
+        // 100 -> 50 -> 25 exercises two Strassen levels and the odd-size fallback;
+        // the rectangular case always takes the classic recursion.
+        const std::vector<Case> cases = {{37, 90, 141, 0}, {100, 100, 100, 16}, {64, 64, 64, 0}, {33, 21, 50, 8}};
+        for (const Case& cs : cases) {
+            std::vector<double> a(cs.m * cs.k), b(cs.k * cs.n), c(cs.m * cs.n, 7.0);
+            for (size_t i = 0; i < a.size(); ++i) a[i] = static_cast<double>((i * 7) % 13) - 6.0;
+            for (size_t i = 0; i < b.size(); ++i) b[i] = static_cast<double>((i * 5) % 11) - 5.0;
+            std::vector<double> expected(c.size(), 0.0);
+            gemm_ref(matmul::Trans::No, matmul::Trans::No, cs.m, cs.n, cs.k, 1.0, a, cs.k, b, cs.n, 0.0,
+                     expected, cs.n);
+
+            matmul::ForkJoinMatmul fj(spawn, matmul::dispatched_kernel(), 16, cs.cutoff);
+            fj.multiply(cs.m, cs.n, cs.k, a.data(), cs.k, b.data(), cs.n, c.data(), cs.n);
+            expect_true(fj.tasks_spawned() > 1, "fork-join should spawn nested tasks");
+            for (size_t i = 0; i < c.size(); ++i) {
+                expect_near(c[i], expected[i], 1e-8,
+                            "fork-join " + std::to_string(cs.m) + "x" + std::to_string(cs.n) + "x" +
+                                std::to_string(cs.k) + " cutoff=" + std::to_string(cs.cutoff) +
+                                " mismatch at index " + std::to_string(i));
+            }
+        }
+    }
+
+    static void matrix_storage_layout() {
+        const matmul::Matrix odd(3, 10);
+        expect_true(odd.ld() == 16 && odd.padding() == 6, "ld should round up to a cache line");
+
+        const matmul::Matrix pow2(5, 1024);
+        expect_true(pow2.ld() == 1032, "power-of-two rows should get one cache line of padding");
+        const matmul::Matrix dense(5, 1024, {matmul::PageMode::Auto, false});
+        expect_true(dense.ld() == 1024, "pad=false should keep the dense leading dimension");
+        const matmul::Matrix narrow(5, 32);
+        expect_true(narrow.ld() == 32, "rows under 512 bytes should not be padded");
+
+        for (const matmul::PageMode mode :
+             {matmul::PageMode::Small, matmul::PageMode::Thp, matmul::PageMode::HugeTlb}) {
+            matmul::Matrix m(600, 1000, {mode, true});
+            expect_true(m.data() != nullptr, std::string("allocation failed for ") + matmul::page_mode_name(mode));
+            for (size_t i = 0; i < m.rows(); ++i) {
+                expect_true(reinterpret_cast<uintptr_t>(m.row(i)) % matmul::kMatrixAlign == 0,
+                            "every row should start on a cache line");
+            }
+            expect_true(m(599, 999) == 0.0, "new storage should read as zero");
+            m(599, 999) = 1.5;
+            expect_true(m(599, 999) == 1.5, "last element should be writable");
+            if (m.backing() == matmul::PageMode::Thp) {
+                expect_true(reinterpret_cast<uintptr_t>(m.data()) % matmul::huge_page_size() == 0,
+                            "thp storage should start on a huge page boundary");
+            }
+            if (mode == matmul::PageMode::Small) {
+                expect_true(m.backing() == matmul::PageMode::Small, "small pages requested");
+            }
+
+            matmul::Matrix moved(std::move(m));
+            expect_true(m.data() == nullptr && moved(599, 999) == 1.5, "move should transfer storage");
+        }
+    }
+
+    static void matrix_parallel_init_deterministic() {
+        const size_t rows = 301, cols = 77;
+        auto serial = [](size_t count, const auto& fn) {
+            for (size_t t = 0; t < count; ++t) fn(t);
+        };
+        matmul::Matrix ref(rows, cols);
+        matmul::init_random(serial, ref, 42, rows);
+
+        bool in_range = true;
+        for (size_t i = 0; i < rows; ++i) {
+            for (size_t j = 0; j < cols; ++j) in_range = in_range && ref(i, j) >= -1.0 && ref(i, j) < 1.0;
+        }
+        expect_true(in_range, "values should lie in [-1, 1)");
+
+        for (size_t threads : {1, 3, 8}) {
+            ThreadPool pool(threads, ThreadPool::PoolKind::WorkStealing);
+            auto run = [&pool](size_t count, const auto& fn) { matmul::run_tasks(pool, count, fn); };
+            for (size_t panel : {1, 16, 64}) {
+                matmul::Matrix m(rows, cols);
+                matmul::init_random(run, m, 42, panel);
+                size_t diff = 0;
+                for (size_t i = 0; i < rows; ++i) {
+                    for (size_t j = 0; j < cols; ++j) diff += m(i, j) != ref(i, j) ? 1 : 0;
+                }
+                expect_true(diff == 0, "init differs with threads=" + std::to_string(threads) +
+                                           " panel=" + std::to_string(panel));
+            }
+        }
+
+        matmul::Matrix other(rows, cols);
+        matmul::init_random(serial, other, 43, 8);
+        expect_true(other(0, 0) != ref(0, 0) || other(1, 1) != ref(1, 1), "different seeds should differ");
+    }
+
+    static void matrix_gemm_padded_storage() {
+        const size_t m = 70, n = 256, k = 128;  // n and k rows get padded
+        matmul::Matrix a(m, k), b(k, n), c(m, n);
+        expect_true(b.padding() > 0 && a.padding() > 0, "test needs padded operands");
+        std::vector<double> ad(m * k), bd(k * n), expected(m * n, 0.0);
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t p = 0; p < k; ++p) a(i, p) = ad[i * k + p] = static_cast<double>((i * 7 + p) % 13) - 6.0;
+        }
+        for (size_t p = 0; p < k; ++p) {
+            for (size_t j = 0; j < n; ++j) b(p, j) = bd[p * n + j] = static_cast<double>((p * 5 + j) % 11) - 5.0;
+        }
+        gemm_ref(matmul::Trans::No, matmul::Trans::No, m, n, k, 1.0, ad, k, bd, n, 0.0, expected, n);
+
+        ThreadPool pool(4);
+        matmul::GemmOptions opt;
+        opt.bs = 32;
+        matmul::gemm(pool, matmul::Trans::No, matmul::Trans::No, m, n, k, 1.0, a.data(), a.ld(), b.data(), b.ld(),
+                     0.0, c.data(), c.ld(), opt);
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                expect_near(c(i, j), expected[i * n + j], 1e-9,
+                            "padded gemm mismatch at " + std::to_string(i) + "," + std::to_string(j));
+            }
+        }
+    }
+
+    static void matrix_file_ooc_gemm() {
+        const std::filesystem::path dir =
+            std::filesystem::temp_directory_path() / ("matmul_file_test_" + std::to_string(::getpid()));
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        const std::string a_path = (dir / "a.mat").string();
+        const std::string b_path = (dir / "b.mat").string();
+        const std::string c_path = (dir / "c.mat").string();
+
+        const size_t m = 70, k = 45, n = 53;  // not multiples of the panel
+        matmul::create_random_matrix_file(a_path, m, k, 12345);
+        matmul::create_random_matrix_file(b_path, k, n, 67890);
+
+        // Files hold the same values as in-memory init_random.
+        auto serial = [](size_t count, const auto& fn) {
+            for (size_t i = 0; i < count; ++i) fn(i);
+        };
+        matmul::Matrix a_mem(m, k);
+        matmul::init_random(serial, a_mem, 12345, 16);
+        const matmul::Matrix a_map = matmul::map_matrix_file(a_path);
+        expect_true(a_map.rows() == m && a_map.cols() == k && a_map.backing() == matmul::PageMode::File,
+                    "mapped file should keep its shape");
+        size_t diff = 0;
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t p = 0; p < k; ++p) diff += a_map(i, p) != a_mem(i, p) ? 1 : 0;
+        }
+        expect_true(diff == 0, "file values should match init_random");
+
+        const matmul::MatrixFile a = matmul::MatrixFile::open(a_path);
+        const matmul::MatrixFile b = matmul::MatrixFile::open(b_path);
+        std::vector<double> ad(m * k), bd(k * n), expected(m * n, 0.0);
+        a.read_block(0, m, 0, k, ad.data(), k);
+        b.read_block(0, k, 0, n, bd.data(), n);
+        gemm_ref(matmul::Trans::No, matmul::Trans::No, m, n, k, 1.0, ad, k, bd, n, 0.0, expected, n);
+
+        ThreadPool pool(3, ThreadPool::PoolKind::WorkStealing);
+        auto run = [&pool](size_t count, const auto& fn) { matmul::run_tasks(pool, count, fn); };
+        matmul::OocOptions opt;
+        opt.gemm.bs = 16;
+        opt.memory_bytes = 6 * 16 * 16 * sizeof(double);  // one BS-sized panel
+        matmul::MatrixFile c = matmul::MatrixFile::create(c_path, m, n);
+        const matmul::OocStats st = matmul::ooc_gemm(run, a, b, c, opt);
+        expect_true(st.panel == 16, "budget should limit the panel to BS");
+        expect_true(st.steps == 5 * 4 * 3, "every (i, j, k) panel triple should run once");
+        expect_true(st.bytes_written == m * n * sizeof(double), "each C element should be written once");
+
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                expect_near(c.at(i, j), expected[i * n + j], 1e-9,
+                            "ooc gemm mismatch at " + std::to_string(i) + "," + std::to_string(j));
+            }
+        }
+        std::filesystem::remove_all(dir);
+    }
+
+    template <typename T, typename Acc>
+    static void check_typed_gemm(const std::string& dtype, size_t m, size_t n, size_t k, double tol) {
+        auto serial = [](size_t count, const auto& fn) {
+            for (size_t i = 0; i < count; ++i) fn(i);
+        };
+        matmul::TypedMatrix<T> a(m, k), b(k, n);
+        matmul::init_random(serial, a, 1, 8);
+        matmul::init_random(serial, b, 2, 8);
+
+        // Reference in double from the stored (already rounded) inputs.
+        std::vector<double> expected(m * n, 0.0);
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t p = 0; p < k; ++p) {
+                const double aip = matmul::to_acc<double>(a(i, p));
+                for (size_t j = 0; j < n; ++j) expected[i * n + j] += aip * matmul::to_acc<double>(b(p, j));
+            }
+        }
+
+        ThreadPool pool(3, ThreadPool::PoolKind::WorkStealing);
+        auto run = [&pool](size_t count, const auto& fn) { matmul::run_tasks(pool, count, fn); };
+        for (const matmul::Kernel* kernel : matmul::supported_kernels()) {
+            matmul::GemmOptions opt{kernel, 16};
+            matmul::TypedMatrix<T> c(m, n);
+            matmul::gemm_typed_tasks<T, Acc>(run, m, n, k, a.data(), a.ld(), b.data(), b.ld(), c.data(), c.ld(), opt);
+            for (size_t i = 0; i < m; ++i) {
+                for (size_t j = 0; j < n; ++j) {
+                    const double want = expected[i * n + j];
+                    expect_near(matmul::to_acc<double>(c(i, j)), want, tol * std::max(1.0, std::abs(want)),
+                                dtype + " " + kernel->name + " mismatch at " + std::to_string(i) + "," +
+                                    std::to_string(j));
+                }
+            }
+        }
+    }
+
+    static void matrix_typed_gemm() {
+        for (const auto& dtype : {"double", "float", "float_dacc", "int32", "int64", "bf16"}) {
+            const auto parsed = matmul::parse_dtype(dtype);
+            expect_true(parsed && std::string(matmul::dtype_name(*parsed)) == dtype, "dtype should round-trip by name");
+        }
+        expect_true(!matmul::parse_dtype("half").has_value(), "unknown dtype should not parse");
+
+        expect_near(matmul::bf16_to_float(matmul::float_to_bf16(1.0f)), 1.0, 0.0, "bf16 keeps 1.0");
+        expect_near(matmul::bf16_to_float(matmul::float_to_bf16(-3.140625f)), -3.140625, 0.0, "bf16 keeps 8-bit mantissas");
+        expect_near(matmul::bf16_to_float(matmul::float_to_bf16(1.0f + 0x1.0p-8f)), 1.0, 0.0, "bf16 ties round to even");
+        expect_near(matmul::bf16_to_float(matmul::float_to_bf16(1.0f + 0x1.8p-8f)), 1.0 + 0x1.0p-7, 0.0,
+                    "bf16 rounds to nearest");
+
+        // 53 x 45 x 70 leaves row, column and K remainders for every register tile.
+        check_typed_gemm<float, float>("float", 53, 45, 70, 1e-5);
+        check_typed_gemm<float, double>("float_dacc", 53, 45, 70, 1e-6);
+        check_typed_gemm<int32_t, int32_t>("int32", 53, 45, 70, 0.0);
+        check_typed_gemm<int64_t, int64_t>("int64", 53, 45, 70, 0.0);
+        check_typed_gemm<matmul::bf16, float>("bf16", 53, 45, 70, 1e-2);
+
+        // int64 against the tiled int64 reference used by the pool tests.
+        const size_t n = 37;
+        std::vector<int64_t> av(n * n), bv(n * n);
+        matmul::TypedMatrix<int64_t> a(n, n), b(n, n), c(n, n);
+        for (size_t i = 0; i < n * n; ++i) {
+            a(i / n, i % n) = av[i] = static_cast<int64_t>((i * 7) % 13) - 6;
+            b(i / n, i % n) = bv[i] = static_cast<int64_t>((i * 5) % 11) - 5;
+        }
+        ThreadPool pool(2);
+        matmul::gemm_typed_tasks<int64_t, int64_t>(
+            [&pool](size_t count, const auto& fn) { matmul::run_tasks(pool, count, fn); }, n, n, n, a.data(), a.ld(),
+            b.data(), b.ld(), c.data(), c.ld(), matmul::GemmOptions{nullptr, 8});
+        std::vector<int64_t> got(n * n);
+        for (size_t i = 0; i < n * n; ++i) got[i] = c(i / n, i % n);
+        expect_matrix_eq(got, matmul_seq(n, av, bv), "typed int64 gemm");
+    }
+
+    static void matrix_freivalds_verify() {
+        auto serial = [](size_t count, const auto& fn) {
+            for (size_t i = 0; i < count; ++i) fn(i);
+        };
+        ThreadPool pool(3, ThreadPool::PoolKind::WorkStealing);
+        auto run = [&pool](size_t count, const auto& fn) { matmul::run_tasks(pool, count, fn); };
+        const size_t m = 70, n = 45, k = 53, bs = 16;
+        const matmul::VerifyOptions vopt{0.0, 16};
+
+        for (const matmul::Trans t : {matmul::Trans::No, matmul::Trans::Yes}) {
+            // op(A) is m x k and op(B) is k x n whichever way they are stored.
+            const size_t lda = t == matmul::Trans::No ? k : m;
+            const size_t ldb = t == matmul::Trans::No ? n : k;
+            std::vector<double> a(m * k), b(k * n), c(m * n, 0.0);
+            for (size_t i = 0; i < a.size(); ++i) a[i] = matmul::counter_uniform(7, i);
+            for (size_t i = 0; i < b.size(); ++i) b[i] = matmul::counter_uniform(8, i);
+            matmul::gemm_tasks(run, t, t, m, n, k, 1.0, a.data(), lda, b.data(), ldb, 0.0, c.data(), n,
+                               matmul::GemmOptions{nullptr, bs});
+
+            const auto check = [&](const std::vector<double>& got, uint64_t seed) {
+                return matmul::freivalds_verify(run, t, t, m, n, k, a.data(), lda, b.data(), ldb, got.data(), n,
+                                                seed, vopt);
+            };
+            for (uint64_t seed = 0; seed < 4; ++seed) {
+                const matmul::VerifyResult r = check(c, seed);
+                expect_true(r.ok && r.bad_rows == 0 && r.max_error <= 1.0, "correct product should verify");
+            }
+
+            // A dropped tile, a tile applied twice and a single NaN must all be caught.
+            std::vector<double> dropped = c, doubled = c, nan = c;
+            for (size_t i = 16; i < 32; ++i) {
+                for (size_t j = 16; j < 32; ++j) {
+                    dropped[i * n + j] = 0.0;
+                    doubled[i * n + j] *= 2.0;
+                }
+            }
+            nan[40 * n + 3] = std::nan("");
+            const matmul::VerifyResult rd = check(dropped, 1);
+            expect_true(!rd.ok && rd.bad_rows == 16 && rd.max_error > 1.0, "dropped tile should fail its 16 rows");
+            expect_true(!check(doubled, 2).ok, "double-applied tile should fail");
+            const matmul::VerifyResult rn = check(nan, 3);
+            expect_true(!rn.ok && rn.bad_rows == 1, "NaN in C should fail its row");
+        }
+
+        // Typed products: storage rounding of C is allowed for, a missing tile is not.
+        matmul::TypedMatrix<float> af(m, k), bf(k, n), cf(m, n);
+        matmul::init_random(serial, af, 1, 8);
+        matmul::init_random(serial, bf, 2, 8);
+        matmul::gemm_typed_tasks<float, float>(run, m, n, k, af.data(), af.ld(), bf.data(), bf.ld(), cf.data(),
+                                               cf.ld(), matmul::GemmOptions{nullptr, bs});
+        expect_true(matmul::freivalds_verify(run, matmul::Trans::No, matmul::Trans::No, m, n, k, af.data(), af.ld(),
+                                             bf.data(), bf.ld(), cf.data(), cf.ld(), 5, vopt)
+                        .ok,
+                    "float product should verify");
+
+        matmul::TypedMatrix<matmul::bf16> ah(m, k), bh(k, n), ch(m, n);
+        matmul::init_random(serial, ah, 1, 8);
+        matmul::init_random(serial, bh, 2, 8);
+        matmul::gemm_typed_tasks<matmul::bf16, float>(run, m, n, k, ah.data(), ah.ld(), bh.data(), bh.ld(),
+                                                      ch.data(), ch.ld(), matmul::GemmOptions{nullptr, bs});
+        const auto check_bf16 = [&](uint64_t seed) {
+            return matmul::freivalds_verify(run, matmul::Trans::No, matmul::Trans::No, m, n, k, ah.data(), ah.ld(),
+                                            bh.data(), bh.ld(), ch.data(), ch.ld(), seed, vopt);
+        };
+        expect_true(check_bf16(6).ok, "bf16 product should verify");
+        for (size_t i = 0; i < bs; ++i) {
+            for (size_t j = 0; j < bs; ++j) ch(i, j) = matmul::float_to_bf16(0.0f);
+        }
+        expect_true(!check_bf16(7).ok, "bf16 product with a dropped tile should fail");
+    }
+
+    static void matrix_chain_dag() {
+        // Textbook instance: 15125 multiply-adds.
+        const matmul::ChainPlan textbook = matmul::plan_chain({30, 35, 15, 5, 10, 20, 25});
+        expect_near(textbook.flops, 2.0 * 15125, 0.0, "matrix-chain cost");
+        expect_true(matmul::describe_chain(textbook) == "((M0 (M1 M2)) ((M3 M4) M5))", "matrix-chain split");
+        expect_true(matmul::describe_chain(matmul::plan_chain({8, 8, 8, 8})) == "((M0 M1) M2)",
+                    "ties evaluate left to right");
+
+        ThreadPool pool(3, ThreadPool::PoolKind::WorkStealing);
+        auto run = [&pool](size_t count, const auto& fn) { matmul::run_tasks(pool, count, fn); };
+        auto spawn = [&pool](std::function<void()> fn) { pool.submit(std::move(fn)); };
+
+        // Ragged sizes against BS 16, and plans that nest on both sides.
+        const std::vector<std::vector<size_t>> chains = {{37}, {37, 21}, {53, 20, 70}, {45, 70, 9, 61, 33},
+                                                         {10, 60, 50, 3, 80, 17}};
+        for (const std::vector<size_t>& p : chains) {
+            const size_t dims = p.size() == 1 ? 2 : p.size();
+            const std::vector<size_t> q = p.size() == 1 ? std::vector<size_t>{p[0], p[0]} : p;
+            std::vector<matmul::Matrix> factors;
+            std::vector<matmul::ExprOperand> operands;
+            for (size_t f = 0; f + 1 < dims; ++f) {
+                factors.emplace_back(q[f], q[f + 1]);
+                matmul::init_random(run, factors.back(), 100 + f, 8);
+            }
+            for (const matmul::Matrix& f : factors) operands.push_back(matmul::expr_operand(f));
+            matmul::Matrix d(q.front(), q.back());
+            matmul::init_random(run, d, 7, 8);
+
+            // Reference: left to right in plain loops, then + D.
+            std::vector<double> acc(factors[0].rows() * factors[0].cols());
+            for (size_t i = 0; i < factors[0].rows(); ++i) {
+                for (size_t j = 0; j < factors[0].cols(); ++j) acc[i * factors[0].cols() + j] = factors[0](i, j);
+            }
+            size_t cols = factors[0].cols();
+            for (size_t f = 1; f < factors.size(); ++f) {
+                const size_t next_cols = factors[f].cols();
+                std::vector<double> next(q.front() * next_cols, 0.0);
+                for (size_t i = 0; i < q.front(); ++i) {
+                    for (size_t k = 0; k < cols; ++k) {
+                        for (size_t j = 0; j < next_cols; ++j) next[i * next_cols + j] += acc[i * cols + k] * factors[f](k, j);
+                    }
+                }
+                acc.swap(next);
+                cols = next_cols;
+            }
+
+            const std::string name = "chain of " + std::to_string(factors.size());
+            for (const bool add : {false, true}) {
+                matmul::MatrixExpr e = matmul::MatrixExpr::product(operands);
+                if (add) e.plus(matmul::expr_operand(d));
+                matmul::Matrix dag_out(q.front(), q.back()), barrier_out(q.front(), q.back());
+                matmul::ExprDag dag(spawn, matmul::dispatched_kernel(), 16);
+                for (int rep = 0; rep < 3; ++rep) dag.evaluate(e, dag_out.data(), dag_out.ld());
+                matmul::ExprBuffers buffers;
+                matmul::evaluate_expr_barrier(run, e, barrier_out.data(), barrier_out.ld(), buffers,
+                                              matmul::GemmOptions{nullptr, 16});
+                for (size_t i = 0; i < q.front(); ++i) {
+                    for (size_t j = 0; j < q.back(); ++j) {
+                        const double want = acc[i * q.back() + j] + (add ? d(i, j) : 0.0);
+                        expect_near(dag_out(i, j), want, 1e-9, name + " dag mismatch");
+                        expect_near(barrier_out(i, j), want, 1e-9, name + " barrier mismatch");
+                    }
+                }
+                expect_true(matmul::freivalds_verify_expr(run, e, dag_out.data(), dag_out.ld(), 3).ok,
+                            name + " should verify");
+                dag_out(q.front() - 1, 0) += 1.0;
+                expect_true(!matmul::freivalds_verify_expr(run, e, dag_out.data(), dag_out.ld(), 4).ok,
+                            name + " perturbed output should fail verification");
+            }
+        }
+
+        // Zero inner dimension: the product is zero and the result is D.
+        {
+            std::vector<double> a0(4, 1.0), b0(4, 1.0), c0(16, 1.0), d0(16, 2.5);
+            matmul::MatrixExpr e = matmul::MatrixExpr::product(
+                {{a0.data(), 4, 0, 1}, {b0.data(), 0, 4, 4}, {c0.data(), 4, 4, 4}});
+            for (const bool add : {false, true}) {
+                if (add) e.plus({d0.data(), 4, 4, 4});
+                std::vector<double> dag_out(16, -1.0), barrier_out(16, -1.0);
+                matmul::ExprDag dag(spawn, matmul::dispatched_kernel(), 16);
+                dag.evaluate(e, dag_out.data(), 4);
+                matmul::ExprBuffers buffers;
+                matmul::evaluate_expr_barrier(run, e, barrier_out.data(), 4, buffers, matmul::GemmOptions{nullptr, 16});
+                for (size_t i = 0; i < 16; ++i) {
+                    expect_near(dag_out[i], add ? 2.5 : 0.0, 0.0, "zero inner dimension dag result");
+                    expect_near(barrier_out[i], add ? 2.5 : 0.0, 0.0, "zero inner dimension barrier result");
+                }
+            }
+        }
+
+        bool threw = false;
+        try {
+            matmul::Matrix a(4, 5), b(6, 4);
+            (void)matmul::MatrixExpr::product({matmul::expr_operand(a), matmul::expr_operand(b)});
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        expect_true(threw, "mismatched inner dimensions should throw");
+    }
+
+    static void check_csr_structure(const matmul::CsrMatrix& a, const std::string& what) {
+        expect_true(a.row_ptr.size() == a.rows + 1 && a.row_ptr[0] == 0, what + " row_ptr shape");
+        expect_true(a.col.size() == a.nnz() && a.val.size() == a.nnz(), what + " arrays sized by nnz");
+        for (size_t i = 0; i < a.rows; ++i) {
+            for (size_t p = a.row_ptr[i]; p < a.row_ptr[i + 1]; ++p) {
+                expect_true(a.col[p] < a.cols, what + " column in range");
+                expect_true(p == a.row_ptr[i] || a.col[p - 1] < a.col[p], what + " columns strictly increasing");
+            }
+        }
+    }
+
+    static void check_partition(const matmul::CsrMatrix& a, const std::vector<size_t>& bounds, const std::string& what) {
+        expect_true(bounds.size() >= 2 && bounds.front() == 0 && bounds.back() == a.rows, what + " covers all rows");
+        for (size_t p = 0; p + 1 < bounds.size(); ++p) {
+            expect_true(bounds[p] < bounds[p + 1], what + " ranges are non-empty and ordered");
+        }
+    }
+
+    static void sparse_csr_matches_dense() {
+        ThreadPool pool(3, ThreadPool::PoolKind::WorkStealing);
+        auto run = [&pool](size_t count, const auto& fn) { matmul::run_tasks(pool, count, fn); };
+
+        const matmul::CsrMatrix band = matmul::make_banded_csr(run, 50, 3, 1);
+        check_csr_structure(band, "banded");
+        expect_true(band.row_nnz(0) == 4 && band.row_nnz(25) == 7 && band.row_nnz(49) == 4, "band widths at edges");
+        expect_true(band.col[band.row_ptr[25]] == 22, "band starts at i - half_bandwidth");
+
+        const matmul::CsrMatrix pl = matmul::make_powerlaw_csr(run, 300, 200, 12.0, 1.5, 7);
+        check_csr_structure(pl, "powerlaw");
+        const matmul::CsrMatrix pl_again = matmul::make_powerlaw_csr(run, 300, 200, 12.0, 1.5, 7);
+        expect_true(pl.col == pl_again.col && pl.val == pl_again.val, "powerlaw generator is deterministic");
+        const matmul::CsrMatrix sorted = matmul::make_powerlaw_csr(run, 300, 200, 12.0, 1.5, 7, true);
+        check_csr_structure(sorted, "sorted powerlaw");
+        for (size_t i = 1; i < sorted.rows; ++i) {
+            expect_true(sorted.row_nnz(i - 1) >= sorted.row_nnz(i), "sorted powerlaw rows are heaviest first");
+        }
+
+        // Equal nonzeros beat equal rows when the heavy rows are clustered.
+        const std::vector<size_t> by_rows = matmul::partition_by_rows(sorted.rows, 8);
+        const std::vector<size_t> by_nnz = matmul::partition_by_nnz(sorted, 8);
+        check_partition(sorted, by_rows, "row partition");
+        check_partition(sorted, by_nnz, "nnz partition");
+        expect_true(matmul::partition_imbalance(sorted, by_nnz) < matmul::partition_imbalance(sorted, by_rows),
+                    "nnz partition should be better balanced");
+        check_partition(band, matmul::partition_by_nnz(band, 1000), "over-split partition");
+
+        // Symmetric file with a comment, a duplicate entry and an off-diagonal mirror.
+        const std::string path = "/tmp/sparse_unit_" + std::to_string(::getpid()) + ".mtx";
+        {
+            std::ofstream out(path);
+            out << "%%MatrixMarket matrix coordinate real symmetric\n% test\n4 4 5\n"
+                << "1 1 2.0\n3 1 -1.5\n4 4 1.0\n4 4 0.5\n4 2 3.0\n";
+        }
+        const matmul::CsrMatrix mm = matmul::load_matrix_market(path);
+        std::filesystem::remove(path);
+        check_csr_structure(mm, "matrix market");
+        expect_true(mm.rows == 4 && mm.cols == 4 && mm.nnz() == 6, "symmetric entries mirrored, duplicates merged");
+        expect_near(mm.val[mm.row_ptr[3] + 1], 1.5, 0.0, "duplicate entries are summed");
+        expect_near(mm.val[mm.row_ptr[0] + 1], -1.5, 0.0, "lower entry mirrored to upper triangle");
+
+        for (const matmul::CsrMatrix* a : {&band, &pl, &sorted, &mm}) {
+            std::vector<double> dense(a->rows * a->cols, 0.0);
+            for (size_t i = 0; i < a->rows; ++i) {
+                for (size_t p = a->row_ptr[i]; p < a->row_ptr[i + 1]; ++p) dense[i * a->cols + a->col[p]] = a->val[p];
+            }
+            const size_t n = 5, ldb = 7;
+            std::vector<double> b(a->cols * ldb), x(a->cols);
+            for (size_t i = 0; i < b.size(); ++i) b[i] = matmul::counter_uniform(3, i);
+            for (size_t i = 0; i < x.size(); ++i) x[i] = matmul::counter_uniform(4, i);
+
+            for (const matmul::SparsePartition how : {matmul::SparsePartition::Rows, matmul::SparsePartition::Nnz}) {
+                const std::vector<size_t> bounds = matmul::partition_csr(*a, how, 6);
+                std::vector<double> y(a->rows, -1.0), c(a->rows * n, -1.0);
+                matmul::spmv_tasks(run, *a, bounds, x.data(), y.data());
+                matmul::spmm_tasks(run, *a, bounds, b.data(), ldb, n, c.data(), n);
+                for (size_t i = 0; i < a->rows; ++i) {
+                    double want = 0.0;
+                    for (size_t k = 0; k < a->cols; ++k) want += dense[i * a->cols + k] * x[k];
+                    expect_near(y[i], want, 1e-12, "spmv row " + std::to_string(i));
+                    for (size_t j = 0; j < n; ++j) {
+                        double want_c = 0.0;
+                        for (size_t k = 0; k < a->cols; ++k) want_c += dense[i * a->cols + k] * b[k * ldb + j];
+                        expect_near(c[i * n + j], want_c, 1e-12, "spmm element " + std::to_string(i));
+                    }
+                }
+            }
+        }
+    }
+
+    static void matrix_fixed_matches_reference() {
+        for (const matmul::FixedSize& fs : matmul::kFixedSizes) {
+            const size_t n = fs.n;
+            std::vector<double> a(n * n), b(n * n), expected(n * n, 0.0);
+            for (size_t i = 0; i < n * n; ++i) {
+                a[i] = static_cast<double>((i * 7) % 13) - 6.0;
+                b[i] = static_cast<double>((i * 5) % 11) - 5.0;
+            }
+            gemm_ref(matmul::Trans::No, matmul::Trans::No, n, n, n, 1.0, a, n, b, n, 0.0, expected, n);
+
+            for (const matmul::Kernel* k : matmul::supported_kernels()) {
+                const cpu::Isa isa = *cpu::parse_isa(k->name);
+                const matmul::FixedKernelFn fn = matmul::find_fixed_kernel(n, fs.bs, isa);
+                expect_true(fn != nullptr, "listed fixed size should be found");
+                std::vector<double> c(n * n, 7.0);  // must be overwritten, not accumulated
+                fn(a.data(), b.data(), c.data());
+                for (size_t i = 0; i < c.size(); ++i) {
+                    expect_near(c[i], expected[i], 1e-9,
+                                "fixed N=" + std::to_string(n) + " BS=" + std::to_string(fs.bs) + " " +
+                                    k->name + " mismatch at index " + std::to_string(i));
+                }
+            }
+        }
+        expect_true(matmul::find_fixed_kernel(40, 16, cpu::Isa::Portable) == nullptr,
+                    "unlisted size should fall back to the generic kernel");
+    }
+
+    static void matrix_nested_tasks_from_saturated_pool() {
+        // Every worker of a fixed pool is an outer task that fans out again;
+        // plain run_tasks would wait on helpers queued behind itself forever.
+        const size_t workers = 2, count = 97;
+        ThreadPool pool(workers);
+        std::vector<std::vector<std::atomic<int>>> hits(workers);
+        for (auto& h : hits) h = std::vector<std::atomic<int>>(count);
+        std::mutex m;
+        std::condition_variable cv;
+        size_t finished = 0;
+        for (size_t w = 0; w < workers; ++w) {
+            pool.submit([&, w] {
+                (void)matmul::run_tasks_nested(pool, count, 4, [&](size_t t) {
+                    hits[w][t].fetch_add(1, std::memory_order_relaxed);
+                });
+                std::lock_guard<std::mutex> lk(m);
+                ++finished;
+                cv.notify_one();
+            });
+        }
+        {
+            std::unique_lock<std::mutex> lk(m);
+            expect_true(cv.wait_for(lk, std::chrono::seconds(10), [&] { return finished == workers; }),
+                        "nested run_tasks from saturated pool did not finish");
+        }
+        for (size_t w = 0; w < workers; ++w) {
+            for (size_t t = 0; t < count; ++t) {
+                expect_true(hits[w][t].load() == 1, "nested index not run exactly once");
+            }
+        }
+
+        size_t serial = 0;
+        expect_true(matmul::run_tasks_nested(pool, 5, 1, [&](size_t) { ++serial; }) == 0 && serial == 5,
+                    "one lane must run inline");
+    }
+
+    static void matrix_batched_matches_reference() {
+        // 11 is not a multiple of the register column block, and 13 products
+        // leave a partially filled lane group.
+        const size_t n = 11;
+        const size_t products = 13;
+        std::vector<std::vector<double>> as(products), bs(products), expected(products);
+        for (size_t p = 0; p < products; ++p) {
+            as[p].resize(n * n);
+            bs[p].resize(n * n);
+            for (size_t i = 0; i < n * n; ++i) {
+                as[p][i] = static_cast<double>((i * 7 + p * 3) % 13) - 6.0;
+                bs[p][i] = static_cast<double>((i * 5 + p) % 11) - 5.0;
+            }
+            expected[p].assign(n * n, 0.0);
+            gemm_ref(matmul::Trans::No, matmul::Trans::No, n, n, n, 1.0, as[p], n, bs[p], n, 0.0,
+                     expected[p], n);
+        }
+
+        // Two workers and 13 blocking submitters: the batches only finish if
+        // waiting submitters compute lane groups themselves.
+        // The engine is declared last, so it is destroyed first and waits for
+        // its posted group tasks while the pool is still running.
+        ThreadPool pool(2);
+        matmul::BatchedMatmul engine(n, std::chrono::microseconds(2000), 8, 0,
+                                     [&pool](std::function<void()> fn) { pool.submit(std::move(fn)); });
+        std::mutex m;
+        std::condition_variable cv;
+        size_t done = 0;
+        size_t mismatches = 0;
+        for (size_t p = 0; p < products; ++p) {
+            pool.submit([&, p] {
+                std::atomic<bool> mine{false};
+                engine.submit(as[p].data(), bs[p].data(), 1, [&, p](const matmul::BatchView& v) {
+                    size_t bad = 0;
+                    for (size_t i = 0; i < n; ++i) {
+                        for (size_t j = 0; j < n; ++j) {
+                            if (std::fabs(v.at(i, j) - expected[p][ridx(n, i, j)]) > 1e-9) ++bad;
+                        }
+                    }
+                    {
+                        std::lock_guard<std::mutex> lk(m);
+                        mismatches += bad;
+                    }
+                    mine.store(true);
+                });
+                engine.help_until([&] { return mine.load(); });
+                // Counted only once the submitter is out of the engine, so
+                // the engine is not destroyed under a helper.
+                std::lock_guard<std::mutex> lk(m);
+                ++done;
+                cv.notify_one();
+            });
+        }
+        {
+            std::unique_lock<std::mutex> lk(m);
+            cv.wait(lk, [&] { return done == products; });
+        }
+        expect_true(mismatches == 0, "batched products mismatch reference");
+
+        const matmul::BatchedMatmul::Stats st = engine.stats();
+        expect_true(st.items == products, "every product should go through a batch");
+        expect_true(st.batches >= 2 && st.batches <= products, "max_batch=8 should need at least two batches");
+    }
+
+    static void cpu_dispatch_overrides() {
+        cpu::Features sse_only;
+        sse_only.sse2 = true;
+
+        const cpu::Dispatch unset = cpu::make_dispatch(sse_only, nullptr);
+        expect_true(unset.isa == cpu::Isa::Sse2 && !unset.forced, "unset override should pick best ISA");
+
+        const cpu::Dispatch down = cpu::make_dispatch(sse_only, "portable");
+        expect_true(down.isa == cpu::Isa::Portable && down.forced, "supported override should be honored");
+
+        const cpu::Dispatch up = cpu::make_dispatch(sse_only, "avx512");
+        expect_true(up.isa == cpu::Isa::Sse2 && !up.forced, "unsupported override should fall back");
+
+        const cpu::Dispatch bogus = cpu::make_dispatch(sse_only, "neon");
+        expect_true(bogus.isa == cpu::Isa::Sse2 && !bogus.forced, "unknown override should fall back");
+
+        expect_true(std::string(matmul::kernel_for(cpu::Isa::Portable).name) == "portable",
+                    "portable ISA should map to the portable kernel");
+    }
+
+    static void matmul_tuning_cache_round_trip() {
+        const std::filesystem::path dir =
+            std::filesystem::temp_directory_path() / ("matmul_tuning_test_" + std::to_string(::getpid()));
+        const std::string path = (dir / "tuning.csv").string();
+        std::filesystem::remove_all(dir);
+
+        const matmul::TuningKey ws8 = matmul::make_tuning_key(512, "ws", 8);
+        const matmul::TuningKey ws4 = matmul::make_tuning_key(512, "ws", 4);
+        expect_true(!matmul::load_tuned(path, ws8).has_value(), "missing cache should load nothing");
+
+        expect_true(matmul::store_tuned(path, ws8, {96, "portable", 12.5}), "store should create the cache");
+        expect_true(matmul::store_tuned(path, ws4, {64, "portable", 7.0}), "store should append a second key");
+        expect_true(matmul::store_tuned(path, ws8, {128, "portable", 13.0}), "store should replace an entry");
+
+        const auto got8 = matmul::load_tuned(path, ws8);
+        const auto got4 = matmul::load_tuned(path, ws4);
+        expect_true(got8.has_value() && got8->bs == 128 && got8->kernel == "portable",
+                    "replaced entry should load");
+        expect_true(got4.has_value() && got4->bs == 64, "other key should be untouched");
+        expect_true(!matmul::load_tuned(path, matmul::make_tuning_key(256, "ws", 8)).has_value(),
+                    "different N should miss");
+
+        const auto winner = matmul::autotune(
+            64, {&matmul::portable_kernel()},
+            [](const matmul::Kernel&, size_t bs) { return bs == 32 ? 1e-4 : 1e-3; }, nullptr);
+        expect_true(winner.bs == 32 && winner.kernel == "portable", "autotune should pick the fastest candidate");
+        const auto fallback = matmul::autotune(
+            64, {&matmul::portable_kernel()}, [](const matmul::Kernel&, size_t) { return 0.0; }, nullptr);
+        expect_true(fallback.bs == 16 && fallback.kernel == "portable",
+                    "autotune without usable timings should fall back to the first candidate");
+
+        std::filesystem::remove_all(dir);
+    }
+
     static void fibonacci_iterative_known_values() {
         const std::vector<std::pair<unsigned, uint64_t>> cases = {
             {0U, 0U}, {1U, 1U}, {2U, 1U}, {3U, 2U}, {10U, 55U}, {20U, 6765U}, {40U, 102334155U}
@@ -295,6 +1312,49 @@ private:
         }
     }
 
+    static void fibonacci_bigint_matches_reference() {
+        // F(100) = 354224848179261915075 = 19 * 2^64 + 3736710778780434371.
+        const bigint::Natural f100 = bigint::fib_serial(100);
+        expect_true(f100.size() == 2 && f100[1] == 19U && f100[0] == 3736710778780434371ULL, "F(100) limbs");
+        for (unsigned n : {0U, 1U, 2U, 44U, 93U}) {
+            const bigint::Natural f = bigint::fib_serial(n);
+            expect_eq_u64(f.empty() ? 0 : f[0], fib_seq(n), "big F(" + std::to_string(n) + ")");
+            expect_true(f.size() <= 1, "big F(" + std::to_string(n) + ") fits one limb");
+        }
+
+        // Karatsuba against schoolbook on all-ones limbs (maximal carries) and
+        // mixed values, across the base case and odd splits.
+        for (size_t n : {1UL, 31UL, 33UL, 65UL, 130UL, 257UL}) {
+            for (int pattern = 0; pattern < 2; ++pattern) {
+                bigint::Natural a(n), b(n);
+                for (size_t i = 0; i < n; ++i) {
+                    a[i] = pattern == 0 ? ~0ULL : matmul::mix64(2 * i + 1);
+                    b[i] = pattern == 0 ? ~0ULL : matmul::mix64(2 * i + 2);
+                }
+                bigint::Natural want(2 * n), got(2 * n);
+                bigint::mul_basecase(want.data(), a.data(), n, b.data(), n);
+                bigint::mul_karatsuba(got.data(), a.data(), b.data(), n);
+                expect_true(got == want, "karatsuba mismatch at n=" + std::to_string(n));
+            }
+        }
+
+        // Parallel products (small task cutoff, so nodes fork several levels
+        // deep) must match the serial result, checked again modulo 2^61 - 1.
+        const uint64_t n = 30011;
+        const bigint::Natural serial = bigint::fib_serial(n);
+        for (const ThreadPool::PoolKind kind : {ThreadPool::PoolKind::ClassicFixed, ThreadPool::PoolKind::WorkStealing}) {
+            ThreadPool pool(3, kind);
+            bigint::ParallelMultiplier par([&pool](std::function<void()> fn) { pool.submit(std::move(fn)); }, 40);
+            const bigint::Natural got =
+                bigint::fib(n, [&par](std::vector<bigint::MulJob>& jobs) { par.multiply(jobs); });
+            expect_true(got == serial, "parallel big fibonacci mismatch");
+            expect_true(par.tasks_spawned() > 3 * 15, "parallel big fibonacci should fork sub-products");
+        }
+        const uint64_t p = (1ULL << 61) - 1;
+        expect_eq_u64(bigint::mod(serial, p), bigint::fib_mod(n, p), "big F(n) mod 2^61-1");
+        expect_true(bigint::bit_length(serial) == 20834, "F(30011) bit length");
+    }
+
     static void fibonacci_pool_batch_checksum() {
         constexpr unsigned n = 30U;
         constexpr size_t tasks = 20U;
@@ -329,6 +1389,64 @@ private:
                       static_cast<int64_t>(tasks),
                       "parallel fibonacci completion count mismatch");
     }
+
+    static void bench_harness_stats_and_records() {
+        // Sorted {1, 2, 3, 4, 100}: deviations from the median 3 are {0, 1, 1, 2, 97}.
+        const bench::Stats st = bench::summarize({4.0, 100.0, 1.0, 3.0, 2.0});
+        expect_eq_u64(st.n, 5U, "stats count");
+        expect_near(st.best, 1.0, 1e-12, "stats best");
+        expect_near(st.mean, 22.0, 1e-12, "stats mean");
+        expect_near(st.median, 3.0, 1e-12, "stats median");
+        expect_near(st.mad, 1.0, 1e-12, "stats MAD");
+        expect_near(st.p5, 1.2, 1e-12, "stats p5");
+        expect_near(st.p95, 80.8, 1e-12, "stats p95");
+        expect_near(st.ci95, 49.5, 1e-12, "five runs: median interval is the whole range");
+
+        std::ostringstream sink;
+        std::vector<int> seen;
+        bench::RepeatOptions fixed;
+        fixed.warmup = 2;
+        fixed.min_reps = fixed.max_reps = 4;
+        bench::Samples s = bench::repeat(fixed, [&](int rep) {
+            seen.push_back(rep);
+            return 1.0;
+        }, sink);
+        expect_true(s.runs.size() == 4 && s.stop == "reps", "fixed reps");
+        expect_true(seen == std::vector<int>({-1, -1, 0, 1, 2, 3}), "warmup reps see -1, timed reps their index");
+
+        bench::RepeatOptions adaptive;
+        adaptive.warmup = 0;
+        adaptive.min_reps = 2;
+        adaptive.max_reps = 6;
+        adaptive.target_rel_ci = 0.01;
+        s = bench::repeat(adaptive, [] { return 1.0; }, sink);
+        expect_true(s.runs.size() == 3 && s.stop == "ci", "steady timings stop once the interval is tight");
+        int i = 0;
+        s = bench::repeat(adaptive, [&] { return (i++ % 2) ? 2.0 : 1.0; }, sink);
+        expect_true(s.runs.size() == 6 && s.stop == "max_reps", "bimodal timings run to max_reps");
+
+        bool ran = false;
+        expect_true(!bench::with_pool("bogus", 2, [&](ThreadPool&) { ran = true; }) && !ran, "unknown mode");
+        expect_true(bench::with_pool("coro", 2, [&](ThreadPool&) { ran = true; }) && ran, "coro mode builds a pool");
+
+        const std::string path =
+            (std::filesystem::temp_directory_path() / ("bench_harness_" + std::to_string(::getpid()) + ".csv")).string();
+        std::filesystem::remove(path);
+        ::setenv("BENCH_CSV", path.c_str(), 1);
+        bench::Report report("fib", "ws", 4);
+        report.param("fib_n", 30).metric("checksum", uint64_t{832040}).metric("note", "a,\"b\"");
+        const bool written = report.finish(s, sink) && report.finish(s, sink);
+        ::unsetenv("BENCH_CSV");
+        std::ifstream in(path);
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(in, line);) lines.push_back(line);
+        std::filesystem::remove(path);
+        expect_true(written && lines.size() == 3, "header once, then one row per record");
+        expect_true(lines[0] == bench::Report::csv_header(), "CSV header");
+        expect_true(lines[1].rfind("\"fib\",\"ws\",\"4\",\"0\",\"6\",\"max_reps\",", 0) == 0, "CSV row prefix");
+        expect_true(lines[1].find("\"fib_n=30\",\"checksum=832040;note=a,\"\"b\"\"\"") != std::string::npos,
+                    "packed params and metrics, quotes doubled");
+    }
 };
 
 }  // namespace
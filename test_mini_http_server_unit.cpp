@@ -116,6 +116,7 @@ public:
         suite.add("handle_connection rejects non-GET", handle_non_get_returns_400);
         suite.add("handle_connection returns 404 for unknown route", handle_unknown_route_returns_404);
         suite.add("handle_connection returns work JSON", handle_work_returns_json_200);
+        suite.add("handle_connection returns metrics JSON", handle_metrics_returns_json_200);
     }
 
 private:
@@ -201,6 +202,20 @@ private:
         expect_contains(resp, "\"cpu2_us\":0", "missing cpu2_us field");
         expect_contains(resp, "\"total_us\":", "missing total_us field");
     }
+
+    static void handle_metrics_returns_json_200() {
+        const std::string req =
+            "GET /metrics HTTP/1.1\r\n"
+            "Host: localhost\r\n"
+            "\r\n";
+        const std::string resp = run_request_through_handler(req);
+        expect_contains(resp, "HTTP/1.1 200 OK\r\n", "expected 200 for /metrics");
+        expect_contains(resp, "\"endpoint\":\"/metrics\"", "missing endpoint field");
+        expect_contains(resp, std::string("\"isa\":\"") + cpu::isa_name(cpu::selected_isa()) + "\"",
+                        "metrics should report the dispatched ISA");
+        expect_contains(resp, "\"requests_total\":", "missing requests_total field");
+        expect_contains(resp, "\"work_requests_total\":", "missing work_requests_total field");
+    }
 };
 
 }  // namespace
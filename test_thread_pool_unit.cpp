@@ -84,6 +84,7 @@ public:
         suite.add("work stealing executes nested submissions", ws_nested_submissions);
         suite.add("elastic global executes burst workload", elastic_burst_executes_all);
         suite.add("advanced elastic stealing executes nested workload", advanced_nested_executes_all);
+        suite.add("spawn hint follows queued work", should_spawn_tracks_queued_work);
     }
 
 private:
@@ -198,6 +199,32 @@ private:
         }
         expect_true(done.load(std::memory_order_relaxed) == expected, "advanced pool task count mismatch");
     }
+
+    static void should_spawn_tracks_queued_work() {
+        for (const ThreadPool::PoolKind kind : {ThreadPool::PoolKind::ClassicFixed, ThreadPool::PoolKind::WorkStealing}) {
+            const std::string name = kind == ThreadPool::PoolKind::WorkStealing ? "ws" : "classic";
+            ThreadPool pool(1, kind);
+            expect_true(pool.should_spawn(100), name + ": callers outside the pool must spawn");
+
+            // Single worker: nothing else can drain the queue while the task runs.
+            std::atomic<int> state{0};  // bit 0: empty queue spawns, bit 1: full queue inlines, bit 2: done
+            std::atomic<int> ran{0};
+            pool.submit([&] {
+                int bits = pool.should_spawn(100) ? 1 : 0;
+                for (int i = 0; i < 3; ++i) {
+                    pool.submit([&ran] { ran.fetch_add(1, std::memory_order_relaxed); });
+                }
+                if (!pool.should_spawn(100) && !pool.should_spawn(0)) bits |= 2;
+                state.store(bits | 4, std::memory_order_release);
+            });
+            expect_true(
+                wait_until([&] { return state.load(std::memory_order_acquire) != 0 && ran.load() == 3; },
+                           std::chrono::milliseconds(3000)),
+                name + ": spawn hint tasks did not finish in time");
+            expect_true((state.load() & 1) != 0, name + ": empty queue should ask for a spawn");
+            expect_true((state.load() & 2) != 0, name + ": queued work should run inline");
+        }
+    }
 };
 
 int main() {
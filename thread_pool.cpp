@@ -1,5 +1,6 @@
 #include "thread_pool.h"
 
+#include <algorithm>
 #include <stdexcept>
 
 namespace {
@@ -132,6 +133,7 @@ void ThreadPool::submit(std::function<void()> task) {
             {
                 std::lock_guard<std::mutex> lk(ws_queues_[static_cast<size_t>(wid)]->m);
                 ws_queues_[static_cast<size_t>(wid)]->dq.emplace_front(std::move(task));
+                ws_queues_[static_cast<size_t>(wid)]->size.fetch_add(1, std::memory_order_relaxed);
             }
             ws_queued_tasks_.fetch_add(1, std::memory_order_release);
             ws_cv_.notify_one();
@@ -146,6 +148,7 @@ void ThreadPool::submit(std::function<void()> task) {
             {
                 std::lock_guard<std::mutex> lk(ws_queues_[idx]->m);
                 ws_queues_[idx]->dq.emplace_back(std::move(task));
+                ws_queues_[idx]->size.fetch_add(1, std::memory_order_relaxed);
             }
             ws_queued_tasks_.fetch_add(1, std::memory_order_release);
 
@@ -174,6 +177,7 @@ void ThreadPool::submit(std::function<void()> task) {
         }
 
         task_queue_.push(std::move(task));
+        global_queued_.fetch_add(1, std::memory_order_relaxed);
 
         if (kind_ == PoolKind::ElasticGlobal && idle_threads_ == 0 && active_threads_ < max_threads_) {
             ++active_threads_;
@@ -189,12 +193,15 @@ void ThreadPool::submit(std::function<void()> task) {
 }
 
 void ThreadPool::worker_global_fixed() {
+    tls_pool = this;
     while (true) {
         std::function<void()> task;
 
         {
             std::unique_lock<std::mutex> lock(queue_mutex_);
+            global_idle_.fetch_add(1, std::memory_order_relaxed);
             queue_cv_.wait(lock, [&] { return stop_.load(std::memory_order_acquire) || !task_queue_.empty(); });
+            global_idle_.fetch_sub(1, std::memory_order_relaxed);
 
             if (stop_.load(std::memory_order_acquire) && task_queue_.empty()) {
                 --active_threads_;
@@ -203,6 +210,7 @@ void ThreadPool::worker_global_fixed() {
 
             task = std::move(task_queue_.front());
             task_queue_.pop();
+            global_queued_.fetch_sub(1, std::memory_order_relaxed);
         }
 
         task();
@@ -210,16 +218,19 @@ void ThreadPool::worker_global_fixed() {
 }
 
 void ThreadPool::worker_global_elastic() {
+    tls_pool = this;
     while (true) {
         std::function<void()> task;
 
         {
             std::unique_lock<std::mutex> lock(queue_mutex_);
             ++idle_threads_;
+            global_idle_.fetch_add(1, std::memory_order_relaxed);
             const bool woke = queue_cv_.wait_for(lock, idle_timeout_, [&] {
                 return stop_.load(std::memory_order_acquire) || !task_queue_.empty();
             });
             --idle_threads_;
+            global_idle_.fetch_sub(1, std::memory_order_relaxed);
 
             if (stop_.load(std::memory_order_acquire) && task_queue_.empty()) {
                 --active_threads_;
@@ -237,6 +248,7 @@ void ThreadPool::worker_global_elastic() {
 
             task = std::move(task_queue_.front());
             task_queue_.pop();
+            global_queued_.fetch_sub(1, std::memory_order_relaxed);
         }
 
         task();
@@ -252,6 +264,7 @@ bool ThreadPool::pop_local_ws(size_t worker_id, std::function<void()>& out) {
 
     out = std::move(q.dq.front());
     q.dq.pop_front();
+    q.size.fetch_sub(1, std::memory_order_relaxed);
     ws_queued_tasks_.fetch_sub(1, std::memory_order_acq_rel);
     return true;
 }
@@ -273,6 +286,7 @@ bool ThreadPool::steal_from_others_ws(size_t thief_id, std::function<void()>& ou
 
         out = std::move(q.dq.back());
         q.dq.pop_back();
+        q.size.fetch_sub(1, std::memory_order_relaxed);
         ws_queued_tasks_.fetch_sub(1, std::memory_order_acq_rel);
         return true;
     }
@@ -307,6 +321,7 @@ void ThreadPool::worker_ws(size_t worker_id) {
 
         std::unique_lock<std::mutex> lk(ws_cv_mutex_);
         ++ws_idle_threads_;
+        ws_idle_hint_.fetch_add(1, std::memory_order_relaxed);
 
         if (kind_ == PoolKind::AdvancedElasticStealing) {
             const bool woke = ws_cv_.wait_for(lk, ws_idle_timeout_, [&] {
@@ -315,6 +330,7 @@ void ThreadPool::worker_ws(size_t worker_id) {
             });
 
             --ws_idle_threads_;
+            ws_idle_hint_.fetch_sub(1, std::memory_order_relaxed);
 
             if (stop_.load(std::memory_order_acquire) &&
                 ws_queued_tasks_.load(std::memory_order_acquire) == 0) {
@@ -342,7 +358,35 @@ void ThreadPool::worker_ws(size_t worker_id) {
         });
 
         --ws_idle_threads_;
+        ws_idle_hint_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+bool ThreadPool::should_spawn(unsigned depth) const {
+    const bool ws = kind_ == PoolKind::WorkStealing || kind_ == PoolKind::AdvancedElasticStealing;
+    const size_t max_threads = ws ? ws_max_threads_ : max_threads_;
+
+    // Depth below which subtrees are large enough to keep an extra task
+    // queued: about log2(max_threads) + 1 levels, enough to seed every worker.
+    unsigned seed_depth = 1;
+    for (size_t t = max_threads; t > 1; t >>= 1) {
+        ++seed_depth;
+    }
+    const size_t slack = depth < seed_depth ? 1 : 0;
+
+    if (tls_pool != this) {
+        return true;
+    }
+    size_t queued = 0;
+    size_t idle = 0;
+    if (ws) {
+        queued = ws_queues_[static_cast<size_t>(tls_worker_id)]->size.load(std::memory_order_relaxed);
+        idle = ws_idle_hint_.load(std::memory_order_relaxed);
+    } else {
+        queued = global_queued_.load(std::memory_order_relaxed);
+        idle = global_idle_.load(std::memory_order_relaxed);
     }
+    return queued < std::max<size_t>(idle, 1) + slack;
 }
 
 ThreadPool::~ThreadPool() {
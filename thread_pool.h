@@ -41,12 +41,23 @@ public:
 
     void submit(std::function<void()> task);
 
+    // Spawn-or-inline hint for recursive fork-join code, in the spirit of lazy
+    // task creation: a caller at recursion depth `depth` should submit a child
+    // only while the pool is short of stealable work, and run it inline
+    // otherwise. Work-stealing kinds look at the calling worker's own deque
+    // against the number of idle thieves; global-queue kinds at the shared
+    // queue against idle workers. Shallow calls keep one extra task queued,
+    // since their subtrees are large enough to be worth moving. Callers that
+    // are not workers of this pool are always told to spawn.
+    bool should_spawn(unsigned depth) const;
+
     ~ThreadPool();
 
 private:
     struct WorkerQueue {
         std::deque<std::function<void()>> dq;
         std::mutex m;
+        std::atomic<size_t> size{0};  // dq.size(), readable without m
     };
 
     void worker_global_fixed();
@@ -78,6 +89,11 @@ private:
     size_t idle_threads_{0};
     std::chrono::milliseconds idle_timeout_{200};
 
+    // Lock-free mirrors of the global queue length and waiting workers, read
+    // by should_spawn().
+    std::atomic<size_t> global_queued_{0};
+    std::atomic<size_t> global_idle_{0};
+
     // Work-stealing state (used by fixed WS and advanced elastic WS)
     std::vector<std::thread> ws_threads_;
     std::vector<bool> ws_running_;
@@ -93,5 +109,6 @@ private:
     size_t ws_max_threads_{0};
     size_t ws_active_threads_{0};
     size_t ws_idle_threads_{0};
+    std::atomic<size_t> ws_idle_hint_{0};  // ws_idle_threads_, readable without ws_cv_mutex_
     std::chrono::milliseconds ws_idle_timeout_{200};
 };